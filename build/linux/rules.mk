@@ -14,18 +14,18 @@ export SUBDIRS := $(shell find $(SRC_PATH) -type d -execdir test -f {}/IGNORE ';
 export INCLUDES := $(addprefix -I, $(SUBDIRS)) $(TIM_INCLUDES)
 
 ifdef TIM_DEBUG_MODE
-	TIM_DEFINES  := -DTIM_OS_LINUX -DTIM_DEBUG
+	TIM_DEFINES  := -DTIM_OS_LINUX -DTIM_DEBUG -DTIM_SQLITE_ENCRYPTION_ENABLED
 	TIM_CFLAGS   := -g -O0 -Wall -Werror
 	TIM_CPPFLAGS := -g -O0 -fno-exceptions -Wall -Werror
 	TIM_STRIP    := touch
 else
-	TIM_DEFINES  := -DTIM_OS_LINUX
+	TIM_DEFINES  := -DTIM_OS_LINUX -DTIM_SQLITE_ENCRYPTION_ENABLED
 	TIM_CFLAGS   := -O3 -Wall -Werror
 	TIM_CPPFLAGS := -O3 -fno-exceptions -Wall -Werror
 	TIM_STRIP    := $(STRIP)
 endif
 
-TIM_LIBS := -lm
+TIM_LIBS := -lm -lpthread
 
 FORT_DEFINES := -DFT_CONGIG_DISABLE_WCHAR # Actually, we need this on Windows only.
 JSON_DEFINES := -DJSON_NOEXCEPTION=1 -DJSON_DIAGNOSTICS=1 -DJSON_DIAGNOSTIC_POSITIONS=1
@@ -33,7 +33,7 @@ LIL_DEFINES := -DLIL_ENABLE_POOLS -DLIL_ENABLE_RECLIMIT=1024
 MONGOOSE_DEFINES := -DMG_TLS=MG_TLS_MBED
 
 SQLITE3_DEFINES := \
-    -DSQLITE_THREADSAFE=0 \
+    -DSQLITE_THREADSAFE=2 \
     -DSQLITE_DEFAULT_MEMSTATUS=0 \
     -DSQLITE_DEFAULT_WAL_SYNCHRONOUS=1 \
     -DSQLITE_LIKE_DOESNT_MATCH_BLOBS \
@@ -59,6 +59,7 @@ SQLITE3_DEFINES := \
     -DSQLITE_TEMP_STORE=3 \
     -DSQLITE_USE_URI=1 \
     -DSQLITE_ENABLE_BATCH_ATOMIC_WRITE \
+    -DSQLITE_ENABLE_FTS5 \
     -DSQLITE_ENABLE_UPDATE_DELETE_LIMIT=1 \
     -DSQLITE_CORE
 
@@ -1,3 +1,6 @@
+-- Свободные страницы возвращаются порциями (https://www.sqlite.org/pragma.html#pragma_incremental_vacuum)
+PRAGMA auto_vacuum = INCREMENTAL;
+
 -- Включаем Write-Ahead Logging (https://www.sqlite.org/wal.html)
 PRAGMA journal_mode = WAL;
 
@@ -47,35 +50,16 @@ CREATE INDEX subscription_publisher_id ON subscription(publisher_id);
 CREATE INDEX subscription_subscriber_id ON subscription(subscriber_id);
 
 
--- Сообщения пользователя
-DROP TABLE IF EXISTS post;
-CREATE TABLE post
-(
-    id VARCHAR PRIMARY KEY NOT NULL CHECK(id != '""' AND id != '"{00000000-0000-0000-0000-000000000000}"'),
---    user_id VARCHAR REFERENCES user(id) ON DELETE CASCADE,
-    user_id VARCHAR,
-    post_id VARCHAR REFERENCES post(id) ON DELETE CASCADE,
-
-    timestamp INTEGER NOT NULL DEFAULT (strftime('%s', 'now') * 1000), -- In milliseconds.
-
-    text VARCHAR NOT NULL
-);
-CREATE INDEX post_user_id ON post(user_id);
-CREATE INDEX post_timestamp ON post(timestamp);
+-- Сообщения, полнотекстовый индекс, дерево ответов и реакции хранятся в шардах
+-- (tim::post_shards), схему которых создаёт приложение.
 
-
--- Реакция на сообщение
-DROP TABLE IF EXISTS reaction;
-CREATE TABLE reaction
+-- Рейтинг сообщения по реакциям с затуханием (tim::post_ranking)
+DROP TABLE IF EXISTS post_score;
+CREATE TABLE post_score
 (
-    id VARCHAR PRIMARY KEY NOT NULL CHECK(id != '""' AND id != '"{00000000-0000-0000-0000-000000000000}"'),
-    post_id VARCHAR NOT NULL REFERENCES post(id) ON DELETE CASCADE,
-
-    timestamp INTEGER NOT NULL DEFAULT (strftime('%s', 'now') * 1000), -- In milliseconds.
-
-    weight INTEGER DEFAULT 1
-);
-CREATE INDEX reaction_post_id ON reaction(post_id);
-CREATE INDEX reaction_timestamp ON reaction(timestamp);
+    post_id VARCHAR PRIMARY KEY NOT NULL, -- The post is in a shard.
+    score REAL NOT NULL,
+    timestamp INTEGER NOT NULL -- In milliseconds, the moment the score is given for.
+) WITHOUT ROWID;
 
 COMMIT;
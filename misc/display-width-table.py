@@ -0,0 +1,83 @@
+#!/usr/bin/python3
+#
+# Makes src/tools/tim_display_width_table.h, the terminal cell widths of
+# the code points, from the Unicode database of the running Python:
+#
+#   python3 misc/display-width-table.py > src/tools/tim_display_width_table.h
+#
+# 0 for the controls, combining marks, format characters and Hangul
+#   medial vowels and final consonants,
+# 2 for the East Asian wide and fullwidth characters, which are also the
+#   emoji with the emoji presentation, and for the unassigned code points
+#   of the CJK blocks and planes,
+# 1 for everything else.
+
+import sys
+import unicodedata
+
+BLOCK_BITS = 8
+BLOCK_SIZE = 1 << BLOCK_BITS
+CODE_POINTS = 0x110000
+
+# Shown with a width, although they are format characters.
+PREPENDED = {0x00AD, 0x0600, 0x0601, 0x0602, 0x0603, 0x0604, 0x0605, 0x06DD,
+             0x070F, 0x0890, 0x0891, 0x08E2, 0x110BD, 0x110CD}
+
+WIDE_UNASSIGNED = [(0x3400, 0x4DBF), (0x4E00, 0x9FFF), (0xF900, 0xFAFF),
+                   (0x20000, 0x2FFFD), (0x30000, 0x3FFFD)]
+
+
+def width(cp):
+    c = chr(cp)
+    category = unicodedata.category(c)
+    if category == 'Cn':
+        return 2 if any(lo <= cp <= hi for lo, hi in WIDE_UNASSIGNED) else 1
+    if category in ('Cc', 'Mn', 'Me') \
+            or (category == 'Cf' and cp not in PREPENDED) \
+            or 0x1160 <= cp <= 0x11FF \
+            or 0xD7B0 <= cp <= 0xD7FF:
+        return 0
+    if unicodedata.east_asian_width(c) in ('W', 'F'):
+        return 2
+    return 1
+
+
+def main():
+    blocks = []
+    index = {}
+    stage1 = []
+    for first in range(0, CODE_POINTS, BLOCK_SIZE):
+        packed = bytearray(BLOCK_SIZE // 4)
+        for cp in range(first, first + BLOCK_SIZE):
+            packed[(cp - first) // 4] |= width(cp) << (2 * (cp % 4))
+        packed = bytes(packed)
+        if packed not in index:
+            index[packed] = len(blocks)
+            blocks.append(packed)
+        stage1.append(index[packed])
+
+    assert len(blocks) <= 256
+
+    out = sys.stdout
+    out.write('#pragma once\n\n')
+    out.write('// Made by misc/display-width-table.py from Unicode %s, do not edit.\n\n'
+              % unicodedata.unidata_version)
+    out.write('#include <cstdint>\n\n\n')
+    out.write('static constexpr int WIDTH_BLOCK_BITS = %d;\n\n' % BLOCK_BITS)
+    out.write('// Block of each %d code points.\n' % BLOCK_SIZE)
+    out.write('static constexpr std::uint8_t WIDTH_BLOCKS[%d] =\n{\n' % len(stage1))
+    for i in range(0, len(stage1), 16):
+        out.write('    %s,\n' % ', '.join('%d' % b for b in stage1[i:i + 16]))
+    out.write('};\n\n')
+    out.write('// Widths of the code points of a block, 2 bits each, the lowest first.\n')
+    out.write('static constexpr std::uint8_t WIDTH_CELLS[%d][%d] =\n{\n' % (len(blocks), BLOCK_SIZE // 4))
+    for packed in blocks:
+        out.write('    {\n')
+        for i in range(0, len(packed), 16):
+            out.write('        %s,\n' % ', '.join('0x%02X' % b for b in packed[i:i + 16]))
+        out.write('    },\n')
+    out.write('};\n')
+
+
+if __name__ == '__main__':
+    main()
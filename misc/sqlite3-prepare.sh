@@ -26,6 +26,7 @@ export CFLAGS="-DSQLITE_THREADSAFE=0 \
 -DSQLITE_TEMP_STORE=3 \
 -DSQLITE_USE_URI=1 \
 -DSQLITE_ENABLE_BATCH_ATOMIC_WRITE \
+-DSQLITE_ENABLE_FTS5 \
 -DSQLITE_ENABLE_UPDATE_DELETE_LIMIT=1 \
 -DSQLITE_CORE"
 
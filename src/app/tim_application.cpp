@@ -2,12 +2,24 @@
 
 #include "tim_application_p.h"
 
+#include "tim_bubble_cache.h"
+#include "tim_frame_scheduler.h"
 #include "tim_config.h"
+#include "tim_display_width.h"
 #include "tim_file_tools.h"
 #include "tim_inetd.h"
+#include "tim_jsonl_transfer.h"
 #include "tim_mqtt_client.h"
+#include "tim_post_archive.h"
+#include "tim_post_fanout.h"
+#include "tim_post_ranking.h"
+#include "tim_post_shards.h"
+#include "tim_scrollback.h"
+#include "tim_sqlite_backup.h"
 #include "tim_sqlite_db.h"
+#include "tim_sqlite_maintenance.h"
 #include "tim_trace.h"
+#include "tim_user_directory.h"
 #include "tim_version.h"
 
 #include "fort.h"
@@ -17,7 +29,11 @@
 #include "tim_user_service.h"
 #include "tim_prompt_service.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <locale>
 
@@ -33,10 +49,6 @@ tim::application *tim::app()
 tim::application::application(int argc, char **argv)
     : _d(new tim::p::application())
 {
-    // FIXME!
-    (void) argc;
-    (void) argv;
-
     assert(!tim::p::application::instance() && "tim::application instantiated already.");
 
     tim::p::application::instance() = this;
@@ -55,26 +67,106 @@ tim::application::application(int argc, char **argv)
         sigemptyset(&action.sa_mask);
         sigaction(SIGINT, &action, &_d->_old_sig_int);
         sigaction(SIGTERM, &action, &_d->_old_sig_term);
+        sigaction(SIGUSR1, &action, &_d->_old_sig_usr1);
     }
 #endif
 
     ft_set_default_border_style(FT_SOLID_ROUND_STYLE);
+    ft_set_u8strwid_func(&tim::p::application::u8strwid);
 
 #ifdef TIM_DEBUG
     // mg_log_set(MG_LL_VERBOSE);
 #endif
     mg_mgr_init(&_d->_mg);
 
+    // tim --import|--export <file.jsonl> moves the data and quits.
+    if (argc == 3
+            && !std::strcmp(argv[1], "--import"))
+        _d->_import_path = argv[2];
+    else if (argc == 3
+                && !std::strcmp(argv[1], "--export"))
+        _d->_export_path = argv[2];
+    else if (argc != 1)
+    {
+        std::fprintf(stderr, "Usage: %s [--import|--export <file.jsonl>]\n", argv[0]);
+        _d->_exit_code = EXIT_FAILURE;
+        _d->_quit = true;
+        return;
+    }
+
     _d->_mqtt.reset(new tim::mqtt_client(&_d->_mg));
 
     _d->_db.reset(new tim::sqlite_db());
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+    // Passphrases are not left in the environment for child processes.
+    const std::string db_key = tim::p::application::take_env(tim::DB_KEY_ENV);
+    const std::string db_new_key = tim::p::application::take_env(tim::DB_NEW_KEY_ENV);
+    if (!db_key.empty()
+            && !_d->_db->set_key(db_key))
+        TIM_TRACE(Fatal,
+                  TIM_TR("Failed to set database encryption key."_en,
+                         "Не могу задать ключ шифрования базы данных."_ru));
+#endif
     if (!_d->_db->open(tim::standard_location(tim::filesystem_location::AppLocalData)
                                                    / tim::DB_FILE_NAME))
         TIM_TRACE(Fatal,
                   TIM_TR("Failed to open database file '%s'."_en,
                          "Не могу открыть файл базы данных '%s'."_ru),
                   _d->_db->path().string().c_str());
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+    if (!db_new_key.empty()
+            && !_d->_db->rekey(db_new_key))
+        TIM_TRACE(Fatal,
+                  TIM_TR("Failed to re-encrypt database file '%s'."_en,
+                         "Не могу перешифровать файл базы данных '%s'."_ru),
+                  _d->_db->path().string().c_str());
+#endif
+    _d->_post_shards.reset(new tim::post_shards());
+    if (!_d->_post_shards->open(_d->_db->path()))
+        TIM_TRACE(Fatal,
+                  TIM_TR("Failed to open the post databases next to '%s'."_en,
+                         "Не могу открыть базы данных сообщений рядом с '%s'."_ru),
+                  _d->_db->path().string().c_str());
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+    if (!db_new_key.empty()
+            && !_d->_post_shards->reencrypt())
+        TIM_TRACE(Fatal,
+                  TIM_TR("Failed to re-encrypt the post databases next to '%s'."_en,
+                         "Не могу перешифровать базы данных сообщений рядом с '%s'."_ru),
+                  _d->_db->path().string().c_str());
+#endif
+    if (!_d->_import_path.empty()
+            || !_d->_export_path.empty())
+    {
+        tim::jsonl_transfer transfer(_d->_db.get(), _d->_post_shards.get());
+        const bool ok = _d->_import_path.empty()
+                            ? transfer.export_file(_d->_export_path)
+                            : transfer.import_file(_d->_import_path);
+        _d->_exit_code = ok
+                             ? EXIT_SUCCESS
+                             : EXIT_FAILURE;
+        _d->_quit = true;
+        return;
+    }
 
+    _d->_db_maintenance.reset(new tim::sqlite_maintenance(&_d->_mg, _d->_db.get()));
+    _d->_db_backup.reset(new tim::sqlite_backup(&_d->_mg, _d->_db.get()));
+    _d->_post_archive.reset(new tim::post_archive(&_d->_mg, _d->_db.get(), _d->_post_shards.get()));
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+    if (!db_new_key.empty())
+        _d->_post_archive->reencrypt();
+#endif
+    if (!_d->_post_shards->start(&_d->_mg))
+        TIM_TRACE(Fatal,
+                  TIM_TR("Failed to start the writers of the post databases."_en,
+                         "Не могу запустить запись в базы данных сообщений."_ru));
+    _d->_user_directory.reset(new tim::user_directory(_d->_db.get()));
+    _d->_post_fanout.reset(new tim::post_fanout(_d->_db.get()));
+    _d->_post_ranking.reset(new tim::post_ranking(&_d->_mg, _d->_db.get()));
+
+    _d->_bubble_cache.reset(new tim::bubble_cache());
+    _d->_scrollback.reset(new tim::scrollback(tim::SCROLLBACK_MEMORY_LIMIT));
+    _d->_frame_scheduler.reset(new tim::frame_scheduler(&_d->_mg));
     _d->_prompt_inetd = tim::inetd::start<tim::prompt_service>(&_d->_mg, tim::TELNET_PORT, false);
     _d->_post_service.reset(new tim::post_service());
     _d->_user_service.reset(new tim::user_service());
@@ -87,6 +179,7 @@ tim::application::~application()
 #ifdef TIM_OS_LINUX
     sigaction(SIGINT, &_d->_old_sig_int, nullptr);
     sigaction(SIGTERM, &_d->_old_sig_term, nullptr);
+    sigaction(SIGUSR1, &_d->_old_sig_usr1, nullptr);
 #endif
 }
 
@@ -115,10 +208,37 @@ void tim::application::dispatch()
     mg_mgr_poll(&_d->_mg, 0);
 }
 
-void tim::application::exec()
+int tim::application::exec()
 {
     while (!_d->_quit)
-        mg_mgr_poll(&_d->_mg, 1000 /* 1 sec */);
+    {
+        if (tim::p::application::backup_requested())
+        {
+            tim::p::application::backup_requested() = 0;
+            if (!_d->_db_backup->running())
+                _d->_db_backup->start();
+        }
+
+        // The timers are run after the wait, so a due one ends it.
+        int timeout = _d->_busy ? 1 : 1000 /* 1 sec */;
+        if (_d->_wake_up_at)
+        {
+            const std::uint64_t now = mg_millis();
+            if (_d->_wake_up_at <= now)
+            {
+                timeout = 0;
+                _d->_wake_up_at = 0;
+            }
+            else
+            {
+                timeout = (int)std::min<std::uint64_t>(timeout, _d->_wake_up_at - now);
+            }
+        }
+
+        mg_mgr_poll(&_d->_mg, timeout);
+    }
+
+    return _d->_exit_code;
 }
 
 void tim::application::quit()
@@ -126,6 +246,24 @@ void tim::application::quit()
     _d->_quit = true;
 }
 
+void tim::application::set_busy(bool busy)
+{
+    _d->_busy += busy ? 1 : -1;
+    assert(_d->_busy >= 0);
+}
+
+/**
+ * The event loop waits no longer than until ms of mg_millis(), pass the
+ * expiration of the timer to be run in time.
+ */
+void tim::application::wake_up_at(std::uint64_t ms)
+{
+    assert(ms);
+
+    if (!_d->_wake_up_at || ms < _d->_wake_up_at)
+        _d->_wake_up_at = ms;
+}
+
 mg_mgr *tim::application::mongoose() const
 {
     return &_d->_mg;
@@ -141,9 +279,81 @@ tim::sqlite_db *tim::application::db() const
     return _d->_db.get();
 }
 
+tim::sqlite_maintenance *tim::application::db_maintenance() const
+{
+    return _d->_db_maintenance.get();
+}
+
+tim::sqlite_backup *tim::application::db_backup() const
+{
+    return _d->_db_backup.get();
+}
+
+
+tim::post_archive *tim::application::post_archive() const
+{
+    return _d->_post_archive.get();
+}
+
+tim::post_fanout *tim::application::post_fanout() const
+{
+    return _d->_post_fanout.get();
+}
+
+tim::post_ranking *tim::application::post_ranking() const
+{
+    return _d->_post_ranking.get();
+}
+
+tim::post_shards *tim::application::post_shards() const
+{
+    return _d->_post_shards.get();
+}
+
+tim::user_directory *tim::application::user_directory() const
+{
+    return _d->_user_directory.get();
+}
+
+tim::bubble_cache *tim::application::bubble_cache() const
+{
+    return _d->_bubble_cache.get();
+}
+
+tim::scrollback *tim::application::scrollback() const
+{
+    return _d->_scrollback.get();
+}
+
+tim::frame_scheduler *tim::application::frame_scheduler() const
+{
+    return _d->_frame_scheduler.get();
+}
+
 
 // Private
 
+std::string tim::p::application::take_env(const char *name)
+{
+    const char *value = std::getenv(name);
+    if (!value)
+        return {};
+
+    const std::string s = value;
+    unsetenv(name);
+
+    return s;
+}
+
+/**
+ * Tables measure their cells like the terminal shows them.
+ */
+int tim::p::application::u8strwid(const void *begin, const void *end, std::size_t *width)
+{
+    *width = tim::display_width(std::string_view((const char *)begin, (const char *)end - (const char *)begin));
+    return 0;
+}
+
 #ifdef TIM_OS_LINUX
 
 void tim::p::application::signal_handler(int sig_num)
@@ -159,6 +369,11 @@ void tim::p::application::signal_handler(int sig_num)
             }
             break;
 
+        case SIGUSR1:
+            // Started from the event loop, signal handlers can't touch the database.
+            tim::p::application::backup_requested() = 1;
+            break;
+
         default:
             break;
     }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -9,8 +10,18 @@ struct mg_mgr;
 namespace tim
 {
 
+class bubble_cache;
+class frame_scheduler;
 class mqtt_client;
+class post_archive;
+class post_fanout;
+class post_ranking;
+class post_shards;
+class scrollback;
+class sqlite_backup;
 class sqlite_db;
+class sqlite_maintenance;
+class user_directory;
 
 namespace p
 {
@@ -34,12 +45,25 @@ public:
     static void set_org_name(const std::string &name);
 
     void dispatch();
-    void exec();
+    int exec();
     void quit();
 
+    void set_busy(bool busy);
+    void wake_up_at(std::uint64_t ms);
+
     mg_mgr *mongoose() const;
     tim::mqtt_client *mqtt() const;
     tim::sqlite_db *db() const;
+    tim::sqlite_maintenance *db_maintenance() const;
+    tim::sqlite_backup *db_backup() const;
+    tim::post_archive *post_archive() const;
+    tim::post_fanout *post_fanout() const;
+    tim::post_ranking *post_ranking() const;
+    tim::post_shards *post_shards() const;
+    tim::user_directory *user_directory() const;
+    tim::bubble_cache *bubble_cache() const;
+    tim::scrollback *scrollback() const;
+    tim::frame_scheduler *frame_scheduler() const;
 
 private:
 
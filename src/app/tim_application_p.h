@@ -2,20 +2,35 @@
 
 #include "mongoose.h"
 
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
 #include <memory>
 
 #ifdef TIM_OS_LINUX
 #   include <signal.h>
 #endif
 
+#include <csignal>
+
 namespace tim
 {
 
+class bubble_cache;
+class frame_scheduler;
 class inetd;
 class mqtt_client;
+class post_archive;
+class post_fanout;
+class post_ranking;
 class post_service;
+class post_shards;
+class scrollback;
+class user_directory;
 class user_service;
+class sqlite_backup;
 class sqlite_db;
+class sqlite_maintenance;
 
 namespace p
 {
@@ -40,18 +55,43 @@ struct application
         return _name;
     }
 
+    static volatile std::sig_atomic_t &backup_requested()
+    {
+        static volatile std::sig_atomic_t requested = 0;
+        return requested;
+    }
+
+    static std::string take_env(const char *name);
+    static int u8strwid(const void *begin, const void *end, std::size_t *width);
+
 #ifdef TIM_OS_LINUX
 
     static void signal_handler(int sig_num);
 
     struct sigaction _old_sig_int;
     struct sigaction _old_sig_term;
+    struct sigaction _old_sig_usr1;
 #endif
     bool _quit = false;
+    int _exit_code = EXIT_SUCCESS;
+    std::filesystem::path _import_path; // tim --import <file.jsonl>
+    std::filesystem::path _export_path; // tim --export <file.jsonl>
+    int _busy = 0; // Poll without waiting while non-zero.
+    std::uint64_t _wake_up_at = 0; // In mg_millis(), zero if none.
 
     struct mg_mgr _mg;
     std::unique_ptr<tim::mqtt_client> _mqtt;
     std::unique_ptr<tim::sqlite_db> _db;
+    std::unique_ptr<tim::sqlite_maintenance> _db_maintenance;
+    std::unique_ptr<tim::sqlite_backup> _db_backup;
+    std::unique_ptr<tim::post_archive> _post_archive;
+    std::unique_ptr<tim::user_directory> _user_directory;
+    std::unique_ptr<tim::post_fanout> _post_fanout;
+    std::unique_ptr<tim::post_ranking> _post_ranking;
+    std::unique_ptr<tim::post_shards> _post_shards; // Its writers finish on exit, so it goes before what their jobs use.
+    std::unique_ptr<tim::bubble_cache> _bubble_cache; // Shared by the prompt sessions, so goes before them.
+    std::unique_ptr<tim::scrollback> _scrollback; // Also holds the prompt sessions.
+    std::unique_ptr<tim::frame_scheduler> _frame_scheduler; // The prompt sessions cancel their frames on close.
     std::unique_ptr<tim::inetd> _prompt_inetd;
     std::unique_ptr<tim::post_service> _post_service;
     std::unique_ptr<tim::user_service> _user_service;
@@ -19,4 +19,68 @@ static const char HISTORY_FNAME[] = "history.txt";
 static const std::chrono::microseconds DB_BUSY_TIMEOUT(100000);
 static const std::size_t DB_BUSY_TRIES = 5;
 static const char DB_FILE_NAME[] = "tim.db";
+static const std::chrono::milliseconds DB_MAINTENANCE_INTERVAL(500);
+static const std::chrono::milliseconds DB_IDLE_TIMEOUT(2000); // No commits for this long means idle.
+static const std::size_t DB_WAL_STEP_FRAMES = 256; // PASSIVE checkpoint while not idle once the WAL has that many frames.
+static const std::int64_t DB_WAL_SIZE_LIMIT = 16 * 1024 * 1024; // The WAL is truncated to this size after a RESTART.
+static const std::size_t DB_VACUUM_PAGES_PER_STEP = 64;
+static const std::chrono::hours DB_POST_RETENTION(24 * 90); // Older posts are archived. Zero disables archiving.
+static const std::chrono::milliseconds DB_ARCHIVE_INTERVAL(5000);
+static const std::size_t DB_ARCHIVE_BATCH_SIZE = 500; // Threads moved to the archive at once.
+static const std::size_t DB_MAX_ATTACHED_ARCHIVES = 4;
+static const char DB_ARCHIVE_DIR_NAME[] = "archive";
+static const int DB_BACKUP_PAGES_PER_STEP = 256; // Pages copied per event loop iteration.
+static const char DB_BACKUP_DIR_NAME[] = "backup";
+static const int DB_PAGE_SIZE = 4096; // Same as SQLITE_DEFAULT_PAGE_SIZE.
+static const unsigned DB_KEY_ITERATIONS = 100000; // PBKDF2 iterations to derive the encryption key.
+static const char DB_KEY_ENV[] = "TIM_DB_KEY"; // Database encryption passphrase.
+static const char DB_NEW_KEY_ENV[] = "TIM_DB_NEW_KEY"; // Re-encrypt the databases with this passphrase on start.
+static const std::size_t DB_TRANSFER_CHUNK_SIZE = 1024 * 1024; // Bytes of a JSON Lines file read or written at once.
+static const std::size_t DB_TRANSFER_MAX_LINE = 16 * 1024 * 1024; // Longer JSON Lines stop the import.
+static const std::size_t DB_TRANSFER_BATCH_SIZE = 50000; // Rows imported per transaction.
+static const std::chrono::milliseconds DB_GROUP_COMMIT_INTERVAL(5); // Queued writes are committed together this often,
+static const std::size_t DB_GROUP_COMMIT_SIZE = 256; // or once that many are queued.
+static const std::size_t DB_SHARD_COUNT = 4; // Post databases, each with a writer thread. Changing it takes an export and import.
+static const char DB_SHARD_DIR_NAME[] = "shard";
+
+/**
+ * SQLite memory tuning profile. The page cache arena is preallocated
+ * once at startup and shared by all connections, pages that do not fit
+ * come from the heap. Lookaside is per connection.
+ */
+struct sqlite_memory_profile
+{
+    int page_cache_slots;    // Pages in the page cache arena, also the cache size of a connection.
+    int lookaside_slot_size; // In bytes.
+    int lookaside_slots;
+    std::int64_t mmap_size;  // Bytes of the database file read through mmap(), zero disables.
+};
+
+static const tim::sqlite_memory_profile DB_PROFILE_SMALL = { 512, 128, 128, 0 };
+static const tim::sqlite_memory_profile DB_PROFILE_READ_MOSTLY = { 8192, 256, 512, 256 * 1024 * 1024 };
+static const tim::sqlite_memory_profile &DB_MEMORY_PROFILE = DB_PROFILE_READ_MOSTLY;
+
+/**
+ * Users
+ */
+static const std::size_t USER_CACHE_SIZE = 1024; // Users kept in memory by tim::user_directory.
+
+/**
+ * Hot posts
+ */
+static const std::size_t HOT_POST_COUNT = 100; // Best scored posts kept ranked in memory.
+static const std::chrono::hours HOT_HALF_LIFE(6); // A reaction weighs half as much after that time.
+static const std::chrono::milliseconds HOT_CHECKPOINT_INTERVAL(10000); // Changed scores are saved that often.
+static const double HOT_MIN_SCORE = 0.01; // Lower scores are forgotten.
+
+/**
+ * Timeline
+ */
+static const std::size_t TIMELINE_PAGE_SIZE = 20; // Posts replayed on login and paged by the Tcl commands.
+static const std::size_t THREAD_MAX_INDENT = 8; // Deeper replies are shown at this depth.
+static const std::size_t SEARCH_MAX_MATCHES = 1000; // Ranked once per search, the pages go through them.
+static const std::size_t BUBBLE_CACHE_SIZE = 64; // Rendered message bubbles shared by the sessions.
+static const std::size_t SCROLLBACK_SIZE = 200; // Messages a session keeps to draw them again.
+static const std::size_t SCROLLBACK_MEMORY_LIMIT = 64 * 1024 * 1024; // Of all the sessions, the least active lose theirs first.
+static const std::chrono::milliseconds PROMPT_FRAME_INTERVAL(33); // Posts coming faster are drawn together.
 }
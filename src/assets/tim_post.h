@@ -0,0 +1,21 @@
+#pragma once
+
+#include "tim_uuid.h"
+
+#include <cstdint>
+#include <string>
+
+
+namespace tim
+{
+
+struct post
+{
+    tim::uuid id;
+    tim::uuid user_id;
+    tim::uuid post_id;
+    std::int64_t timestamp = 0; // In milliseconds.
+    std::string text;
+};
+
+}
@@ -0,0 +1,390 @@
+#include "tim_post_archive.h"
+
+#include "tim_post_archive_p.h"
+
+#include "tim_config.h"
+#include "tim_file_tools.h"
+#include "tim_post_shards.h"
+#include "tim_sqlite_crypt.h"
+#include "tim_sqlite_db.h"
+#include "tim_sqlite_query.h"
+#include "tim_sqlite_writer.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+#include "mongoose.h"
+
+#include <algorithm>
+#include <memory>
+#include <regex>
+
+
+static const char *const WRITE_SCHEMA = "archive_write";
+
+static const char *const PREPARE_SQL =
+R"(CREATE TABLE IF NOT EXISTS archive_write.post
+(
+    id VARCHAR PRIMARY KEY NOT NULL,
+    user_id VARCHAR,
+    post_id VARCHAR,
+    timestamp INTEGER NOT NULL,
+    text VARCHAR NOT NULL
+);
+CREATE INDEX IF NOT EXISTS archive_write.post_timestamp_id ON post(timestamp, id);
+CREATE TABLE IF NOT EXISTS archive_write.reaction
+(
+    id VARCHAR PRIMARY KEY NOT NULL,
+    post_id VARCHAR NOT NULL,
+    user_id VARCHAR NOT NULL,
+    timestamp INTEGER NOT NULL,
+    weight INTEGER DEFAULT 1
+);
+CREATE INDEX IF NOT EXISTS archive_write.reaction_post_id ON reaction(post_id);
+CREATE TEMP TABLE IF NOT EXISTS archive_batch (post_rowid INTEGER PRIMARY KEY);
+DELETE FROM temp.archive_batch;)";
+
+// Whole threads go at once, to the month of the first post, when their
+// last reply expires. So no reply in a shard loses its parent.
+static const char *const BATCH_SQL =
+R"(INSERT OR IGNORE INTO temp.archive_batch
+    SELECT p.rowid
+        FROM main.post_closure AS c
+            JOIN main.post AS p ON p.id = c.descendant_id
+        WHERE c.ancestor_id IN (SELECT r.id
+                                    FROM main.post AS r
+                                    WHERE r.timestamp < :before
+                                        AND r.post_id IS NULL
+                                        AND (SELECT MAX(timestamp)
+                                                 FROM main.post_closure
+                                                 WHERE ancestor_id = r.id) < :horizon
+                                    ORDER BY r.timestamp, r.id
+                                    LIMIT :count))";
+
+static const char *const BATCH_IDS_SQL =
+R"(SELECT id FROM main.post WHERE rowid IN temp.archive_batch)";
+
+// Reactions go first, while their posts are still there to be joined.
+static const char *const MOVE_SQL =
+R"(INSERT OR IGNORE INTO archive_write.reaction (id, post_id, user_id, timestamp, weight)
+    SELECT id, post_id, user_id, timestamp, weight
+        FROM main.reaction
+        WHERE post_id IN (SELECT id FROM main.post WHERE rowid IN temp.archive_batch);
+INSERT OR IGNORE INTO archive_write.post (id, user_id, post_id, timestamp, text)
+    SELECT id, user_id, post_id, timestamp, text
+        FROM main.post
+        WHERE rowid IN temp.archive_batch;
+DELETE FROM main.reaction
+    WHERE post_id IN (SELECT id FROM main.post WHERE rowid IN temp.archive_batch);
+DELETE FROM main.post_closure
+    WHERE ancestor_id IN (SELECT id FROM main.post WHERE rowid IN temp.archive_batch);
+DELETE FROM main.post_closure
+    WHERE descendant_id IN (SELECT id FROM main.post WHERE rowid IN temp.archive_batch);
+DELETE FROM main.post
+    WHERE rowid IN temp.archive_batch;)";
+
+static const char *const EXPIRED_SQL =
+R"(SELECT strftime('%Y-%m', r.timestamp / 1000, 'unixepoch'),
+       CAST(strftime('%s', r.timestamp / 1000, 'unixepoch', 'start of month', '+1 month') AS INTEGER) * 1000
+    FROM post AS r
+    WHERE r.timestamp < :horizon
+        AND r.post_id IS NULL
+        AND (SELECT MAX(timestamp)
+                 FROM post_closure
+                 WHERE ancestor_id = r.id) < :horizon
+    ORDER BY r.timestamp, r.id
+    LIMIT 1)";
+
+
+// Public
+
+tim::post_archive::post_archive(mg_mgr *mg, tim::sqlite_db *db, tim::post_shards *shards)
+    : archived()
+    , _d(new tim::p::post_archive(this))
+{
+    assert(mg);
+    assert(db);
+    assert(db->is_open());
+    assert(shards);
+
+    _d->_db = db;
+    _d->_shards = shards;
+    _d->_dir = db->path().parent_path() / tim::DB_ARCHIVE_DIR_NAME;
+    _d->scan();
+
+    if (tim::DB_POST_RETENTION.count() > 0)
+        _d->_timer = mg_timer_add(mg, tim::DB_ARCHIVE_INTERVAL.count(),
+                                  MG_TIMER_REPEAT,
+                                  &tim::p::post_archive::on_timer, _d.get());
+}
+
+tim::post_archive::~post_archive()
+{
+    while (!_d->_attached.empty())
+        if (!detach(_d->_attached.back()))
+            break;
+}
+
+const std::vector<std::string> &tim::post_archive::months() const
+{
+    return _d->_months;
+}
+
+std::filesystem::path tim::post_archive::path(const std::string &month) const
+{
+    assert(!month.empty());
+
+    return _d->_dir / (_d->_db->path().stem().string() + '-' + month + ".db");
+}
+
+bool tim::post_archive::attach(const std::string &month, std::string &schema)
+{
+    schema = tim::p::post_archive::schema(month);
+
+    std::list<std::string>::iterator it = std::find(_d->_attached.begin(), _d->_attached.end(), month);
+    if (it != _d->_attached.end())
+    {
+        _d->_attached.splice(_d->_attached.begin(), _d->_attached, it);
+        return true;
+    }
+
+    while (_d->_attached.size() >= tim::DB_MAX_ATTACHED_ARCHIVES)
+        if (!detach(_d->_attached.back()))
+            return false;
+
+    // Read-only URI, with the characters special to URIs escaped.
+    std::string uri = "file:";
+    for (const char c: path(month).string())
+        switch (c)
+        {
+            case '%': uri += "%25"; break;
+            case '?': uri += "%3f"; break;
+            case '#': uri += "%23"; break;
+            default: uri += c; break;
+        }
+    uri += "?mode=ro";
+
+    tim::sqlite_query q(_d->_db, "ATTACH DATABASE ? AS " + schema);
+    if (!q.prepare()
+            || !q.bind(1, uri)
+            || !q.exec())
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to attach archive '%s'."_en,
+                              "Ошибка при подключении архива '%s'."_ru),
+                        path(month).string().c_str());
+
+    _d->_attached.push_front(month);
+
+    return true;
+}
+
+bool tim::post_archive::detach(const std::string &month)
+{
+    std::list<std::string>::iterator it = std::find(_d->_attached.begin(), _d->_attached.end(), month);
+    if (it == _d->_attached.end())
+        return true;
+
+    if (!_d->_db->exec("DETACH DATABASE " + tim::p::post_archive::schema(month)))
+        return false;
+
+    _d->_attached.erase(it);
+
+    return true;
+}
+
+/**
+ * Has the writer of the next shard with expired threads move a batch
+ * of them, unless a batch is being moved already.
+ */
+bool tim::post_archive::archive(std::size_t count)
+{
+    assert(count > 0);
+
+    if (_d->_moving)
+        return true;
+
+    const std::int64_t horizon
+        = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch() - tim::DB_POST_RETENTION).count();
+
+    for (std::size_t i = 0; i < _d->_shards->count(); ++i)
+    {
+        const std::size_t shard = _d->_next_shard;
+        _d->_next_shard = (_d->_next_shard + 1) % _d->_shards->count();
+
+        tim::sqlite_query q(_d->_shards->db(shard), EXPIRED_SQL);
+        bool done = false;
+        if (!q.prepare()
+                || !q.bind(":horizon", horizon)
+                || !q.next(&done))
+            return false;
+        if (!done)
+            return _d->move(shard, q.to_string(0), q.to_int64(1), horizon, count);
+    }
+
+    return true;
+}
+
+
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+
+bool tim::post_archive::reencrypt()
+{
+    while (!_d->_attached.empty())
+        if (!detach(_d->_attached.back()))
+            return false;
+
+    bool ok = true;
+    for (const std::string &month: months())
+        ok = tim::sqlite_crypt::reencrypt(path(month))
+                && ok;
+
+    return ok;
+}
+
+#endif
+
+// Private
+
+void tim::p::post_archive::on_timer(void *self)
+{
+    tim::p::post_archive *d = (tim::p::post_archive *)self;
+    assert(d);
+
+    if (!d->_db->is_open()
+            || d->_db->is_transaction_active())
+        return;
+
+    d->_q->archive(tim::DB_ARCHIVE_BATCH_SIZE);
+}
+
+std::string tim::p::post_archive::schema(const std::string &month)
+{
+    std::string s = "archive_" + month;
+    std::replace(s.begin(), s.end(), '-', '_');
+    return s;
+}
+
+void tim::p::post_archive::scan()
+{
+    _months.clear();
+
+    const std::string prefix = _db->path().stem().string() + '-';
+    const std::regex re(".*" + prefix + "[0-9]{4}-[0-9]{2}\\.db");
+    for (const std::filesystem::path &path: tim::files(_dir, re))
+        _months.emplace_back(path.stem().string().substr(prefix.size()));
+
+    std::sort(_months.begin(), _months.end(), std::greater<std::string>());
+}
+
+/**
+ * Runs on the writer thread of the shard, the database is its connection.
+ */
+bool tim::p::post_archive::move(tim::sqlite_db *db,
+                                const std::filesystem::path &path,
+                                std::int64_t before,
+                                std::int64_t horizon,
+                                std::size_t count,
+                                std::vector<tim::uuid> &post_ids)
+{
+    {
+        tim::sqlite_query q(db, std::string("ATTACH DATABASE ? AS ") + WRITE_SCHEMA);
+        if (!q.prepare()
+                || !q.bind(1, path.string())
+                || !q.exec())
+            return false;
+    }
+
+    bool ok = db->exec(PREPARE_SQL)
+                  && db->begin();
+    if (ok)
+    {
+        {
+            tim::sqlite_query q(db, BATCH_SQL);
+            ok = q.prepare()
+                    && q.bind(":before", before)
+                    && q.bind(":horizon", horizon)
+                    && q.bind(":count", (std::int64_t)count)
+                    && q.exec();
+        }
+
+        if (ok)
+        {
+            tim::sqlite_query q(db, BATCH_IDS_SQL);
+            tim::uuid post_id;
+            bool done = false;
+            ok = q.prepare();
+            while (ok
+                        && q.next(&done, post_id)
+                        && !done)
+                post_ids.push_back(post_id);
+
+            ok = ok
+                    && done
+                    && db->exec(MOVE_SQL);
+        }
+
+        if (ok)
+            ok = db->commit();
+        else
+            db->rollback();
+    }
+
+    db->exec(std::string("DETACH DATABASE ") + WRITE_SCHEMA);
+
+    if (!ok)
+    {
+        post_ids.clear();
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to move posts to archive '%s'."_en,
+                              "Ошибка при переносе сообщений в архив '%s'."_ru),
+                        path.string().c_str());
+    }
+
+    return true;
+}
+
+bool tim::p::post_archive::move(std::size_t shard,
+                                const std::string &month,
+                                std::int64_t before,
+                                std::int64_t horizon,
+                                std::size_t count)
+{
+    // The archive may be attached read-only for the queries.
+    if (!_q->detach(month))
+        return false;
+
+    std::error_code ec;
+    if (!std::filesystem::exists(_dir, ec)
+            && (ec
+                    || !std::filesystem::create_directories(_dir, ec)))
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to create folder '%s': %s"_en,
+                              "Ошибка при создании папки '%s': %s"_ru),
+                        _dir.string().c_str(),
+                        ec.message().c_str());
+
+    const std::filesystem::path path = _q->path(month);
+    const bool is_new = !std::filesystem::exists(path, ec);
+    std::shared_ptr<std::vector<tim::uuid>> post_ids = std::make_shared<std::vector<tim::uuid>>();
+
+    _moving = true;
+    _shards->writer(shard)->post_exclusive(
+        [path, before, horizon, count, post_ids](tim::sqlite_db *db)
+        {
+            return tim::p::post_archive::move(db, path, before, horizon, count, *post_ids);
+        },
+        [this, is_new, post_ids](bool ok)
+        {
+            _moving = false;
+            if (!ok)
+                return;
+
+            if (is_new)
+                scan();
+
+            if (!post_ids->empty())
+                _q->archived(*post_ids);
+        });
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "tim_signal.h"
+#include "tim_uuid.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+struct mg_mgr;
+
+namespace tim
+{
+
+class post_shards;
+class sqlite_db;
+
+namespace p
+{
+
+struct post_archive;
+
+}
+
+/**
+ * Moves expired posts out of the post shards into per-month archives.
+ *
+ * Threads whose last post is older than DB_POST_RETENTION go, together
+ * with their reactions, to "<db>-YYYY-MM.db" files in the "archive"
+ * folder next to the main database, by the month of the first post,
+ * a batch per shard and timer tick. A batch is moved by the writer
+ * thread of its shard, in a transaction of its own. Archives are
+ * attached read-only to the main database on demand for the historical
+ * queries; only the few recently used ones stay attached. The posts of
+ * a batch are announced once it is committed.
+ */
+class post_archive
+{
+
+public:
+
+    tim::signal<const std::vector<tim::uuid> & /* post_ids */> archived;
+
+    post_archive(mg_mgr *mg, tim::sqlite_db *db, tim::post_shards *shards);
+    ~post_archive();
+
+    const std::vector<std::string> &months() const;
+    std::filesystem::path path(const std::string &month) const;
+
+    bool attach(const std::string &month, std::string &schema);
+    bool detach(const std::string &month);
+
+    bool archive(std::size_t count);
+
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+    bool reencrypt();
+#endif
+
+private:
+
+    std::unique_ptr<tim::p::post_archive> _d;
+};
+
+}
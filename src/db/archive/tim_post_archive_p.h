@@ -0,0 +1,47 @@
+#pragma once
+
+#include "tim_post_archive.h"
+
+#include <cassert>
+#include <chrono>
+#include <list>
+
+
+struct mg_timer;
+
+namespace tim::p
+{
+
+struct post_archive
+{
+    explicit post_archive(tim::post_archive *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    static void on_timer(void *self);
+    static std::string schema(const std::string &month);
+    static bool move(tim::sqlite_db *db,
+                     const std::filesystem::path &path,
+                     std::int64_t before,
+                     std::int64_t horizon,
+                     std::size_t count,
+                     std::vector<tim::uuid> &post_ids);
+
+    void scan();
+    bool move(std::size_t shard, const std::string &month, std::int64_t before, std::int64_t horizon, std::size_t count);
+
+    tim::post_archive *const _q;
+
+    tim::sqlite_db *_db = nullptr;
+    tim::post_shards *_shards = nullptr;
+    mg_timer *_timer = nullptr;
+    std::filesystem::path _dir;
+    std::vector<std::string> _months; // Newest first.
+    std::list<std::string> _attached; // Most recently used first.
+    std::size_t _next_shard = 0; // Looked for expired threads first.
+    bool _moving = false; // While a writer moves a batch.
+};
+
+}
@@ -0,0 +1,213 @@
+#include "tim_post_search.h"
+
+#include "tim_post_search_p.h"
+
+#include "tim_config.h"
+#include "tim_post.h"
+#include "tim_post_shards.h"
+#include "tim_string_tools.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <tuple>
+
+
+// The matches are ranked once per search, the pages then seek them by rowid.
+static const char *const MATCHES_SQL =
+R"(SELECT rank, rowid
+    FROM post_fts
+    WHERE post_fts MATCH :query
+    ORDER BY rank, rowid
+    LIMIT :count)";
+
+static const char *const MATCH_SQL =
+R"(SELECT p.id, p.user_id, p.post_id, p.timestamp, p.text,
+       snippet(post_fts, 0, char(2), char(3), '…', 12)
+    FROM post_fts
+        JOIN post AS p ON p.rowid = post_fts.rowid
+    WHERE post_fts MATCH :query
+        AND post_fts.rowid = :rowid)";
+
+
+// Public
+
+tim::post_search::post_search(const tim::post_shards *shards)
+    : found()
+    , _d(new tim::p::post_search(this, shards))
+{
+}
+
+tim::post_search::~post_search() = default;
+
+bool tim::post_search::find(const std::string &text, std::size_t count)
+{
+    reset();
+
+    _d->_query = tim::p::post_search::to_fts_query(text);
+    if (_d->_query.empty())
+        return true;
+
+    return _d->rank()
+                && _d->fetch(count);
+}
+
+bool tim::post_search::next(std::size_t count)
+{
+    if (at_end())
+        return true;
+
+    return _d->fetch(count);
+}
+
+const std::string &tim::post_search::query() const
+{
+    return _d->_query;
+}
+
+bool tim::post_search::at_end() const
+{
+    return _d->_pos == _d->_rowids.size();
+}
+
+void tim::post_search::reset()
+{
+    _d->_query.clear();
+    _d->_rowids.clear();
+    _d->_pos = 0;
+}
+
+
+// Private
+
+tim::p::post_search::post_search(tim::post_search *q, const tim::post_shards *shards)
+    : _q(q)
+{
+    assert(_q);
+    assert(shards);
+
+    for (std::size_t k = 0; k < shards->count(); ++k)
+    {
+        _matches.emplace_back(new tim::sqlite_query(shards->db(k), MATCHES_SQL));
+        _match.emplace_back(new tim::sqlite_query(shards->db(k), MATCH_SQL));
+    }
+}
+
+std::string tim::p::post_search::to_fts_query(const std::string &text)
+{
+    // Every word is quoted, so that the user input is never parsed
+    // as the FTS5 query syntax and all the words must match.
+    std::string res;
+    for (const std::string &word: tim::split_v(text))
+    {
+        if (!res.empty())
+            res += ' ';
+        res += '"';
+        for (const char c: word)
+        {
+            if (c == '"')
+                res += '"';
+            res += c;
+        }
+        res += '"';
+    }
+
+    return res;
+}
+
+/**
+ * Keeps the rowids of the best SEARCH_MAX_MATCHES matches, so that
+ * the pages neither rank all the matches again nor skip or repeat
+ * a post when the ranks change with the index.
+ */
+bool tim::p::post_search::rank()
+{
+    std::vector<std::tuple<double, std::size_t, std::int64_t>> matches;
+    bool ok = true;
+    for (std::size_t k = 0; ok && k < _matches.size(); ++k)
+    {
+        tim::sqlite_query &q = *_matches[k];
+        if (!(ok = (q.prepared()
+                        || q.prepare())))
+            break;
+
+        if (!q.bind(":query", _query)
+                || !q.bind(":count", (std::int64_t)tim::SEARCH_MAX_MATCHES))
+        {
+            q.clear_bindings();
+            return false;
+        }
+
+        double rank = 0;
+        std::int64_t rowid = 0;
+        bool done = false;
+        while (q.next(&done, rank, rowid)
+                    && !done)
+            matches.emplace_back(rank, k, rowid);
+
+        q.reset();
+        q.clear_bindings();
+
+        ok = done;
+    }
+
+    if (!ok)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to search posts for '%s'."_en,
+                              "Ошибка при поиске сообщений по запросу '%s'."_ru),
+                        _query.c_str());
+
+    const std::size_t count = std::min(matches.size(), tim::SEARCH_MAX_MATCHES);
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end());
+
+    _rowids.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        _rowids.emplace_back(std::get<1>(matches[i]), std::get<2>(matches[i]));
+
+    return true;
+}
+
+bool tim::p::post_search::fetch(std::size_t count)
+{
+    assert(count > 0);
+
+    tim::post post;
+    std::string_view snippet;
+    bool ok = true;
+    for (std::size_t n = 0; ok && n < count && _pos < _rowids.size();)
+    {
+        tim::sqlite_query &q = *_match[_rowids[_pos].first];
+        bool done = false;
+        ok = (q.prepared()
+                  || q.prepare())
+                && q.bind(":query", _query)
+                && q.bind(":rowid", _rowids[_pos++].second)
+                && q.next(&done, post.id, post.user_id, post.post_id, post.timestamp, post.text, snippet);
+
+        // A post deleted since the search is skipped.
+        if (ok
+                && !done)
+        {
+            ++n;
+            _q->found(post, snippet);
+        }
+
+        if (q.prepared())
+        {
+            q.reset();
+            q.clear_bindings();
+        }
+    }
+
+    if (!ok)
+    {
+        _pos = _rowids.size();
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to search posts for '%s'."_en,
+                              "Ошибка при поиске сообщений по запросу '%s'."_ru),
+                        _query.c_str());
+    }
+
+    return true;
+}
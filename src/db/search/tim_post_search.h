@@ -0,0 +1,60 @@
+#pragma once
+
+#include "tim_signal.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+
+namespace tim
+{
+
+class post_shards;
+struct post;
+
+namespace p
+{
+
+struct post_search;
+
+}
+
+/**
+ * Ranked full-text search over the posts.
+ *
+ * Matches are emitted through the found signal best first, along with
+ * a snippet where the matched terms are enclosed in MATCH_BEGIN and
+ * MATCH_END. The matches are ranked once by find(), up to
+ * SEARCH_MAX_MATCHES of them, and the pages go through that snapshot.
+ * Every shard ranks its own matches, by the statistics of its own
+ * index, and the best of them all are kept.
+ * The slots must not call the search back.
+ */
+class post_search
+{
+
+public:
+
+    static const char MATCH_BEGIN = '\x02';
+    static const char MATCH_END = '\x03';
+
+    tim::signal<const tim::post & /* post */, std::string_view /* snippet */> found;
+
+    explicit post_search(const tim::post_shards *shards);
+    ~post_search();
+
+    bool find(const std::string &text, std::size_t count);
+    bool next(std::size_t count);
+
+    const std::string &query() const;
+    bool at_end() const;
+    void reset();
+
+private:
+
+    std::unique_ptr<tim::p::post_search> _d;
+};
+
+}
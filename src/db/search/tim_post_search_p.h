@@ -0,0 +1,43 @@
+#pragma once
+
+#include "tim_sqlite_query.h"
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace tim
+{
+
+class post_search;
+class post_shards;
+
+namespace p
+{
+
+struct post_search
+{
+    post_search(tim::post_search *q, const tim::post_shards *shards);
+
+    static std::string to_fts_query(const std::string &text);
+
+    bool rank();
+    bool fetch(std::size_t count);
+
+    tim::post_search *const _q;
+
+    std::vector<std::unique_ptr<tim::sqlite_query>> _matches; // By shard.
+    std::vector<std::unique_ptr<tim::sqlite_query>> _match;
+
+    std::string _query;
+    std::vector<std::pair<std::size_t /* shard */, std::int64_t /* rowid */>> _rowids; // Of the matches, best first.
+    std::size_t _pos = 0; // Of the next page in _rowids.
+};
+
+}
+
+}
@@ -0,0 +1,257 @@
+#include "tim_post_shards.h"
+
+#include "tim_post_shards_p.h"
+
+#include "tim_config.h"
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+#   include "tim_sqlite_crypt.h"
+#endif
+#include "tim_trace.h"
+#include "tim_translator.h"
+#include "tim_uuid.h"
+
+#include <string>
+
+
+// The shards are created by the application, with the number of them
+// it is built with. So is their part of the schema.
+static const char *const SCHEMA_SQL =
+R"(PRAGMA auto_vacuum = INCREMENTAL;
+PRAGMA journal_mode = WAL;
+BEGIN;
+CREATE TABLE IF NOT EXISTS post
+(
+    id VARCHAR PRIMARY KEY NOT NULL CHECK(id != '""' AND id != '"{00000000-0000-0000-0000-000000000000}"'),
+    user_id VARCHAR,
+    post_id VARCHAR REFERENCES post(id) ON DELETE CASCADE,
+    timestamp INTEGER NOT NULL DEFAULT (strftime('%s', 'now') * 1000),
+    text VARCHAR NOT NULL
+);
+CREATE INDEX IF NOT EXISTS post_user_id ON post(user_id);
+CREATE INDEX IF NOT EXISTS post_timestamp_id ON post(timestamp, id);
+CREATE VIRTUAL TABLE IF NOT EXISTS post_fts USING fts5
+(
+    text,
+    content = 'post',
+    content_rowid = 'rowid',
+    tokenize = 'unicode61 remove_diacritics 2'
+);
+CREATE TABLE IF NOT EXISTS post_closure
+(
+    ancestor_id VARCHAR NOT NULL REFERENCES post(id) ON DELETE CASCADE,
+    timestamp INTEGER NOT NULL,
+    descendant_id VARCHAR NOT NULL REFERENCES post(id) ON DELETE CASCADE,
+    depth INTEGER NOT NULL,
+    PRIMARY KEY (ancestor_id, timestamp, descendant_id)
+) WITHOUT ROWID;
+CREATE INDEX IF NOT EXISTS post_closure_descendant_id ON post_closure(descendant_id, depth);
+CREATE TABLE IF NOT EXISTS reaction
+(
+    id VARCHAR PRIMARY KEY NOT NULL CHECK(id != '""' AND id != '"{00000000-0000-0000-0000-000000000000}"'),
+    post_id VARCHAR NOT NULL REFERENCES post(id) ON DELETE CASCADE,
+    user_id VARCHAR NOT NULL,
+    timestamp INTEGER NOT NULL DEFAULT (strftime('%s', 'now') * 1000),
+    weight INTEGER DEFAULT 1
+);
+CREATE UNIQUE INDEX IF NOT EXISTS reaction_post_id_user_id ON reaction(post_id, user_id);
+CREATE INDEX IF NOT EXISTS reaction_timestamp ON reaction(timestamp);
+CREATE TRIGGER IF NOT EXISTS post_update_id BEFORE UPDATE ON post
+    WHEN NEW.id IS NOT NULL AND NEW.id != OLD.id
+BEGIN
+    SELECT RAISE(ROLLBACK, 'Post ID may not be changed.');
+END;
+CREATE TRIGGER IF NOT EXISTS reaction_update_id BEFORE UPDATE ON reaction
+    WHEN NEW.id IS NOT NULL AND NEW.id != OLD.id
+BEGIN
+    SELECT RAISE(ROLLBACK, 'Reaction ID may not be changed.');
+END;
+CREATE TRIGGER IF NOT EXISTS post_fts_insert AFTER INSERT ON post
+BEGIN
+    INSERT INTO post_fts (rowid, text) VALUES (NEW.rowid, NEW.text);
+END;
+CREATE TRIGGER IF NOT EXISTS post_fts_delete AFTER DELETE ON post
+BEGIN
+    INSERT INTO post_fts (post_fts, rowid, text) VALUES ('delete', OLD.rowid, OLD.text);
+END;
+CREATE TRIGGER IF NOT EXISTS post_fts_update AFTER UPDATE OF text ON post
+BEGIN
+    INSERT INTO post_fts (post_fts, rowid, text) VALUES ('delete', OLD.rowid, OLD.text);
+    INSERT INTO post_fts (rowid, text) VALUES (NEW.rowid, NEW.text);
+END;
+CREATE TRIGGER IF NOT EXISTS post_closure_insert AFTER INSERT ON post
+BEGIN
+    INSERT INTO post_closure (ancestor_id, timestamp, descendant_id, depth)
+        SELECT ancestor_id, NEW.timestamp, NEW.id, depth + 1
+            FROM post_closure
+            WHERE descendant_id = NEW.post_id
+        UNION ALL
+        SELECT NEW.id, NEW.timestamp, NEW.id, 0;
+END;
+COMMIT;)";
+
+static const char *const FIND_SQL = "SELECT 1 FROM post WHERE id = ?";
+
+
+// Public
+
+tim::post_shards::post_shards()
+    : _d(new tim::p::post_shards(this))
+{
+}
+
+tim::post_shards::~post_shards() = default;
+
+bool tim::post_shards::open(const std::filesystem::path &db_path)
+{
+    assert(_d->_dbs.empty() && "The shards are already open.");
+
+    _d->_dir = db_path.parent_path() / tim::DB_SHARD_DIR_NAME;
+    _d->_stem = db_path.stem().string();
+
+    for (std::size_t k = 0; k < tim::DB_SHARD_COUNT; ++k)
+    {
+        _d->_dbs.emplace_back(new tim::sqlite_db());
+        _d->_finds.emplace_back();
+        if (!_d->open_shard(k))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Opens the connections of the writer threads. Until then, the shards
+ * are written through db().
+ */
+bool tim::post_shards::start(mg_mgr *mg)
+{
+    assert(mg);
+    assert(_d->_writers.empty() && "The writers are already started.");
+
+    for (std::size_t k = 0; k < count(); ++k)
+    {
+        std::unique_ptr<tim::sqlite_db> db(new tim::sqlite_db());
+        if (!db->open(path(k))
+                || !db->exec("PRAGMA journal_size_limit = " + std::to_string(tim::DB_WAL_SIZE_LIMIT)))
+            return TIM_TRACE(Error,
+                            TIM_TR("Failed to open database file '%s'."_en,
+                                  "Ошибка при открытии файла базы данных '%s'."_ru),
+                            path(k).string().c_str());
+
+        _d->_writers.emplace_back(new tim::sqlite_writer(mg, db.get()));
+        _d->_writer_dbs.push_back(std::move(db));
+    }
+
+    return true;
+}
+
+std::size_t tim::post_shards::count() const
+{
+    return _d->_dbs.size();
+}
+
+std::size_t tim::post_shards::shard(const tim::uuid &user_id) const
+{
+    assert(count() > 0);
+
+    return user_id.hash() % count();
+}
+
+std::filesystem::path tim::post_shards::path(std::size_t shard) const
+{
+    return _d->_dir / (_d->_stem + '-' + std::to_string(shard) + ".db");
+}
+
+tim::sqlite_db *tim::post_shards::db(std::size_t shard) const
+{
+    assert(shard < count());
+
+    return _d->_dbs[shard].get();
+}
+
+tim::sqlite_writer *tim::post_shards::writer(std::size_t shard) const
+{
+    assert(shard < _d->_writers.size());
+
+    return _d->_writers[shard].get();
+}
+
+/**
+ * Looks the post up in every shard, the posts being written are not
+ * there yet.
+ */
+bool tim::post_shards::find(const tim::uuid &post_id, std::size_t &shard) const
+{
+    const std::string id = post_id.to_string();
+    for (std::size_t k = 0; k < count(); ++k)
+    {
+        tim::sqlite_query &q = *_d->_finds[k];
+
+        bool done = true;
+        const bool ok = q.bind(1, id)
+                            && q.next(&done);
+
+        q.reset();
+        q.clear_bindings();
+
+        if (!ok)
+            return TIM_TRACE(Error,
+                            TIM_TR("Failed to find post '%s'."_en,
+                                  "Ошибка при поиске сообщения '%s'."_ru),
+                            id.c_str());
+
+        if (!done)
+        {
+            shard = k;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+
+/**
+ * Re-encrypts the shards with the current key, before start().
+ */
+bool tim::post_shards::reencrypt()
+{
+    assert(_d->_writers.empty() && "The writers own the shards.");
+
+    bool ok = true;
+    for (std::size_t k = 0; k < count(); ++k)
+    {
+        _d->_finds[k].reset();
+        ok = _d->_dbs[k]->exec("PRAGMA wal_checkpoint(TRUNCATE)")
+                && ok;
+        _d->_dbs[k]->close();
+
+        ok = tim::sqlite_crypt::reencrypt(path(k))
+                && ok;
+        ok = _d->open_shard(k)
+                && ok;
+    }
+
+    return ok;
+}
+
+#endif
+
+
+// Private
+
+bool tim::p::post_shards::open_shard(std::size_t shard)
+{
+    tim::sqlite_db *db = _dbs[shard].get();
+    if (!db->open(_q->path(shard))
+            || !db->exec(SCHEMA_SQL))
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to open database file '%s'."_en,
+                              "Ошибка при открытии файла базы данных '%s'."_ru),
+                        _q->path(shard).string().c_str());
+
+    _finds[shard].reset(new tim::sqlite_query(db, FIND_SQL));
+
+    return _finds[shard]->prepare();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+
+struct mg_mgr;
+
+namespace tim
+{
+
+class sqlite_db;
+class sqlite_writer;
+class uuid;
+
+namespace p
+{
+
+struct post_shards;
+
+}
+
+/**
+ * The posts and their reactions, partitioned across DB_SHARD_COUNT
+ * databases by a hash of the author.
+ *
+ * The "<db>-K.db" files live in the "shard" folder next to the main
+ * database. A root post goes to the shard of its author, its replies
+ * and reactions follow it, so a thread is never split and its closure
+ * stays in one file. Every shard has a connection for the queries of
+ * the event loop and, once started, another one owned by its writer
+ * thread, so the shards are written in parallel. Queries over all the
+ * posts merge the results of the shards.
+ */
+class post_shards
+{
+
+public:
+
+    post_shards();
+    ~post_shards();
+
+    bool open(const std::filesystem::path &db_path);
+    bool start(mg_mgr *mg);
+
+    std::size_t count() const;
+    std::size_t shard(const tim::uuid &user_id) const;
+    std::filesystem::path path(std::size_t shard) const;
+
+    tim::sqlite_db *db(std::size_t shard) const;
+    tim::sqlite_writer *writer(std::size_t shard) const;
+
+    bool find(const tim::uuid &post_id, std::size_t &shard) const;
+
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+    bool reencrypt();
+#endif
+
+private:
+
+    std::unique_ptr<tim::p::post_shards> _d;
+};
+
+}
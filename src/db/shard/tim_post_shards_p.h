@@ -0,0 +1,36 @@
+#pragma once
+
+#include "tim_post_shards.h"
+
+#include "tim_sqlite_db.h"
+#include "tim_sqlite_query.h"
+#include "tim_sqlite_writer.h"
+
+#include <cassert>
+#include <vector>
+
+
+namespace tim::p
+{
+
+struct post_shards
+{
+    explicit post_shards(tim::post_shards *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    bool open_shard(std::size_t shard);
+
+    tim::post_shards *const _q;
+
+    std::filesystem::path _dir;
+    std::string _stem;
+    std::vector<std::unique_ptr<tim::sqlite_db>> _dbs; // Of the event loop.
+    std::vector<std::unique_ptr<tim::sqlite_query>> _finds; // By shard, on _dbs.
+    std::vector<std::unique_ptr<tim::sqlite_db>> _writer_dbs;
+    std::vector<std::unique_ptr<tim::sqlite_writer>> _writers; // Go before their databases.
+};
+
+}
@@ -0,0 +1,243 @@
+#include "tim_sqlite_backup.h"
+
+#include "tim_sqlite_backup_p.h"
+
+#include "tim_application.h"
+#include "tim_config.h"
+#include "tim_file_tools.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+#include "mongoose.h"
+#include "sqlite3.h"
+
+#include <cassert>
+#include <cstdio>
+#include <ctime>
+
+
+// Public
+
+tim::sqlite_backup::sqlite_backup(mg_mgr *mg, const tim::sqlite_db *db)
+    : finished()
+    , _d(new tim::p::sqlite_backup(this))
+{
+    assert(mg);
+    assert(db);
+
+    _d->_mg = mg;
+    _d->_db = db;
+    _d->_timer = mg_timer_add(mg, 1,
+                              MG_TIMER_REPEAT,
+                              &tim::p::sqlite_backup::on_timer, _d.get());
+}
+
+tim::sqlite_backup::~sqlite_backup()
+{
+    cancel();
+}
+
+bool tim::sqlite_backup::start(const void *owner,
+                               tim::sqlite_db::backup_progress_fn fn)
+{
+    assert(_d->_db->is_open());
+
+    if (running())
+        return TIM_TRACE(Error,
+                        TIM_TR("Backup to '%s' is in progress already."_en,
+                              "Резервное копирование в '%s' уже выполняется."_ru),
+                        _d->_path.string().c_str());
+
+    _d->_path = tim::complete_path(tim::p::sqlite_backup::default_path(_d->_db),
+                                   tim::create_path::Base);
+    _d->_owner = owner;
+    _d->_progress = fn;
+    _d->_remaining = 0;
+    _d->_total = 0;
+
+    // Created here exclusively, an empty file is an empty database for SQLite.
+    std::FILE *f = std::fopen(_d->_path.string().c_str(), "wbx");
+    if (!f)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to create backup file '%s', it may exist already."_en,
+                              "Ошибка при создании файла резервной копии '%s', возможно, он уже существует."_ru),
+                        _d->_path.string().c_str());
+    std::fclose(f);
+    _d->_created = true;
+
+    tim::app()->set_busy(true);
+
+    const int res = sqlite3_open_v2(_d->_path.string().c_str(), &_d->_dst,
+                                    SQLITE_OPEN_READWRITE,
+                                    nullptr);
+    if (res != SQLITE_OK)
+    {
+        _d->close(true);
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to open database '%s': %s"_en,
+                              "Ошибка при открытии базы данных '%s': %s"_ru),
+                        _d->_path.string().c_str(),
+                        sqlite3_errstr(res));
+    }
+
+    if (!(_d->_backup = sqlite3_backup_init(_d->_dst, "main", _d->_db->sqlite(), "main")))
+    {
+        TIM_TRACE(Error,
+                 TIM_TR("Failed to initialize backup for database '%s': %s"_en,
+                       "Ошибка при инициализации резервного копирования базы данных '%s': %s"_ru),
+                 _d->_path.string().c_str(),
+                 sqlite3_errmsg(_d->_dst));
+        _d->close(true);
+        return false;
+    }
+
+    TIM_TRACE(Info,
+             TIM_TR("Backing up database '%s' to '%s' ..."_en,
+                   "Резервное копирование базы данных '%s' в '%s' ..."_ru),
+             _d->_db->path().string().c_str(),
+             _d->_path.string().c_str());
+
+    return true;
+}
+
+/**
+ * Cancels the backup if it was started by \a owner, or if \a owner
+ * is null, which is for the application itself.
+ */
+bool tim::sqlite_backup::cancel(const void *owner)
+{
+    if (!running())
+        return true;
+
+    if (owner
+            && owner != _d->_owner)
+        return TIM_TRACE(Error,
+                        TIM_TR("Backup to '%s' was started by someone else."_en,
+                              "Резервное копирование в '%s' запущено кем-то другим."_ru),
+                        _d->_path.string().c_str());
+
+    sqlite3_backup_finish(_d->_backup);
+    _d->_backup = nullptr;
+    _d->close(true);
+
+    TIM_TRACE(Info,
+             TIM_TR("Backup to '%s' is cancelled."_en,
+                   "Резервное копирование в '%s' отменено."_ru),
+             _d->_path.string().c_str());
+
+    finished(false);
+
+    return true;
+}
+
+bool tim::sqlite_backup::running() const
+{
+    return _d->_backup;
+}
+
+const void *tim::sqlite_backup::owner() const
+{
+    return _d->_owner;
+}
+
+const std::filesystem::path &tim::sqlite_backup::path() const
+{
+    return _d->_path;
+}
+
+int tim::sqlite_backup::remaining_page_count() const
+{
+    return _d->_remaining;
+}
+
+int tim::sqlite_backup::total_page_count() const
+{
+    return _d->_total;
+}
+
+
+// Private
+
+void tim::p::sqlite_backup::on_timer(void *self)
+{
+    tim::p::sqlite_backup *d = (tim::p::sqlite_backup *)self;
+    assert(d);
+
+    if (!d->_backup)
+        return;
+
+    const int res = sqlite3_backup_step(d->_backup, tim::DB_BACKUP_PAGES_PER_STEP);
+
+    d->_remaining = sqlite3_backup_remaining(d->_backup);
+    d->_total = sqlite3_backup_pagecount(d->_backup);
+    if (d->_progress)
+        d->_progress(d->_remaining, d->_total);
+
+    switch (res)
+    {
+        case SQLITE_OK:
+        case SQLITE_BUSY:
+        case SQLITE_LOCKED:
+            // Try again on the next tick.
+            return;
+
+        default:
+            break;
+    }
+
+    const bool ok = d->finish();
+    d->_q->finished(ok);
+}
+
+std::filesystem::path tim::p::sqlite_backup::default_path(const tim::sqlite_db *db)
+{
+    const std::time_t now = std::time(nullptr);
+    std::tm tm;
+    localtime_r(&now, &tm);
+
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+
+    return db->path().parent_path()
+            / tim::DB_BACKUP_DIR_NAME
+            / (db->path().stem().string() + '-' + stamp + ".db");
+}
+
+bool tim::p::sqlite_backup::finish()
+{
+    const int res = sqlite3_backup_finish(_backup);
+    _backup = nullptr;
+    close(res != SQLITE_OK);
+
+    if (res != SQLITE_OK)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to finish backup for database '%s': %s"_en,
+                              "Ошибка при завершении резервного копирования базы данных '%s': %s"_ru),
+                        _path.string().c_str(),
+                        sqlite3_errstr(res));
+
+    TIM_TRACE(Info,
+             TIM_TR("Database backup '%s' is done."_en,
+                   "Резервная копия базы данных '%s' создана."_ru),
+             _path.string().c_str());
+
+    return true;
+}
+
+void tim::p::sqlite_backup::close(bool remove)
+{
+    sqlite3_close_v2(_dst);
+    _dst = nullptr;
+
+    tim::app()->set_busy(false);
+
+    if (remove
+            && _created)
+    {
+        std::error_code ec;
+        std::filesystem::remove(_path, ec);
+    }
+
+    _created = false;
+    _owner = nullptr;
+}
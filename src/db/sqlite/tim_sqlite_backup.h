@@ -0,0 +1,62 @@
+#pragma once
+
+#include "tim_signal.h"
+#include "tim_sqlite_db.h"
+
+#include <filesystem>
+#include <memory>
+
+
+struct mg_mgr;
+
+namespace tim
+{
+
+namespace p
+{
+
+struct sqlite_backup;
+
+}
+
+/**
+ * Online backup of a database that does not block the event loop.
+ *
+ * Copies DB_BACKUP_PAGES_PER_STEP pages per timer tick. Changes made
+ * to the database through the same connection during the backup are
+ * picked up by SQLite; the pages changed by other connections make it
+ * start over.
+ *
+ * The copy is a new timestamped file in the DB_BACKUP_DIR_NAME folder
+ * next to the database. An existing file is never written over, and
+ * only the file made by the backup is removed when it fails.
+ *
+ * The owner, if any, is only compared: a backup started on behalf of
+ * someone is cancelled by them only, see cancel().
+ */
+class sqlite_backup
+{
+
+public:
+
+    tim::signal<bool /* ok */> finished;
+
+    sqlite_backup(mg_mgr *mg, const tim::sqlite_db *db);
+    ~sqlite_backup();
+
+    bool start(const void *owner = nullptr,
+               tim::sqlite_db::backup_progress_fn fn = nullptr);
+    bool cancel(const void *owner = nullptr);
+
+    bool running() const;
+    const void *owner() const;
+    const std::filesystem::path &path() const;
+    int remaining_page_count() const;
+    int total_page_count() const;
+
+private:
+
+    std::unique_ptr<tim::p::sqlite_backup> _d;
+};
+
+}
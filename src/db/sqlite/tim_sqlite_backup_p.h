@@ -0,0 +1,44 @@
+#pragma once
+
+#include "tim_sqlite_backup.h"
+
+#include <cassert>
+
+
+struct mg_timer;
+struct sqlite3;
+struct sqlite3_backup;
+
+namespace tim::p
+{
+
+struct sqlite_backup
+{
+    explicit sqlite_backup(tim::sqlite_backup *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    static void on_timer(void *self);
+    static std::filesystem::path default_path(const tim::sqlite_db *db);
+
+    bool finish();
+    void close(bool remove);
+
+    tim::sqlite_backup *const _q;
+
+    mg_mgr *_mg = nullptr;
+    const tim::sqlite_db *_db = nullptr;
+    mg_timer *_timer = nullptr;
+    sqlite3 *_dst = nullptr;
+    sqlite3_backup *_backup = nullptr;
+    std::filesystem::path _path;
+    bool _created = false; // The file at _path is ours to remove.
+    const void *_owner = nullptr;
+    tim::sqlite_db::backup_progress_fn _progress;
+    int _remaining = 0;
+    int _total = 0;
+};
+
+}
@@ -0,0 +1,707 @@
+#include "tim_sqlite_crypt.h"
+
+#include "tim_sqlite_crypt_p.h"
+
+#include "tim_config.h"
+#include "tim_file_tools.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+#include "tim_uuid.h"
+
+#include "mbedtls/pkcs5.h"
+#include "mbedtls/platform_util.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+
+static const char VFS_NAME[] = "tim-crypt";
+static const char SALT[] = "tim-crypt"; // Of databases encrypted before the salt files.
+static const char SALT_SUFFIX[] = "-salt";
+static const char SIGNATURE[] = "SQLite format 3"; // With the terminating zero, as in the file.
+static const int WAL_HEADER_SIZE = 32;
+static const int WAL_FRAME_HEADER_SIZE = 24;
+
+static const sqlite3_io_methods IO_METHODS =
+{
+    2, // No xFetch(), mapped pages would bypass decryption.
+    &tim::p::sqlite_crypt::close,
+    &tim::p::sqlite_crypt::read,
+    &tim::p::sqlite_crypt::write,
+    &tim::p::sqlite_crypt::truncate,
+    &tim::p::sqlite_crypt::sync,
+    &tim::p::sqlite_crypt::file_size,
+    &tim::p::sqlite_crypt::lock,
+    &tim::p::sqlite_crypt::unlock,
+    &tim::p::sqlite_crypt::check_reserved_lock,
+    &tim::p::sqlite_crypt::file_control,
+    &tim::p::sqlite_crypt::sector_size,
+    &tim::p::sqlite_crypt::device_characteristics,
+    &tim::p::sqlite_crypt::shm_map,
+    &tim::p::sqlite_crypt::shm_lock,
+    &tim::p::sqlite_crypt::shm_barrier,
+    &tim::p::sqlite_crypt::shm_unmap,
+    nullptr,
+    nullptr
+};
+
+
+// Public
+
+bool tim::sqlite_crypt::install()
+{
+    if (sqlite3_vfs_find(VFS_NAME))
+        return true;
+
+    sqlite3_vfs *root = sqlite3_vfs_find(nullptr);
+    if (!root)
+        return TIM_TRACE(Error,
+                        TIM_TR("No default SQLite VFS to encrypt."_en,
+                              "Нет стандартной файловой системы SQLite для шифрования."_ru));
+
+    sqlite3_vfs &vfs = tim::p::sqlite_crypt::vfs();
+    vfs = *root;
+    vfs.szOsFile = sizeof(tim::p::sqlite_crypt_file) + root->szOsFile;
+    vfs.pNext = nullptr;
+    vfs.zName = VFS_NAME;
+    vfs.pAppData = root;
+    vfs.xOpen = &tim::p::sqlite_crypt::open;
+
+    const int res = sqlite3_vfs_register(&vfs, 1);
+    if (res != SQLITE_OK)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to register SQLite VFS '%s': %s"_en,
+                              "Ошибка при регистрации файловой системы SQLite '%s': %s"_ru),
+                        VFS_NAME,
+                        sqlite3_errstr(res));
+
+    return true;
+}
+
+bool tim::sqlite_crypt::set_key(const std::string &key)
+{
+    assert(!key.empty());
+
+    const std::lock_guard<std::mutex> lock(tim::p::sqlite_crypt::mutex());
+
+    // Keys are derived per database salt, so the passphrase is kept.
+    std::list<tim::p::sqlite_crypt_passphrase> &passphrases = tim::p::sqlite_crypt::passphrases();
+    std::list<tim::p::sqlite_crypt_passphrase>::iterator it = std::find_if(passphrases.begin(), passphrases.end(),
+        [&key](const tim::p::sqlite_crypt_passphrase &p)
+        {
+            return p._text == key;
+        });
+
+    if (it == passphrases.end())
+    {
+        passphrases.emplace_back()._text = key;
+        it = std::prev(passphrases.end());
+    }
+
+    tim::p::sqlite_crypt::current_passphrase() = &*it;
+
+    return true;
+}
+
+void tim::sqlite_crypt::clear_key()
+{
+    const std::lock_guard<std::mutex> lock(tim::p::sqlite_crypt::mutex());
+    tim::p::sqlite_crypt::current_passphrase() = nullptr;
+}
+
+bool tim::sqlite_crypt::has_key()
+{
+    const std::lock_guard<std::mutex> lock(tim::p::sqlite_crypt::mutex());
+    return !tim::p::sqlite_crypt::passphrases().empty();
+}
+
+bool tim::sqlite_crypt::reencrypt(const std::filesystem::path &path)
+{
+    const std::lock_guard<std::mutex> lock(tim::p::sqlite_crypt::mutex());
+
+    std::error_code ec;
+    for (const char *suffix: {"-wal", "-journal"})
+        if (std::filesystem::file_size(path.string() + suffix, ec) > 0
+                && !ec)
+            return TIM_TRACE(Error,
+                            TIM_TR("Database '%s' has changes pending in '%s'."_en,
+                                  "У базы данных '%s' есть незавершенные изменения в '%s'."_ru),
+                            path.string().c_str(),
+                            (path.string() + suffix).c_str());
+
+    std::ifstream is(path, std::ios::binary);
+    if (!is)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to open file '%s'."_en,
+                              "Ошибка при открытии файла '%s'."_ru),
+                        path.string().c_str());
+
+    std::vector<std::uint8_t> page(tim::DB_PAGE_SIZE);
+    if (!is.read((char *)page.data(), page.size()))
+    {
+        if (!is.gcount())
+            return true;
+
+        return TIM_TRACE(Error,
+                        TIM_TR("Database file '%s' is corrupted."_en,
+                              "Файл базы данных '%s' поврежден."_ru),
+                        path.string().c_str());
+    }
+
+    const tim::p::sqlite_crypt_key *from;
+    if (!tim::p::sqlite_crypt::detect(path.string(), page.data(), from))
+        return TIM_TRACE(Error,
+                        TIM_TR("No key decrypts database '%s'."_en,
+                              "Ни один ключ не подходит к базе данных '%s'."_ru),
+                        path.string().c_str());
+
+    if (!from
+            && !tim::p::sqlite_crypt::current_passphrase())
+        return true;
+
+    const int page_size = tim::p::sqlite_crypt::page_size(from, page.data());
+    if (page_size != tim::DB_PAGE_SIZE)
+        return TIM_TRACE(Error,
+                        TIM_TR("Database '%s' has %d byte pages, only %d byte ones are encrypted."_en,
+                              "В базе данных '%s' страницы по %d байт, шифруются только страницы по %d байт."_ru),
+                        path.string().c_str(),
+                        page_size,
+                        tim::DB_PAGE_SIZE);
+
+    const tim::p::sqlite_crypt_key *to;
+    if (!tim::p::sqlite_crypt::target_key(path.string(), to))
+        return false;
+
+    if (from == to)
+        return true;
+
+    const std::filesystem::path tmp_path = path.string() + "-rekey";
+    std::ofstream os(tmp_path, std::ios::binary | std::ios::trunc);
+
+    sqlite3_int64 offset = 0;
+    do
+    {
+        if (from)
+            tim::p::sqlite_crypt::decrypt(from, offset, page.data(), page.data());
+        if (to)
+            tim::p::sqlite_crypt::encrypt(to, offset, page.data(), page.data());
+
+        os.write((const char *)page.data(), page.size());
+        offset += page.size();
+    }
+    while (os
+                && is.read((char *)page.data(), page.size()));
+
+    os.close();
+
+    if (!os
+            || is.gcount())
+    {
+        std::filesystem::remove(tmp_path, ec);
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to re-encrypt database '%s'."_en,
+                              "Ошибка при перешифровании базы данных '%s'."_ru),
+                        path.string().c_str());
+    }
+
+    is.close();
+
+    // The new file has to be on disk before it replaces the old one.
+    if (!tim::sync_file(tmp_path))
+    {
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to rename '%s' to '%s': %s"_en,
+                              "Ошибка при переименовании '%s' в '%s': %s"_ru),
+                        tmp_path.string().c_str(),
+                        path.string().c_str(),
+                        ec.message().c_str());
+
+    return tim::sync_file(path.has_parent_path()
+                              ? path.parent_path()
+                              : std::filesystem::path("."));
+}
+
+
+// Private
+
+tim::p::sqlite_crypt_passphrase::~sqlite_crypt_passphrase()
+{
+    mbedtls_platform_zeroize(_text.data(), _text.size());
+}
+
+tim::p::sqlite_crypt_key::~sqlite_crypt_key()
+{
+    mbedtls_aes_xts_free(&_enc);
+    mbedtls_aes_xts_free(&_dec);
+    mbedtls_platform_zeroize(_secret.data(), _secret.size());
+}
+
+std::filesystem::path tim::p::sqlite_crypt::salt_path(const std::string &db)
+{
+    return db + SALT_SUFFIX;
+}
+
+bool tim::p::sqlite_crypt::read_salt(const std::string &db, std::string &salt)
+{
+    const std::filesystem::path path = salt_path(db);
+
+    std::error_code ec;
+    return std::filesystem::exists(path, ec)
+                && tim::read_file(path, salt)
+                && !salt.empty();
+}
+
+bool tim::p::sqlite_crypt::make_salt(const std::string &db, std::string &salt)
+{
+    // An existing salt is kept, so a database re-encrypted halfway still opens.
+    if (read_salt(db, salt))
+        return true;
+
+    const std::filesystem::path path = salt_path(db);
+    salt = tim::uuid::create().to_string();
+
+    return tim::write_to_file(path, salt)
+                && tim::sync_file(path)
+                && tim::sync_file(path.has_parent_path()
+                                      ? path.parent_path()
+                                      : std::filesystem::path("."));
+}
+
+const tim::p::sqlite_crypt_key *tim::p::sqlite_crypt::derive(const tim::p::sqlite_crypt_passphrase *passphrase,
+                                                             const std::string &salt)
+{
+    assert(passphrase);
+
+    std::list<tim::p::sqlite_crypt_key> &keys = tim::p::sqlite_crypt::keys();
+    for (const tim::p::sqlite_crypt_key &k: keys)
+        if (k._passphrase == passphrase
+                && k._salt == salt)
+            return &k;
+
+    std::array<std::uint8_t, 64> secret;
+    int res = mbedtls_pkcs5_pbkdf2_hmac_ext(MBEDTLS_MD_SHA256,
+                                            (const unsigned char *)passphrase->_text.data(),
+                                            passphrase->_text.size(),
+                                            (const unsigned char *)salt.data(), salt.size(),
+                                            tim::DB_KEY_ITERATIONS,
+                                            secret.size(), secret.data());
+    if (res)
+    {
+        TIM_TRACE(Error,
+                 TIM_TR("Failed to derive database encryption key: %d"_en,
+                       "Ошибка при создании ключа шифрования базы данных: %d"_ru),
+                 res);
+        return nullptr;
+    }
+
+    tim::p::sqlite_crypt_key &k = keys.emplace_back();
+    k._passphrase = passphrase;
+    k._salt = salt;
+    k._secret = secret;
+    mbedtls_platform_zeroize(secret.data(), secret.size());
+
+    if ((res = mbedtls_aes_xts_setkey_enc(&k._enc, k._secret.data(), k._secret.size() * 8))
+            || (res = mbedtls_aes_xts_setkey_dec(&k._dec, k._secret.data(), k._secret.size() * 8)))
+    {
+        keys.pop_back();
+        TIM_TRACE(Error,
+                 TIM_TR("Failed to set database encryption key: %d"_en,
+                       "Ошибка при задании ключа шифрования базы данных: %d"_ru),
+                 res);
+        return nullptr;
+    }
+
+    return &k;
+}
+
+bool tim::p::sqlite_crypt::target_key(const std::string &db, const tim::p::sqlite_crypt_key *&key)
+{
+    key = nullptr;
+    if (!current_passphrase())
+        return true;
+
+    std::string salt;
+    if (!make_salt(db, salt))
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to create encryption salt for database '%s'."_en,
+                              "Ошибка при создании соли шифрования для базы данных '%s'."_ru),
+                        db.c_str());
+
+    key = derive(current_passphrase(), salt);
+    return key;
+}
+
+bool tim::p::sqlite_crypt::detect(const std::string &db, const std::uint8_t *page, const tim::p::sqlite_crypt_key *&key)
+{
+    key = nullptr;
+    if (!std::memcmp(page, SIGNATURE, sizeof(SIGNATURE)))
+        return true;
+
+    std::vector<std::string> salts;
+    std::string salt;
+    if (read_salt(db, salt))
+        salts.emplace_back(salt);
+    salts.emplace_back(SALT);
+
+    // The first XTS block decrypts on its own.
+    std::uint8_t head[sizeof(SIGNATURE)];
+    std::uint8_t unit[16] = {};
+    for (const std::string &s: salts)
+        for (const tim::p::sqlite_crypt_passphrase &p: passphrases())
+        {
+            const tim::p::sqlite_crypt_key *k = derive(&p, s);
+            if (k
+                    && !mbedtls_aes_crypt_xts(const_cast<mbedtls_aes_xts_context *>(&k->_dec),
+                                              MBEDTLS_AES_DECRYPT, sizeof(head), unit, page, head)
+                    && !std::memcmp(head, SIGNATURE, sizeof(SIGNATURE)))
+            {
+                key = k;
+                return true;
+            }
+        }
+
+    return false;
+}
+
+int tim::p::sqlite_crypt::page_size(const tim::p::sqlite_crypt_key *key, const std::uint8_t *page)
+{
+    // The page size is the big-endian 16-bit value at offset 16, 1 means 65536.
+    std::uint8_t head[32];
+    std::uint8_t unit[16] = {};
+    if (!key)
+        std::memcpy(head, page, sizeof(head));
+    else if (mbedtls_aes_crypt_xts(const_cast<mbedtls_aes_xts_context *>(&key->_dec),
+                                   MBEDTLS_AES_DECRYPT, sizeof(head), unit, page, head))
+        return 0;
+
+    const int size = (head[16] << 8) | head[17];
+    return size == 1
+               ? 65536
+               : size;
+}
+
+void tim::p::sqlite_crypt::encrypt(const tim::p::sqlite_crypt_key *key, sqlite3_int64 offset,
+                                   const std::uint8_t *src, std::uint8_t *dst)
+{
+    std::uint8_t unit[16] = {};
+    for (std::size_t i = 0; i < 8; ++i)
+        unit[i] = (std::uint8_t)(offset >> (i * 8));
+
+    mbedtls_aes_crypt_xts(const_cast<mbedtls_aes_xts_context *>(&key->_enc),
+                          MBEDTLS_AES_ENCRYPT, tim::DB_PAGE_SIZE, unit, src, dst);
+}
+
+void tim::p::sqlite_crypt::decrypt(const tim::p::sqlite_crypt_key *key, sqlite3_int64 offset,
+                                   const std::uint8_t *src, std::uint8_t *dst)
+{
+    std::uint8_t unit[16] = {};
+    for (std::size_t i = 0; i < 8; ++i)
+        unit[i] = (std::uint8_t)(offset >> (i * 8));
+
+    mbedtls_aes_crypt_xts(const_cast<mbedtls_aes_xts_context *>(&key->_dec),
+                          MBEDTLS_AES_DECRYPT, tim::DB_PAGE_SIZE, unit, src, dst);
+}
+
+bool tim::p::sqlite_crypt::next_page(int kind, sqlite3_int64 pos,
+                                     sqlite3_int64 offset, int size,
+                                     sqlite3_int64 &page)
+{
+    const sqlite3_int64 end = offset + size;
+
+    switch (kind)
+    {
+        case SQLITE_OPEN_MAIN_DB:
+            page = pos / tim::DB_PAGE_SIZE * tim::DB_PAGE_SIZE;
+            return page < end;
+
+        case SQLITE_OPEN_WAL:
+        {
+            const sqlite3_int64 first = WAL_HEADER_SIZE + WAL_FRAME_HEADER_SIZE;
+            const sqlite3_int64 frame_size = WAL_FRAME_HEADER_SIZE + tim::DB_PAGE_SIZE;
+
+            page = first;
+            if (pos > first)
+            {
+                page += (pos - first) / frame_size * frame_size;
+                if (page + tim::DB_PAGE_SIZE <= pos)
+                    page += frame_size;
+            }
+
+            return page < end;
+        }
+
+        case SQLITE_OPEN_MAIN_JOURNAL:
+            // A page follows its 4-byte number in a record, while journal headers
+            // are sector aligned, so pages are the page-sized pieces at 4 mod 8.
+            page = offset;
+            return pos == offset
+                        && size == tim::DB_PAGE_SIZE
+                        && offset % 8 == 4;
+
+        default:
+            return false;
+    }
+}
+
+int tim::p::sqlite_crypt::open(sqlite3_vfs *vfs, sqlite3_filename name, sqlite3_file *file, int flags, int *out_flags)
+{
+    sqlite3_vfs *root = (sqlite3_vfs *)vfs->pAppData;
+
+    const std::lock_guard<std::mutex> lock(mutex());
+
+    const int kind = flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_WAL | SQLITE_OPEN_MAIN_JOURNAL);
+    if (!kind
+            || !name
+            || passphrases().empty())
+        return root->xOpen(root, name, file, flags, out_flags);
+
+    tim::p::sqlite_crypt_file *f = (tim::p::sqlite_crypt_file *)file;
+    std::memset(f, 0, sizeof(*f));
+    f->_file = (sqlite3_file *)(f + 1);
+    f->_kind = kind;
+
+    int res = root->xOpen(root, name, f->_file, flags, out_flags);
+    if (res != SQLITE_OK)
+    {
+        if (f->_file->pMethods)
+            f->_file->pMethods->xClose(f->_file);
+        return res;
+    }
+
+    f->_page = new std::uint8_t[tim::DB_PAGE_SIZE];
+
+    if (kind == SQLITE_OPEN_MAIN_DB)
+    {
+        bool ok = true;
+        sqlite3_int64 size = 0;
+        if (f->_file->pMethods->xFileSize(f->_file, &size) == SQLITE_OK
+                && size > 0)
+        {
+            // Without a key that decrypts it the file is read as it is and
+            // fails as a database that is not one.
+            res = f->_file->pMethods->xRead(f->_file, f->_page, tim::DB_PAGE_SIZE, 0);
+            if ((res == SQLITE_OK
+                        || res == SQLITE_IOERR_SHORT_READ)
+                    && detect(name, f->_page, f->_key)
+                    && f->_key
+                    && page_size(f->_key, f->_page) != tim::DB_PAGE_SIZE)
+                ok = TIM_TRACE(Error,
+                              TIM_TR("Encrypted database '%s' does not have %d byte pages."_en,
+                                    "В зашифрованной базе данных '%s' страницы не по %d байт."_ru),
+                              name,
+                              tim::DB_PAGE_SIZE);
+        }
+        else
+        {
+            ok = target_key(name, f->_key);
+        }
+
+        if (!ok)
+        {
+            delete[] f->_page;
+            f->_file->pMethods->xClose(f->_file);
+            return SQLITE_CANTOPEN;
+        }
+
+        databases()[name] = f->_key;
+    }
+    else
+    {
+        std::map<std::string, const tim::p::sqlite_crypt_key *>::const_iterator it =
+            databases().find(sqlite3_filename_database(name));
+        if (it != databases().end())
+            f->_key = it->second;
+    }
+
+    f->_base.pMethods = &IO_METHODS;
+
+    return SQLITE_OK;
+}
+
+int tim::p::sqlite_crypt::close(sqlite3_file *file)
+{
+    tim::p::sqlite_crypt_file *f = (tim::p::sqlite_crypt_file *)file;
+
+    delete[] f->_page;
+    f->_page = nullptr;
+
+    return f->_file->pMethods->xClose(f->_file);
+}
+
+int tim::p::sqlite_crypt::read(sqlite3_file *file, void *data, int size, sqlite3_int64 offset)
+{
+    tim::p::sqlite_crypt_file *f = (tim::p::sqlite_crypt_file *)file;
+
+    int res = f->_file->pMethods->xRead(f->_file, data, size, offset);
+    if (!f->_key
+            || (res != SQLITE_OK
+                    && res != SQLITE_IOERR_SHORT_READ))
+        return res;
+
+    // Past the end of the file SQLite expects zeros, which must stay zeros.
+    sqlite3_int64 end = offset + size;
+    if (res == SQLITE_IOERR_SHORT_READ)
+    {
+        sqlite3_int64 file_size = 0;
+        f->_file->pMethods->xFileSize(f->_file, &file_size);
+        end = std::min(end, file_size);
+    }
+
+    std::uint8_t *dst = (std::uint8_t *)data;
+    sqlite3_int64 page;
+    for (sqlite3_int64 pos = offset;
+            next_page(f->_kind, pos, offset, size, page);
+            pos = page + tim::DB_PAGE_SIZE)
+    {
+        const sqlite3_int64 from = std::max(page, offset);
+        const sqlite3_int64 to = std::min(page + tim::DB_PAGE_SIZE, offset + size);
+
+        if (page + tim::DB_PAGE_SIZE > end)
+        {
+            std::memset(dst + (from - offset), 0, to - from);
+        }
+        else if (from == page
+                    && to == page + tim::DB_PAGE_SIZE)
+        {
+            decrypt(f->_key, page, dst + (page - offset), dst + (page - offset));
+        }
+        else
+        {
+            const int r = f->_file->pMethods->xRead(f->_file, f->_page, tim::DB_PAGE_SIZE, page);
+            if (r != SQLITE_OK)
+                return r;
+
+            decrypt(f->_key, page, f->_page, f->_page);
+            std::memcpy(dst + (from - offset), f->_page + (from - page), to - from);
+        }
+    }
+
+    return res;
+}
+
+int tim::p::sqlite_crypt::write(sqlite3_file *file, const void *data, int size, sqlite3_int64 offset)
+{
+    tim::p::sqlite_crypt_file *f = (tim::p::sqlite_crypt_file *)file;
+
+    if (!f->_key)
+        return f->_file->pMethods->xWrite(f->_file, data, size, offset);
+
+    // SQLite writes pages whole, so partial ones are not supported.
+    bool has_pages = false;
+    sqlite3_int64 page;
+    for (sqlite3_int64 pos = offset;
+            next_page(f->_kind, pos, offset, size, page);
+            pos = page + tim::DB_PAGE_SIZE)
+    {
+        if (page < offset
+                || page + tim::DB_PAGE_SIZE > offset + size)
+            return SQLITE_IOERR_WRITE;
+        has_pages = true;
+    }
+
+    if (!has_pages)
+        return f->_file->pMethods->xWrite(f->_file, data, size, offset);
+
+    std::vector<std::uint8_t> buffer;
+    std::uint8_t *dst = f->_page;
+    if (size > tim::DB_PAGE_SIZE)
+    {
+        buffer.resize(size);
+        dst = buffer.data();
+    }
+
+    std::memcpy(dst, data, size);
+    for (sqlite3_int64 pos = offset;
+            next_page(f->_kind, pos, offset, size, page);
+            pos = page + tim::DB_PAGE_SIZE)
+        encrypt(f->_key, page, dst + (page - offset), dst + (page - offset));
+
+    return f->_file->pMethods->xWrite(f->_file, dst, size, offset);
+}
+
+int tim::p::sqlite_crypt::truncate(sqlite3_file *file, sqlite3_int64 size)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xTruncate(real, size);
+}
+
+int tim::p::sqlite_crypt::sync(sqlite3_file *file, int flags)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xSync(real, flags);
+}
+
+int tim::p::sqlite_crypt::file_size(sqlite3_file *file, sqlite3_int64 *size)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xFileSize(real, size);
+}
+
+int tim::p::sqlite_crypt::lock(sqlite3_file *file, int lock)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xLock(real, lock);
+}
+
+int tim::p::sqlite_crypt::unlock(sqlite3_file *file, int lock)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xUnlock(real, lock);
+}
+
+int tim::p::sqlite_crypt::check_reserved_lock(sqlite3_file *file, int *out)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xCheckReservedLock(real, out);
+}
+
+int tim::p::sqlite_crypt::file_control(sqlite3_file *file, int op, void *arg)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xFileControl(real, op, arg);
+}
+
+int tim::p::sqlite_crypt::sector_size(sqlite3_file *file)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xSectorSize(real);
+}
+
+int tim::p::sqlite_crypt::device_characteristics(sqlite3_file *file)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xDeviceCharacteristics(real);
+}
+
+int tim::p::sqlite_crypt::shm_map(sqlite3_file *file, int region, int region_size, int extend, void volatile **p)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xShmMap(real, region, region_size, extend, p);
+}
+
+int tim::p::sqlite_crypt::shm_lock(sqlite3_file *file, int offset, int n, int flags)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xShmLock(real, offset, n, flags);
+}
+
+void tim::p::sqlite_crypt::shm_barrier(sqlite3_file *file)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    real->pMethods->xShmBarrier(real);
+}
+
+int tim::p::sqlite_crypt::shm_unmap(sqlite3_file *file, int remove)
+{
+    sqlite3_file *real = ((tim::p::sqlite_crypt_file *)file)->_file;
+    return real->pMethods->xShmUnmap(real, remove);
+}
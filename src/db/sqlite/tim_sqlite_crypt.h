@@ -0,0 +1,41 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+
+namespace tim
+{
+
+/**
+ * Encrypting SQLite VFS, installed as the default one.
+ *
+ * Page images in databases, WAL files and rollback journals are encrypted
+ * with AES-256-XTS, the tweak being the offset of the page in its file, so
+ * every page is encrypted differently and keeps its size. WAL frame and
+ * journal record headers are left as they are. Encrypted files are not
+ * memory mapped. mbedtls uses AES-NI when the CPU has it.
+ *
+ * Keys are derived from passphrases with PBKDF2-HMAC-SHA256 and a random
+ * salt kept next to the database in a "-salt" file. Every passphrase set
+ * since startup is remembered: an existing database is opened with the one
+ * that decrypts its first page, new databases get the current one. Plain
+ * databases stay plain and databases encrypted with the former shared salt
+ * keep it until re-encrypted. Only databases of tim::DB_PAGE_SIZE pages are
+ * encrypted.
+ */
+class sqlite_crypt
+{
+
+public:
+
+    static bool install();
+
+    static bool set_key(const std::string &key);
+    static void clear_key();
+    static bool has_key();
+
+    static bool reencrypt(const std::filesystem::path &path);
+};
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "tim_sqlite_crypt.h"
+
+#include "mbedtls/aes.h"
+#include "sqlite3.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+
+namespace tim::p
+{
+
+struct sqlite_crypt_passphrase
+{
+    ~sqlite_crypt_passphrase();
+
+    std::string _text;
+};
+
+struct sqlite_crypt_key
+{
+    sqlite_crypt_key()
+    {
+        mbedtls_aes_xts_init(&_enc);
+        mbedtls_aes_xts_init(&_dec);
+    }
+
+    ~sqlite_crypt_key();
+
+    sqlite_crypt_key(const sqlite_crypt_key &) = delete;
+    sqlite_crypt_key &operator=(const sqlite_crypt_key &) = delete;
+
+    const tim::p::sqlite_crypt_passphrase *_passphrase = nullptr;
+    std::string _salt;
+    std::array<std::uint8_t, 64> _secret; // Two AES-256 keys.
+    mbedtls_aes_xts_context _enc;
+    mbedtls_aes_xts_context _dec;
+};
+
+struct sqlite_crypt_file
+{
+    sqlite3_file _base; // Must go first.
+    sqlite3_file *_file; // The real file, allocated right after this struct.
+    const tim::p::sqlite_crypt_key *_key; // nullptr for a plain file.
+    int _kind; // SQLITE_OPEN_MAIN_DB, SQLITE_OPEN_WAL or SQLITE_OPEN_MAIN_JOURNAL.
+    std::uint8_t *_page;
+};
+
+struct sqlite_crypt
+{
+    // The files of the shards are opened by their writer threads too.
+    static std::mutex &mutex()
+    {
+        static std::mutex _mutex;
+        return _mutex;
+    }
+
+    static std::list<tim::p::sqlite_crypt_passphrase> &passphrases()
+    {
+        static std::list<tim::p::sqlite_crypt_passphrase> _passphrases;
+        return _passphrases;
+    }
+
+    static const tim::p::sqlite_crypt_passphrase *&current_passphrase()
+    {
+        static const tim::p::sqlite_crypt_passphrase *_passphrase = nullptr;
+        return _passphrase;
+    }
+
+    // Derived on demand, one per passphrase and salt.
+    static std::list<tim::p::sqlite_crypt_key> &keys()
+    {
+        static std::list<tim::p::sqlite_crypt_key> _keys;
+        return _keys;
+    }
+
+    // Database file name to the key it is encrypted with, for its WAL and journals.
+    static std::map<std::string, const tim::p::sqlite_crypt_key *> &databases()
+    {
+        static std::map<std::string, const tim::p::sqlite_crypt_key *> _databases;
+        return _databases;
+    }
+
+    static sqlite3_vfs &vfs()
+    {
+        static sqlite3_vfs _vfs;
+        return _vfs;
+    }
+
+    static std::filesystem::path salt_path(const std::string &db);
+    static bool read_salt(const std::string &db, std::string &salt);
+    static bool make_salt(const std::string &db, std::string &salt);
+    static const tim::p::sqlite_crypt_key *derive(const tim::p::sqlite_crypt_passphrase *passphrase,
+                                                  const std::string &salt);
+    static bool target_key(const std::string &db, const tim::p::sqlite_crypt_key *&key);
+
+    static bool detect(const std::string &db, const std::uint8_t *page, const tim::p::sqlite_crypt_key *&key);
+    static int page_size(const tim::p::sqlite_crypt_key *key, const std::uint8_t *page);
+    static void encrypt(const tim::p::sqlite_crypt_key *key, sqlite3_int64 offset,
+                        const std::uint8_t *src, std::uint8_t *dst);
+    static void decrypt(const tim::p::sqlite_crypt_key *key, sqlite3_int64 offset,
+                        const std::uint8_t *src, std::uint8_t *dst);
+    static bool next_page(int kind, sqlite3_int64 pos, sqlite3_int64 offset, int size, sqlite3_int64 &page);
+
+    static int open(sqlite3_vfs *vfs, sqlite3_filename name, sqlite3_file *file, int flags, int *out_flags);
+
+    static int close(sqlite3_file *file);
+    static int read(sqlite3_file *file, void *data, int size, sqlite3_int64 offset);
+    static int write(sqlite3_file *file, const void *data, int size, sqlite3_int64 offset);
+    static int truncate(sqlite3_file *file, sqlite3_int64 size);
+    static int sync(sqlite3_file *file, int flags);
+    static int file_size(sqlite3_file *file, sqlite3_int64 *size);
+    static int lock(sqlite3_file *file, int lock);
+    static int unlock(sqlite3_file *file, int lock);
+    static int check_reserved_lock(sqlite3_file *file, int *out);
+    static int file_control(sqlite3_file *file, int op, void *arg);
+    static int sector_size(sqlite3_file *file);
+    static int device_characteristics(sqlite3_file *file);
+    static int shm_map(sqlite3_file *file, int region, int region_size, int extend, void volatile **p);
+    static int shm_lock(sqlite3_file *file, int offset, int n, int flags);
+    static void shm_barrier(sqlite3_file *file);
+    static int shm_unmap(sqlite3_file *file, int remove);
+};
+
+}
@@ -4,6 +4,9 @@
 
 #include "tim_config.h"
 #include "tim_file_tools.h"
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+#   include "tim_sqlite_crypt.h"
+#endif
 #include "tim_sqlite_query.h"
 #include "tim_string_tools.h"
 #include "tim_trace.h"
@@ -14,6 +17,7 @@
 #include <cassert>
 #include <fstream>
 #include <thread>
+#include <vector>
 
 #ifdef TIM_OS_LINUX
 #   include <endian.h>
@@ -33,7 +37,8 @@ static const int SLEEP = 250; // In milliseconds.
 // Public
 
 tim::sqlite_db::sqlite_db()
-    : _d(new tim::p::sqlite_db())
+    : opened()
+    , _d(new tim::p::sqlite_db())
 {
 }
 
@@ -68,7 +73,9 @@ bool tim::sqlite_db::open(const std::filesystem::path &path)
     if (!(_d->_db = tim::p::sqlite_db::open_db(_d->_path)))
         return false;
 
-    if (!exec(PRAGMAS))
+    if (!exec(PRAGMAS)
+            || !exec("PRAGMA cache_size = " + std::to_string(tim::DB_MEMORY_PROFILE.page_cache_slots)
+                     + "; PRAGMA mmap_size = " + std::to_string(tim::DB_MEMORY_PROFILE.mmap_size)))
         return false;
 
 /*
@@ -87,6 +94,8 @@ bool tim::sqlite_db::open(const std::filesystem::path &path)
 */
 //    sqlite3_progress_handler(_d->_db.get(), 1, &tim::p::sqlite_db::progress, this);
 
+    opened();
+
     return true;
 }
 
@@ -123,44 +132,51 @@ const std::filesystem::path &tim::sqlite_db::path() const
 
 bool tim::sqlite_db::set_key(const std::string &key)
 {
-    assert(_d->_db);
-
-    const int res = sqlite3_key_v2(_d->_db.get(), nullptr, key.c_str(), 1);
-    if (res != SQLITE_OK)
-        return TIM_TRACE(Error,
-                        TIM_TR("Failed to set encryption key for database '%s': %s"_en,
-                              "Ошибка при задании ключа шифрования для базы данных '%s': %s"_ru),
-                        _d->_path.string().c_str(),
-                        sqlite3_errstr(res));
-    return true;
+    return tim::sqlite_crypt::set_key(key);
 }
 
 bool tim::sqlite_db::rekey(const std::string &key)
 {
     assert(_d->_db);
 
-    const int res = sqlite3_rekey_v2(_d->_db.get(), nullptr, key.c_str(), 1);
-    if (res != SQLITE_OK)
-        return TIM_TRACE(Error,
-                        TIM_TR("Failed to re-key database '%s': %s"_en,
-                              "Ошибка при изменении ключа шифрования базы данных '%s': %s"_ru),
-                        _d->_path.string().c_str(),
-                        sqlite3_errstr(res));
-    return true;
+    const std::filesystem::path path = _d->_path;
+    if (!_d->can_reopen()
+            || !exec("PRAGMA wal_checkpoint(TRUNCATE)"))
+        return false;
+    close();
+
+    const bool ok = tim::sqlite_crypt::set_key(key)
+                        && tim::sqlite_crypt::reencrypt(path);
+    if (!ok)
+        TIM_TRACE(Error,
+                 TIM_TR("Failed to re-key database '%s'."_en,
+                       "Ошибка при изменении ключа шифрования базы данных '%s'."_ru),
+                 path.string().c_str());
+
+    return open(path)
+                && ok;
 }
 
 bool tim::sqlite_db::clear_key()
 {
     assert(_d->_db);
 
-    const int res = sqlite3_rekey_v2(_d->_db.get(), nullptr, nullptr, 0);
-    if (res != SQLITE_OK)
-        return TIM_TRACE(Error,
-                        TIM_TR("Failed to remove encryption key for database '%s': %s"_en,
-                              "Ошибка при удалении ключа шифрования для базы данных '%s': %s"_ru),
-                        _d->_path.string().c_str(),
-                        sqlite3_errstr(res));
-    return true;
+    const std::filesystem::path path = _d->_path;
+    if (!_d->can_reopen()
+            || !exec("PRAGMA wal_checkpoint(TRUNCATE)"))
+        return false;
+    close();
+
+    tim::sqlite_crypt::clear_key();
+    const bool ok = tim::sqlite_crypt::reencrypt(path);
+    if (!ok)
+        TIM_TRACE(Error,
+                 TIM_TR("Failed to remove encryption key for database '%s'."_en,
+                       "Ошибка при удалении ключа шифрования для базы данных '%s'."_ru),
+                 path.string().c_str());
+
+    return open(path)
+                && ok;
 }
 
 #endif
@@ -428,10 +444,77 @@ bool tim::sqlite_db::backup(const std::filesystem::path &path,
 
 // Private
 
+void tim::p::sqlite_db::configure()
+{
+    // The arena has to outlive every connection, so it is never freed.
+    static std::vector<std::uint64_t> page_cache;
+
+    const tim::sqlite_memory_profile &profile = tim::DB_MEMORY_PROFILE;
+    const char *option = "SQLITE_CONFIG_PCACHE_HDRSZ";
+    int res;
+
+    int header_size = 0;
+    if ((res = sqlite3_config(SQLITE_CONFIG_PCACHE_HDRSZ, &header_size)) == SQLITE_OK
+            && profile.page_cache_slots > 0)
+    {
+        const std::size_t slot_size = (tim::DB_PAGE_SIZE + header_size + 7) & ~7;
+        page_cache.resize(slot_size * profile.page_cache_slots / sizeof(std::uint64_t));
+        option = "SQLITE_CONFIG_PAGECACHE";
+        res = sqlite3_config(SQLITE_CONFIG_PAGECACHE,
+                             page_cache.data(),
+                             (int)slot_size,
+                             profile.page_cache_slots);
+    }
+
+    if (res == SQLITE_OK)
+    {
+        option = "SQLITE_CONFIG_LOOKASIDE";
+        res = sqlite3_config(SQLITE_CONFIG_LOOKASIDE,
+                             profile.lookaside_slot_size,
+                             profile.lookaside_slots);
+    }
+
+    if (res == SQLITE_OK)
+    {
+        option = "SQLITE_CONFIG_MMAP_SIZE";
+        res = sqlite3_config(SQLITE_CONFIG_MMAP_SIZE,
+                             profile.mmap_size,
+                             profile.mmap_size);
+    }
+
+    if (res == SQLITE_OK)
+    {
+        option = "sqlite3_initialize";
+        res = sqlite3_initialize();
+    }
+
+    // The options applied before the failure stay in effect, SQLite has
+    // no way to query the compiled-in defaults to restore them.
+    if (res != SQLITE_OK)
+        TIM_TRACE(Warning,
+                 TIM_TR("Failed to apply SQLite memory option %s, it and the next ones keep their defaults: %s"_en,
+                       "Ошибка при настройке памяти SQLite на %s, этот и следующие параметры имеют значения по умолчанию: %s"_ru),
+                 option,
+                 sqlite3_errstr(res));
+
+#ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+    // Without the VFS an encrypted database would be written in plain text.
+    if (!tim::sqlite_crypt::install()
+            && tim::sqlite_crypt::has_key())
+        TIM_TRACE(Fatal,
+                  TIM_TR("Failed to install database encryption."_en,
+                         "Не могу включить шифрование базы данных."_ru));
+#endif
+}
+
 tim::p::sqlite_db::db_ptr tim::p::sqlite_db::open_db(const std::filesystem::path &path)
 {
     assert(!path.empty());
 
+    // Must happen before SQLite is initialized by the first connection.
+    static const bool configured = (configure(), true);
+    (void) configured;
+
     TIM_TRACE(Debug,
              TIM_TR("Opening database '%s' ..."_en,
                    "Открываем базу данных '%s' ..."_ru),
@@ -490,6 +573,18 @@ tim::p::sqlite_db::db_ptr tim::p::sqlite_db::open_db(const std::filesystem::path
     return dbp;
 }
 
+bool tim::p::sqlite_db::can_reopen() const
+{
+    // Reopening would invalidate the statements other modules keep prepared.
+    if (sqlite3_next_stmt(_db.get(), nullptr))
+        return TIM_TRACE(Error,
+                        TIM_TR("Database '%s' has prepared statements and cannot be reopened."_en,
+                              "У базы данных '%s' есть подготовленные запросы, ее нельзя открыть заново."_ru),
+                        _path.string().c_str());
+
+    return true;
+}
+
 bool tim::p::sqlite_db::close_db(sqlite3 *db)
 {
     if (db)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "tim_signal.h"
+
 #include <filesystem>
 #include <functional>
 #include <memory>
@@ -23,6 +25,8 @@ class sqlite_db
 
 public:
 
+    tim::signal<> opened; // Also when rekey() or clear_key() open the database again.
+
     sqlite_db();
     virtual ~sqlite_db();
 
@@ -34,6 +38,9 @@ public:
     const std::filesystem::path &path() const;
 
 #ifdef TIM_SQLITE_ENCRYPTION_ENABLED
+    // Encryption through tim::sqlite_crypt. The key is set before open(),
+    // rekey() and clear_key() reopen the database, so they refuse to run
+    // once other modules keep statements prepared.
     bool set_key(const std::string &key);
     bool rekey(const std::string &key);
     bool clear_key();
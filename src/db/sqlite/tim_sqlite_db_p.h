@@ -10,6 +10,7 @@ struct sqlite_db
 {
     using db_ptr = std::unique_ptr<sqlite3, std::function<void(sqlite3 *)>>;
 
+    static void configure();
     static db_ptr open_db(const std::filesystem::path &path);
     static bool close_db(sqlite3 *db);
 
@@ -20,6 +21,8 @@ struct sqlite_db
     static int trace(unsigned event, void *self, void *p, void *x);
     static int progress(void *self);
 
+    bool can_reopen() const;
+
     std::filesystem::path _path;
 
     db_ptr _db;
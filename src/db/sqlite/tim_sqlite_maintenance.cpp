@@ -0,0 +1,187 @@
+#include "tim_sqlite_maintenance.h"
+
+#include "tim_sqlite_maintenance_p.h"
+
+#include "tim_config.h"
+#include "tim_signal_connection.h"
+#include "tim_sqlite_db.h"
+#include "tim_sqlite_query.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+#include "mongoose.h"
+#include "sqlite3.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+
+
+// Public
+
+tim::sqlite_maintenance::sqlite_maintenance(mg_mgr *mg, tim::sqlite_db *db)
+    : _d(new tim::p::sqlite_maintenance(this))
+{
+    assert(mg);
+    assert(db);
+    assert(db->is_open());
+
+    _d->_db = db;
+    _d->_wal_path = db->path().string() + "-wal";
+    _d->_last_commit = std::chrono::steady_clock::now();
+
+    _d->configure();
+    _d->_opened.reset(new tim::signal_connection(
+        db->opened.connect(std::bind(&tim::p::sqlite_maintenance::configure, _d.get()))));
+
+    _d->_timer = mg_timer_add(mg, tim::DB_MAINTENANCE_INTERVAL.count(),
+                              MG_TIMER_REPEAT,
+                              &tim::p::sqlite_maintenance::on_timer, _d.get());
+}
+
+tim::sqlite_maintenance::~sqlite_maintenance()
+{
+    if (_d->_db->is_open())
+        sqlite3_wal_hook(_d->_db->sqlite(), nullptr, nullptr);
+}
+
+const tim::sqlite_maintenance::statistics &tim::sqlite_maintenance::stats() const
+{
+    return _d->_stats;
+}
+
+bool tim::sqlite_maintenance::checkpoint(bool restart)
+{
+    int log_size = 0;
+    int checkpointed = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const int res = sqlite3_wal_checkpoint_v2(_d->_db->sqlite(), nullptr,
+                                              restart
+                                                  ? SQLITE_CHECKPOINT_RESTART
+                                                  : SQLITE_CHECKPOINT_PASSIVE,
+                                              &log_size, &checkpointed);
+    const std::chrono::microseconds duration
+        = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    ++_d->_stats.checkpoint_count;
+    _d->_stats.last_checkpoint_duration = duration;
+    _d->_stats.max_checkpoint_duration = std::max(_d->_stats.max_checkpoint_duration, duration);
+
+    switch (res)
+    {
+        case SQLITE_OK:
+            _d->_stats.wal_frames = std::max(0, log_size - checkpointed);
+            return true;
+
+        case SQLITE_BUSY:
+        case SQLITE_LOCKED:
+            ++_d->_stats.busy_checkpoint_count;
+            return true;
+
+        default:
+            break;
+    }
+
+    return TIM_TRACE(Error,
+                    TIM_TR("Failed to checkpoint database '%s': %s"_en,
+                          "Ошибка при переносе журнала WAL в базу данных '%s': %s"_ru),
+                    _d->_db->path().string().c_str(),
+                    sqlite3_errstr(res));
+}
+
+bool tim::sqlite_maintenance::incremental_vacuum(std::size_t page_count)
+{
+    if (!_d->_incremental_vacuum)
+        return true;
+
+    tim::sqlite_query q(_d->_db, "PRAGMA freelist_count");
+    if (!q.prepare()
+            || !q.next())
+        return false;
+
+    _d->_stats.freelist_pages = (std::size_t)q.to_int64(0);
+    if (!_d->_stats.freelist_pages)
+        return true;
+
+    page_count = std::min(page_count, _d->_stats.freelist_pages);
+
+    // The vacuum commit is not a user activity.
+    const std::chrono::steady_clock::time_point last_commit = _d->_last_commit;
+    const bool ok = _d->_db->exec("PRAGMA incremental_vacuum(" + std::to_string(page_count) + ")");
+    _d->_last_commit = last_commit;
+    if (!ok)
+        return false;
+
+    _d->_stats.vacuumed_pages += page_count;
+    _d->_stats.freelist_pages -= page_count;
+
+    return true;
+}
+
+
+// Private
+
+int tim::p::sqlite_maintenance::on_wal_commit(void *self, sqlite3 *db, const char *name, int frame_count)
+{
+    (void) db;
+    (void) name;
+
+    tim::p::sqlite_maintenance *d = (tim::p::sqlite_maintenance *)self;
+    assert(d);
+
+    d->_stats.wal_frames = std::max(0, frame_count);
+    d->_last_commit = std::chrono::steady_clock::now();
+
+    return SQLITE_OK;
+}
+
+/**
+ * The settings belong to the connection, so they are made again
+ * whenever the database is opened again.
+ */
+void tim::p::sqlite_maintenance::configure()
+{
+    // Free pages can be released in batches only if the database
+    // was created with auto_vacuum = INCREMENTAL.
+    tim::sqlite_query q(_db, "PRAGMA auto_vacuum");
+    _incremental_vacuum = q.prepare()
+                              && q.next()
+                              && q.to_int(0) == 2;
+
+    _db->exec("PRAGMA journal_size_limit = " + std::to_string(tim::DB_WAL_SIZE_LIMIT));
+
+    // Disables the automatic checkpoint as well.
+    sqlite3_wal_hook(_db->sqlite(), &tim::p::sqlite_maintenance::on_wal_commit, this);
+}
+
+void tim::p::sqlite_maintenance::on_timer(void *self)
+{
+    tim::p::sqlite_maintenance *d = (tim::p::sqlite_maintenance *)self;
+    assert(d);
+
+    if (!d->_db->is_open()
+            || d->_db->is_transaction_active())
+        return;
+
+    std::error_code ec;
+    const std::uintmax_t wal_size = std::filesystem::file_size(d->_wal_path, ec);
+    d->_stats.wal_size = ec
+                            ? 0
+                            : (std::size_t)wal_size;
+
+    // A fully copied WAL is written from its start again, so the steps
+    // keep it short without stalling the sessions for long.
+    if (std::chrono::steady_clock::now() - d->_last_commit < tim::DB_IDLE_TIMEOUT)
+    {
+        if (d->_stats.wal_frames >= tim::DB_WAL_STEP_FRAMES)
+            d->_q->checkpoint();
+        return;
+    }
+
+    if (d->_stats.wal_frames)
+        d->_q->checkpoint(true);
+    else
+        d->_q->incremental_vacuum(tim::DB_VACUUM_PAGES_PER_STEP);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+
+struct mg_mgr;
+
+namespace tim
+{
+
+class sqlite_db;
+
+namespace p
+{
+
+struct sqlite_maintenance;
+
+}
+
+/**
+ * Keeps the database WAL and free pages in check from the event loop.
+ *
+ * Replaces SQLite's automatic checkpoint, which runs inside the commit
+ * that crosses the threshold. Checkpoints are run by a timer instead:
+ * while the database is in use, a PASSIVE one whenever the WAL has
+ * DB_WAL_STEP_FRAMES frames, so the copying is spread over the ticks in
+ * small steps; a RESTART one once the database has been idle for a
+ * while. Free pages are returned to the file system by incremental_vacuum
+ * in small batches during idle time.
+ */
+class sqlite_maintenance
+{
+
+public:
+
+    struct statistics
+    {
+        std::size_t wal_frames = 0; ///< WAL frames not copied to the database yet.
+        std::size_t wal_size = 0; ///< WAL file size in bytes.
+        std::size_t checkpoint_count = 0;
+        std::size_t busy_checkpoint_count = 0; ///< Checkpoints that could not complete.
+        std::chrono::microseconds last_checkpoint_duration{0};
+        std::chrono::microseconds max_checkpoint_duration{0};
+        std::size_t freelist_pages = 0;
+        std::size_t vacuumed_pages = 0;
+    };
+
+    sqlite_maintenance(mg_mgr *mg, tim::sqlite_db *db);
+    ~sqlite_maintenance();
+
+    const tim::sqlite_maintenance::statistics &stats() const;
+
+    bool checkpoint(bool restart = false);
+    bool incremental_vacuum(std::size_t page_count);
+
+private:
+
+    std::unique_ptr<tim::p::sqlite_maintenance> _d;
+};
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "tim_sqlite_maintenance.h"
+
+#include <cassert>
+#include <filesystem>
+#include <memory>
+
+
+struct mg_timer;
+struct sqlite3;
+
+namespace tim
+{
+
+class signal_connection;
+
+}
+
+namespace tim::p
+{
+
+struct sqlite_maintenance
+{
+    explicit sqlite_maintenance(tim::sqlite_maintenance *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    static int on_wal_commit(void *self, sqlite3 *db, const char *name, int frame_count);
+    static void on_timer(void *self);
+
+    void configure();
+
+    tim::sqlite_maintenance *const _q;
+
+    tim::sqlite_db *_db = nullptr;
+    mg_timer *_timer = nullptr;
+    std::filesystem::path _wal_path;
+    bool _incremental_vacuum = false;
+    std::chrono::steady_clock::time_point _last_commit;
+    tim::sqlite_maintenance::statistics _stats;
+    std::unique_ptr<tim::signal_connection> _opened;
+};
+
+}
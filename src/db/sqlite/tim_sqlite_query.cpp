@@ -175,6 +175,26 @@ bool tim::sqlite_query::bind(int index, const std::string &value)
     return true;
 }
 
+bool tim::sqlite_query::bind(int index, tim::byte_view value)
+{
+    assert(_d->_stmt);
+
+    // An empty view is an empty blob, not NULL.
+    const int res = value.data
+                        ? sqlite3_bind_blob(_d->_stmt, index, value.data, (int)value.size, SQLITE_TRANSIENT)
+                        : sqlite3_bind_zeroblob(_d->_stmt, index, 0);
+    if (res != SQLITE_OK)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to bind a blob value at index %d for SQL query '%s' to database '%s': %s"_en,
+                              "Ошибка при привязке двоичного значения к позиции %d для SQL-запроса '%s' к базе данных '%s': %s"_ru),
+                        index,
+                        _d->_sql.c_str(),
+                        _d->_db->path().string().c_str(),
+                        sqlite3_errstr(res));
+
+    return true;
+}
+
 bool tim::sqlite_query::bind(int index, const nlohmann::json &value)
 {
     switch (value.type())
@@ -247,6 +267,13 @@ bool tim::sqlite_query::bind(const std::string &key, const std::string &value)
     return bind(sqlite3_bind_parameter_index(_d->_stmt, key.c_str()), value);
 }
 
+bool tim::sqlite_query::bind(const std::string &key, tim::byte_view value)
+{
+    assert(_d->_stmt);
+
+    return bind(sqlite3_bind_parameter_index(_d->_stmt, key.c_str()), value);
+}
+
 bool tim::sqlite_query::bind(const std::string &key, const nlohmann::json &value)
 {
     assert(_d->_stmt);
@@ -360,6 +387,11 @@ int64_t tim::sqlite_query::to_int64(int index) const
     return sqlite3_column_int64(_d->_stmt, index);
 }
 
+float tim::sqlite_query::to_float(int index) const
+{
+    return (float)to_double(index);
+}
+
 double tim::sqlite_query::to_double(int index) const
 {
     assert(_d->_stmt);
@@ -377,6 +409,29 @@ std::string tim::sqlite_query::to_string(int index) const
                 : std::string{};
 }
 
+std::string_view tim::sqlite_query::to_string_view(int index) const
+{
+    assert(_d->_stmt);
+
+    // Text first, then its size, as sqlite3_column_bytes() may convert the value.
+    const char *s = (const char *)sqlite3_column_text(_d->_stmt, index);
+    return s
+                ? std::string_view(s, sqlite3_column_bytes(_d->_stmt, index))
+                : std::string_view{};
+}
+
+tim::byte_view tim::sqlite_query::to_blob(int index) const
+{
+    assert(_d->_stmt);
+
+    tim::byte_view v;
+    v.data = (const std::uint8_t *)sqlite3_column_blob(_d->_stmt, index);
+    if (v.data)
+        v.size = sqlite3_column_bytes(_d->_stmt, index);
+
+    return v;
+}
+
 nlohmann::json tim::sqlite_query::to_json(int index, bool *ok) const
 {
     nlohmann::json j;
@@ -389,6 +444,54 @@ nlohmann::json tim::sqlite_query::to_json(int index, bool *ok) const
                 : nlohmann::json{};
 }
 
+void tim::sqlite_query::to(int index, int &value) const
+{
+    value = to_int(index);
+}
+
+void tim::sqlite_query::to(int index, std::int64_t &value) const
+{
+    value = to_int64(index);
+}
+
+void tim::sqlite_query::to(int index, bool &value) const
+{
+    value = to_int(index);
+}
+
+void tim::sqlite_query::to(int index, float &value) const
+{
+    value = to_float(index);
+}
+
+void tim::sqlite_query::to(int index, double &value) const
+{
+    value = to_double(index);
+}
+
+void tim::sqlite_query::to(int index, std::string &value) const
+{
+    // Reuses the capacity of value.
+    value.assign(to_string_view(index));
+}
+
+void tim::sqlite_query::to(int index, std::string_view &value) const
+{
+    value = to_string_view(index);
+}
+
+void tim::sqlite_query::to(int index, tim::byte_view &value) const
+{
+    value = to_blob(index);
+}
+
+void tim::sqlite_query::to(int index, tim::uuid &value) const
+{
+    const std::string_view s = to_string_view(index);
+    if (!value.from_chars(s.data(), s.size()))
+        value.clear();
+}
+
 bool tim::sqlite_query::reset()
 {
     assert(_d->_stmt);
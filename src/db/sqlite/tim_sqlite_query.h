@@ -1,11 +1,18 @@
 #pragma once
 
+#include "tim_byte_vector.h"
+#include "tim_uuid.h"
+
 #include "nlohmann/json.hpp"
 #include "sqlite3.h"
 
+#include <cassert>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <tuple>
+#include <type_traits>
 
 
 namespace tim
@@ -20,6 +27,15 @@ struct sqlite_query;
 
 }
 
+/**
+ * A prepared SQL statement.
+ *
+ * Rows are decoded either column by column with to_*() or all at once
+ * into variables or a tuple with next(). Column types are checked at
+ * compile time: int, std::int64_t, bool, float, double, std::string,
+ * std::string_view, tim::byte_view and tim::uuid are supported. Views
+ * point into SQLite memory and stay valid until the next step or reset.
+ */
 class sqlite_query
 {
 
@@ -40,6 +56,7 @@ public:
     bool bind(int index, float value);
     bool bind(int index, const char *value);
     bool bind(int index, const std::string &value);
+    bool bind(int index, tim::byte_view value);
     bool bind(int index, const nlohmann::json &value);
 
     bool bind(const std::string &key, bool value);
@@ -49,6 +66,7 @@ public:
     bool bind(const std::string &key, float value);
     bool bind(const std::string &key, const char *value);
     bool bind(const std::string &key, const std::string &value);
+    bool bind(const std::string &key, tim::byte_view value);
     bool bind(const std::string &key, const nlohmann::json &value);
 
     bool clear_bindings();
@@ -56,6 +74,15 @@ public:
     bool exec();
     bool next(bool *done = nullptr);
 
+    template<typename... Ts>
+    bool next(bool *done, Ts &...columns);
+
+    template<typename... Ts>
+    bool next(std::tuple<Ts...> &row, bool *done = nullptr);
+
+    template<typename... Ts>
+    void read(Ts &...columns) const;
+
     std::size_t column_count() const;
     std::size_t data_column_count() const;
 
@@ -66,13 +93,75 @@ public:
     float to_float(int index) const;
     double to_double(int index) const;
     std::string to_string(int index) const;
+    std::string_view to_string_view(int index) const;
+    tim::byte_view to_blob(int index) const;
     nlohmann::json to_json(int index, bool *ok = nullptr) const;
 
+    void to(int index, int &value) const;
+    void to(int index, std::int64_t &value) const;
+    void to(int index, bool &value) const;
+    void to(int index, float &value) const;
+    void to(int index, double &value) const;
+    void to(int index, std::string &value) const;
+    void to(int index, std::string_view &value) const;
+    void to(int index, tim::byte_view &value) const;
+    void to(int index, tim::uuid &value) const;
+
     bool reset();
 
 private:
 
+    template<typename T, typename = void>
+    struct is_column : std::false_type {};
+
+    template<typename T>
+    struct is_column<T, std::void_t<decltype(std::declval<const tim::sqlite_query &>().to(0, std::declval<T &>()))>>
+        : std::true_type {};
+
     std::unique_ptr<tim::p::sqlite_query> _d;
 };
 
 }
+
+
+// Public
+
+template<typename... Ts>
+bool tim::sqlite_query::next(bool *done, Ts &...columns)
+{
+    assert(done);
+
+    if (!next(done))
+        return false;
+
+    if (!*done)
+        read(columns...);
+
+    return true;
+}
+
+template<typename... Ts>
+bool tim::sqlite_query::next(std::tuple<Ts...> &row, bool *done)
+{
+    bool finished = false;
+    if (!next(&finished))
+        return false;
+
+    if (done)
+        *done = finished;
+
+    if (!finished)
+        std::apply([this](Ts &...columns) { read(columns...); }, row);
+
+    return true;
+}
+
+template<typename... Ts>
+void tim::sqlite_query::read(Ts &...columns) const
+{
+    static_assert((is_column<Ts>::value && ...), "Unsupported SQLite column type.");
+    assert(sizeof...(Ts) <= data_column_count());
+
+    int index = 0;
+    (to(index++, columns), ...);
+}
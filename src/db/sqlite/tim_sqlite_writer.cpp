@@ -0,0 +1,276 @@
+#include "tim_sqlite_writer.h"
+
+#include "tim_sqlite_writer_p.h"
+
+#include "tim_application.h"
+#include "tim_config.h"
+#include "tim_sqlite_db.h"
+#include "tim_sqlite_query.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+#include "mongoose.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+
+static const char SAVE_POINT[] = "tim_sqlite_writer_job";
+
+
+// Public
+
+tim::sqlite_writer::sqlite_writer(mg_mgr *mg, tim::sqlite_db *db)
+    : _d(new tim::p::sqlite_writer(this))
+{
+    assert(mg);
+    assert(db);
+    assert(db->is_open());
+
+    _d->_db = db;
+    _d->_timer = mg_timer_add(mg, tim::DB_GROUP_COMMIT_INTERVAL.count(),
+                              MG_TIMER_REPEAT,
+                              &tim::p::sqlite_writer::on_timer, _d.get());
+
+    // Armed now rather than on the next poll, so the deadline is known.
+    _d->_timer->expire = mg_millis() + tim::DB_GROUP_COMMIT_INTERVAL.count();
+
+    _d->_thread = std::thread(&tim::p::sqlite_writer::run, _d.get());
+}
+
+tim::sqlite_writer::~sqlite_writer()
+{
+    {
+        const std::lock_guard<std::mutex> lock(_d->_mutex);
+        _d->_quit = true;
+    }
+    _d->_wake.notify_one();
+
+    // The thread commits what is queued before it quits.
+    _d->_thread.join();
+    _d->complete();
+}
+
+void tim::sqlite_writer::post(job j, completion c)
+{
+    assert(j);
+
+    _d->queue({ std::move(j), std::move(c), false });
+}
+
+void tim::sqlite_writer::post_exclusive(job j, completion c)
+{
+    assert(j);
+
+    _d->queue({ std::move(j), std::move(c), true });
+}
+
+std::size_t tim::sqlite_writer::pending_count() const
+{
+    const std::lock_guard<std::mutex> lock(_d->_mutex);
+    return _d->_tasks.size() + _d->_running;
+}
+
+tim::sqlite_writer::statistics tim::sqlite_writer::stats() const
+{
+    const std::lock_guard<std::mutex> lock(_d->_mutex);
+    return _d->_stats;
+}
+
+
+// Private
+
+void tim::p::sqlite_writer::on_timer(void *self)
+{
+    tim::p::sqlite_writer *d = (tim::p::sqlite_writer *)self;
+    assert(d);
+
+    d->complete();
+
+    if (d->_posted)
+        tim::app()->wake_up_at(d->_timer->expire);
+}
+
+void tim::p::sqlite_writer::queue(tim::p::sqlite_writer_task &&task)
+{
+    std::size_t count = 0;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+        count = _tasks.size();
+    }
+
+    if (count == 1
+            || count >= tim::DB_GROUP_COMMIT_SIZE)
+        _wake.notify_one();
+
+    // The event loop would not wake up for the completions otherwise.
+    ++_posted;
+    tim::app()->wake_up_at(_timer->expire);
+}
+
+void tim::p::sqlite_writer::run()
+{
+    std::chrono::steady_clock::time_point last_commit = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        if (!_wake.wait_for(lock, tim::DB_MAINTENANCE_INTERVAL,
+                            [this]
+                            {
+                                return _quit
+                                           || !_tasks.empty();
+                            }))
+        {
+            if (std::chrono::steady_clock::now() - last_commit >= tim::DB_IDLE_TIMEOUT)
+            {
+                lock.unlock();
+                vacuum();
+                lock.lock();
+            }
+            continue;
+        }
+
+        if (_tasks.empty())
+            break;
+
+        // The writes queued meanwhile join the group.
+        _wake.wait_for(lock, tim::DB_GROUP_COMMIT_INTERVAL,
+                       [this]
+                       {
+                           return _quit
+                                      || _tasks.front()._exclusive
+                                      || _tasks.size() >= tim::DB_GROUP_COMMIT_SIZE;
+                       });
+
+        // An exclusive job goes alone.
+        std::size_t count = 1;
+        if (!_tasks.front()._exclusive)
+            while (count < std::min(_tasks.size(), tim::DB_GROUP_COMMIT_SIZE)
+                        && !_tasks[count]._exclusive)
+                ++count;
+
+        std::vector<tim::p::sqlite_writer_task> tasks(std::make_move_iterator(_tasks.begin()),
+                                                      std::make_move_iterator(_tasks.begin() + count));
+        _tasks.erase(_tasks.begin(), _tasks.begin() + count);
+        _running = count;
+        lock.unlock();
+
+        std::vector<bool> results(count, false);
+        const bool ok = commit(tasks, results);
+        last_commit = std::chrono::steady_clock::now();
+
+        lock.lock();
+        _running = 0;
+
+        if (!ok)
+        {
+            ++_stats.failed_commits;
+
+            // Nothing of the group is kept, so it goes first again after
+            // a while. Only on the way out is it given up.
+            if (!_quit)
+            {
+                _tasks.insert(_tasks.begin(),
+                              std::make_move_iterator(tasks.begin()),
+                              std::make_move_iterator(tasks.end()));
+                _wake.wait_for(lock, tim::DB_GROUP_COMMIT_INTERVAL,
+                               [this]
+                               {
+                                   return _quit;
+                               });
+                continue;
+            }
+        }
+        else
+        {
+            _stats.commits++;
+            _stats.max_group = std::max(_stats.max_group, count);
+        }
+
+        _stats.jobs += count;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!results[i])
+                ++_stats.failed;
+            _done.emplace_back(std::move(tasks[i]._completion), results[i]);
+        }
+    }
+}
+
+bool tim::p::sqlite_writer::commit(std::vector<tim::p::sqlite_writer_task> &tasks, std::vector<bool> &results)
+{
+    // Its transaction is its own, so it is not queued again.
+    if (tasks.front()._exclusive)
+    {
+        results.front() = tasks.front()._job(_db);
+        return true;
+    }
+
+    if (!_db->begin())
+        return false;
+
+    // The jobs report their own errors.
+    bool ok = true;
+    for (std::size_t i = 0; i < tasks.size(); ++i)
+    {
+        if (!(ok = _db->begin(SAVE_POINT)))
+            break;
+
+        if (!(results[i] = tasks[i]._job(_db)))
+            _db->rollback(SAVE_POINT);
+
+        if (!(ok = _db->commit(SAVE_POINT)))
+            break;
+    }
+
+    if (ok
+            && _db->commit())
+        return true;
+
+    _db->rollback();
+    std::fill(results.begin(), results.end(), false);
+
+    return TIM_TRACE(Error,
+                    TIM_TR("Failed to commit %zu writes to database '%s'."_en,
+                          "Ошибка при подтверждении %zu записей в базу данных '%s'."_ru),
+                    tasks.size(),
+                    _db->path().string().c_str());
+}
+
+/**
+ * Returns some free pages of an idle database to the file system, if it
+ * was created with auto_vacuum = INCREMENTAL.
+ */
+void tim::p::sqlite_writer::vacuum()
+{
+    {
+        tim::sqlite_query q(_db, "PRAGMA freelist_count");
+        if (!q.prepare()
+                || !q.next()
+                || q.to_int64(0) <= 0)
+            return;
+    }
+
+    _db->exec("PRAGMA incremental_vacuum(" + std::to_string(tim::DB_VACUUM_PAGES_PER_STEP) + ")");
+}
+
+/**
+ * Calls the completions of the committed jobs on the event loop. They
+ * may queue more jobs.
+ */
+void tim::p::sqlite_writer::complete()
+{
+    std::vector<std::pair<tim::sqlite_writer::completion, bool>> done;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        done.swap(_done);
+    }
+
+    _posted -= done.size();
+    for (const std::pair<tim::sqlite_writer::completion, bool> &d: done)
+        if (d.first)
+            d.first(d.second);
+}
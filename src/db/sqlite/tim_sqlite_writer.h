@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+
+struct mg_mgr;
+
+namespace tim
+{
+
+class sqlite_db;
+
+namespace p
+{
+
+struct sqlite_writer;
+
+}
+
+/**
+ * Group commit of the writes to a database, made by a thread of its own.
+ *
+ * The jobs queued from the event loop are run by the writer thread in
+ * a single transaction once DB_GROUP_COMMIT_INTERVAL has passed since
+ * the first of them, or as soon as DB_GROUP_COMMIT_SIZE of them are
+ * queued, so the database is synced once per group instead of once per
+ * write and the event loop never waits for it. Each job runs in its own
+ * savepoint: a job that fails is rolled back alone and the rest of the
+ * group is committed. A group that fails to commit is rolled back and
+ * queued again. The in-memory effects of a job go to its completion,
+ * called on the event loop once the group is committed or the job is
+ * rolled back, so they never outlive a rollback.
+ *
+ * The database belongs to the writer thread while the writer lives, jobs
+ * get it as their argument and must not touch anything else that is not
+ * theirs. An exclusive job runs alone and out of any transaction, it is
+ * for the work that needs its own, like attaching a database. The thread also returns the free pages of an idle database to
+ * the file system, its automatic checkpoints are left on.
+ */
+class sqlite_writer
+{
+
+public:
+
+    using job = std::function<bool (tim::sqlite_db *db)>;
+    using completion = std::function<void (bool ok)>;
+
+    struct statistics
+    {
+        std::size_t jobs = 0;
+        std::size_t failed = 0;
+        std::size_t commits = 0;
+        std::size_t failed_commits = 0;
+        std::size_t max_group = 0; // Jobs committed at once.
+    };
+
+    sqlite_writer(mg_mgr *mg, tim::sqlite_db *db);
+    ~sqlite_writer();
+
+    void post(job j, completion c = nullptr);
+    void post_exclusive(job j, completion c = nullptr);
+
+    std::size_t pending_count() const;
+    statistics stats() const;
+
+private:
+
+    std::unique_ptr<tim::p::sqlite_writer> _d;
+};
+
+}
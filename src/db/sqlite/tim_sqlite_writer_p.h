@@ -0,0 +1,61 @@
+#pragma once
+
+#include "tim_sqlite_writer.h"
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+struct mg_timer;
+
+namespace tim::p
+{
+
+struct sqlite_writer_task
+{
+    tim::sqlite_writer::job _job;
+    tim::sqlite_writer::completion _completion;
+    bool _exclusive = false;
+};
+
+struct sqlite_writer
+{
+    explicit sqlite_writer(tim::sqlite_writer *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    static void on_timer(void *self);
+
+    void queue(tim::p::sqlite_writer_task &&task);
+    void run();
+    bool commit(std::vector<tim::p::sqlite_writer_task> &tasks, std::vector<bool> &results);
+    void vacuum();
+    void complete();
+
+    tim::sqlite_writer *const _q;
+
+    tim::sqlite_db *_db = nullptr;
+    mg_timer *_timer = nullptr;
+    std::size_t _posted = 0; // Tasks not completed yet, of the event loop.
+
+    // Shared with the writer thread.
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<tim::p::sqlite_writer_task> _tasks;
+    std::size_t _running = 0; // Tasks of the group being committed.
+    std::vector<std::pair<tim::sqlite_writer::completion, bool /* ok */>> _done; // Completions to call.
+    tim::sqlite_writer::statistics _stats;
+    bool _quit = false;
+
+    std::thread _thread;
+};
+
+}
@@ -0,0 +1,172 @@
+#include "tim_post_thread.h"
+
+#include "tim_post_thread_p.h"
+
+#include "tim_post.h"
+#include "tim_post_shards.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+#include "tim_uuid.h"
+
+
+static const char *const ROOT_SQL =
+R"(SELECT ancestor_id
+    FROM post_closure
+    WHERE descendant_id = :post_id
+    ORDER BY depth DESC
+    LIMIT 1)";
+
+// Ordered by the path of (timestamp, id) from the root, so every reply
+// follows its parent and the replies before it to the same parent.
+static const char *const FETCH_SQL =
+R"(SELECT p.id, p.user_id, p.post_id, p.timestamp, p.text, c.depth
+    FROM post_closure AS c
+        JOIN post AS p ON p.id = c.descendant_id
+    WHERE c.ancestor_id = :root_id
+    ORDER BY (SELECT group_concat(printf('%020d %s', ap.timestamp, ap.id), ' ' ORDER BY a.depth DESC)
+                  FROM post_closure AS a
+                      JOIN post AS ap ON ap.id = a.ancestor_id
+                  WHERE a.descendant_id = c.descendant_id))";
+
+static const char *const COUNT_SQL =
+R"(SELECT count(*) - 1
+    FROM post_closure
+    WHERE ancestor_id = :root_id)";
+
+
+// Public
+
+tim::post_thread::post_thread(const tim::post_shards *shards)
+    : fetched()
+    , _d(new tim::p::post_thread(this, shards))
+{
+}
+
+tim::post_thread::~post_thread() = default;
+
+bool tim::post_thread::root(const tim::uuid &post_id, tim::uuid &root_id)
+{
+    tim::sqlite_query *q = nullptr;
+    if (!_d->prepare(post_id, _d->_root, q))
+        return false;
+
+    if (!q)
+        return false;
+
+    bool done = true;
+    const bool ok = q->bind(":post_id", post_id.to_string())
+                        && q->next(&done, root_id);
+
+    q->reset();
+    q->clear_bindings();
+
+    if (!ok)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to find the thread of post '%s'."_en,
+                              "Ошибка при поиске ветки сообщения '%s'."_ru),
+                        post_id.to_string().c_str());
+
+    return !done;
+}
+
+bool tim::post_thread::fetch(const tim::uuid &root_id)
+{
+    tim::sqlite_query *q = nullptr;
+    if (!_d->prepare(root_id, _d->_fetch, q))
+        return false;
+
+    if (!q)
+        return true;
+
+    if (!q->bind(":root_id", root_id.to_string()))
+        return false;
+
+    tim::post post;
+    std::int64_t depth = 0;
+    bool done = false;
+    while (q->next(&done, post.id, post.user_id, post.post_id, post.timestamp, post.text, depth)
+                && !done)
+        fetched(post, (std::size_t)depth);
+
+    q->reset();
+    q->clear_bindings();
+
+    if (!done)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to read the thread of post '%s'."_en,
+                              "Ошибка при чтении ветки сообщения '%s'."_ru),
+                        root_id.to_string().c_str());
+
+    return true;
+}
+
+bool tim::post_thread::count(const tim::uuid &root_id, std::size_t &reply_count)
+{
+    reply_count = 0;
+
+    tim::sqlite_query *q = nullptr;
+    if (!_d->prepare(root_id, _d->_count, q))
+        return false;
+
+    if (!q)
+        return true;
+
+    std::int64_t n = 0;
+    bool done = true;
+    const bool ok = q->bind(":root_id", root_id.to_string())
+                        && q->next(&done, n)
+                        && !done;
+
+    q->reset();
+    q->clear_bindings();
+
+    if (!ok)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to count replies to post '%s'."_en,
+                              "Ошибка при подсчёте ответов на сообщение '%s'."_ru),
+                        root_id.to_string().c_str());
+
+    reply_count = n > 0
+                      ? (std::size_t)n
+                      : 0;
+    return true;
+}
+
+
+// Private
+
+tim::p::post_thread::post_thread(tim::post_thread *q, const tim::post_shards *shards)
+    : _q(q)
+    , _shards(shards)
+{
+    assert(_q);
+    assert(_shards);
+
+    for (std::size_t k = 0; k < _shards->count(); ++k)
+    {
+        _root.emplace_back(new tim::sqlite_query(_shards->db(k), ROOT_SQL));
+        _fetch.emplace_back(new tim::sqlite_query(_shards->db(k), FETCH_SQL));
+        _count.emplace_back(new tim::sqlite_query(_shards->db(k), COUNT_SQL));
+    }
+}
+
+/**
+ * Picks the query of the shard of the thread, none if the post is not
+ * in any.
+ */
+bool tim::p::post_thread::prepare(const tim::uuid &post_id,
+                                  std::vector<std::unique_ptr<tim::sqlite_query>> &queries,
+                                  tim::sqlite_query *&query)
+{
+    std::size_t shard = 0;
+    if (!_shards->find(post_id, shard))
+    {
+        query = nullptr;
+        return true;
+    }
+
+    query = queries[shard].get();
+
+    return query->prepared()
+               || query->prepare();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "tim_signal.h"
+
+#include <cstddef>
+#include <memory>
+
+
+namespace tim
+{
+
+class post_shards;
+class uuid;
+struct post;
+
+namespace p
+{
+
+struct post_thread;
+
+}
+
+/**
+ * Discussion threads built from the replies (post.post_id).
+ *
+ * Every post is linked to all of its ancestors in the post_closure table
+ * by an insert trigger, keyed by (ancestor, timestamp, descendant). So the
+ * whole thread of a root is read or counted by one range scan of the key
+ * in the shard of the thread, however deep or wide the thread is. Posts are emitted depth first, each
+ * reply right after its parent and its earlier siblings with their replies,
+ * through the fetched signal along with their depth below the root.
+ * The slots must not call the thread back.
+ */
+class post_thread
+{
+
+public:
+
+    tim::signal<const tim::post & /* post */, std::size_t /* depth */> fetched;
+
+    explicit post_thread(const tim::post_shards *shards);
+    ~post_thread();
+
+    bool root(const tim::uuid &post_id, tim::uuid &root_id);
+    bool fetch(const tim::uuid &root_id);
+    bool count(const tim::uuid &root_id, std::size_t &reply_count);
+
+private:
+
+    std::unique_ptr<tim::p::post_thread> _d;
+};
+
+}
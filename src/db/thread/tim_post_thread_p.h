@@ -0,0 +1,39 @@
+#pragma once
+
+#include "tim_sqlite_query.h"
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+
+namespace tim
+{
+
+class post_shards;
+class post_thread;
+class uuid;
+
+namespace p
+{
+
+struct post_thread
+{
+    post_thread(tim::post_thread *q, const tim::post_shards *shards);
+
+    bool prepare(const tim::uuid &post_id,
+                 std::vector<std::unique_ptr<tim::sqlite_query>> &queries,
+                 tim::sqlite_query *&query);
+
+    tim::post_thread *const _q;
+
+    const tim::post_shards *const _shards;
+
+    std::vector<std::unique_ptr<tim::sqlite_query>> _root; // By shard.
+    std::vector<std::unique_ptr<tim::sqlite_query>> _fetch;
+    std::vector<std::unique_ptr<tim::sqlite_query>> _count;
+};
+
+}
+
+}
@@ -0,0 +1,299 @@
+#include "tim_timeline.h"
+
+#include "tim_timeline_p.h"
+
+#include "tim_post.h"
+#include "tim_post_archive.h"
+#include "tim_post_shards.h"
+#include "tim_string_tools.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+
+
+// Every shard streams its posts from the (timestamp, id) index in the
+// order of the page, the merge takes the page from the heads and puts it
+// in chronological order. Only the rows read are looked up in the table
+// by rowid, the index leaves the texts out so they are not stored twice.
+static const char *const LATEST_SQL =
+R"(SELECT id, user_id, post_id, timestamp, text
+    FROM post
+    ORDER BY timestamp DESC, id DESC
+    LIMIT :count)";
+
+static const char *const OLDER_SQL =
+R"(SELECT id, user_id, post_id, timestamp, text
+    FROM post
+    WHERE (timestamp, id) < (:timestamp, :id)
+    ORDER BY timestamp DESC, id DESC
+    LIMIT :count)";
+
+static const char *const ARCHIVE_OLDER_SQL =
+R"(SELECT id, user_id, post_id, timestamp, text
+    FROM %s.post
+    WHERE (timestamp, id) < (:timestamp, :id)
+    ORDER BY timestamp DESC, id DESC
+    LIMIT :count)";
+
+static const char *const NEWER_SQL =
+R"(SELECT id, user_id, post_id, timestamp, text
+    FROM post
+    WHERE (timestamp, id) > (:timestamp, :id)
+    ORDER BY timestamp, id
+    LIMIT :count)";
+
+
+// Public
+
+tim::timeline::timeline(const tim::sqlite_db *db, const tim::post_shards *shards, tim::post_archive *archive)
+    : fetched()
+    , _d(new tim::p::timeline(this, db, shards, archive))
+{
+}
+
+tim::timeline::~timeline() = default;
+
+bool tim::timeline::latest(std::size_t count)
+{
+    reset();
+
+    std::size_t n = 0;
+    if (!_d->fetch(_d->_latest, true, count, nullptr, true, true, n))
+        return false;
+
+    if (n < count)
+        _d->next_source();
+
+    return true;
+}
+
+bool tim::timeline::older(std::size_t count)
+{
+    if (empty()
+            && _d->_month.empty())
+        return latest(count);
+
+    std::size_t n = 0;
+    while (!_d->_at_begin)
+    {
+        if (!_d->fetch_older(count, n))
+            return false;
+
+        if (n == count)
+            break;
+
+        _d->next_source();
+
+        if (n)
+            break;
+    }
+
+    return true;
+}
+
+bool tim::timeline::newer(std::size_t count)
+{
+    if (empty())
+        return latest(count);
+
+    std::size_t n = 0;
+    return _d->fetch(_d->_newer, false, count, &_d->_last, false, true, n);
+}
+
+bool tim::timeline::empty() const
+{
+    return _d->_last.id.empty();
+}
+
+bool tim::timeline::at_begin() const
+{
+    return _d->_at_begin;
+}
+
+void tim::timeline::reset()
+{
+    _d->_first = {};
+    _d->_last = {};
+    _d->_month.clear();
+    _d->_at_begin = false;
+}
+
+
+// Private
+
+tim::p::timeline::timeline(tim::timeline *q,
+                           const tim::sqlite_db *db,
+                           const tim::post_shards *shards,
+                           tim::post_archive *archive)
+    : _q(q)
+    , _db(db)
+    , _archive(archive)
+{
+    assert(_q);
+    assert(shards);
+
+    for (std::size_t k = 0; k < shards->count(); ++k)
+    {
+        _queries.emplace_back(new tim::sqlite_query(shards->db(k), LATEST_SQL));
+        _latest.push_back(_queries.back().get());
+        _queries.emplace_back(new tim::sqlite_query(shards->db(k), OLDER_SQL));
+        _older.push_back(_queries.back().get());
+        _queries.emplace_back(new tim::sqlite_query(shards->db(k), NEWER_SQL));
+        _newer.push_back(_queries.back().get());
+    }
+}
+
+bool tim::p::timeline::read(tim::sqlite_query &query, tim::p::timeline_row &row, bool &done)
+{
+    if (!query.next(&done, row.key.id, row.post.user_id, row.post.post_id, row.key.timestamp, row.post.text))
+        return false;
+
+    if (!done)
+    {
+        row.post.id = row.key.id;
+        row.post.timestamp = row.key.timestamp;
+    }
+
+    return true;
+}
+
+/**
+ * Merges the rows of the queries, read newest first if backward, into
+ * a page of count posts at most.
+ */
+bool tim::p::timeline::fetch(const std::vector<tim::sqlite_query *> &queries,
+                             bool backward,
+                             std::size_t count,
+                             const tim::p::timeline_key *from,
+                             bool update_first,
+                             bool update_last,
+                             std::size_t &fetched)
+{
+    assert(count > 0);
+
+    // The next row of the page is on top.
+    const auto after = [backward](const tim::p::timeline_row &a, const tim::p::timeline_row &b)
+        {
+            return backward
+                       ? a.key < b.key
+                       : b.key < a.key;
+        };
+
+    std::vector<tim::p::timeline_row> heads;
+    heads.reserve(queries.size());
+
+    bool ok = true;
+    for (tim::sqlite_query *query: queries)
+    {
+        ok = (query->prepared()
+                  || query->prepare())
+                && query->bind(":count", (std::int64_t)count)
+                && (!from
+                        || (query->bind(":timestamp", from->timestamp)
+                                && query->bind(":id", from->id)));
+
+        tim::p::timeline_row row;
+        row.source = query;
+        bool done = false;
+        if (!ok
+                || !(ok = read(*query, row, done)))
+            break;
+
+        if (!done)
+            heads.push_back(std::move(row));
+    }
+
+    std::make_heap(heads.begin(), heads.end(), after);
+
+    std::vector<tim::p::timeline_row> page;
+    while (ok
+                && page.size() < count
+                && !heads.empty())
+    {
+        std::pop_heap(heads.begin(), heads.end(), after);
+        page.push_back(heads.back());
+
+        bool done = false;
+        if (!(ok = read(*heads.back().source, heads.back(), done)))
+            break;
+
+        if (done)
+            heads.pop_back();
+        else
+            std::push_heap(heads.begin(), heads.end(), after);
+    }
+
+    for (tim::sqlite_query *query: queries)
+        if (query->prepared())
+        {
+            query->reset();
+            query->clear_bindings();
+        }
+
+    if (!ok)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to read the timeline page."_en,
+                              "Ошибка при чтении страницы ленты сообщений."_ru));
+
+    if (backward)
+        std::reverse(page.begin(), page.end());
+
+    for (const tim::p::timeline_row &row: page)
+        _q->fetched(row.post);
+
+    if (!page.empty())
+    {
+        if (update_first)
+            _first = page.front().key;
+        if (update_last)
+            _last = page.back().key;
+    }
+
+    fetched = page.size();
+
+    return true;
+}
+
+bool tim::p::timeline::fetch_older(std::size_t count, std::size_t &fetched)
+{
+    if (_month.empty())
+        return fetch(_older, true, count, &_first, true, false, fetched);
+
+    assert(_archive);
+
+    std::string schema;
+    if (!_archive->attach(_month, schema))
+        return false;
+
+    // Everything may be archived already.
+    tim::p::timeline_key from = _first;
+    if (from.id.empty())
+        from.timestamp = std::numeric_limits<std::int64_t>::max();
+
+    tim::sqlite_query query(_db, tim::sprintf(ARCHIVE_OLDER_SQL, schema.c_str()));
+    return fetch({ &query }, true, count, &from, true, false, fetched);
+}
+
+void tim::p::timeline::next_source()
+{
+    if (!_archive)
+    {
+        _at_begin = true;
+        return;
+    }
+
+    // By the name, the months may be added while paging. Newest first.
+    const std::vector<std::string> &months = _archive->months();
+    std::vector<std::string>::const_iterator it = _month.empty()
+                                                      ? months.begin()
+                                                      : std::upper_bound(months.begin(), months.end(), _month,
+                                                                         std::greater<std::string>());
+    if (it != months.end())
+        _month = *it;
+    else
+        _at_begin = true;
+}
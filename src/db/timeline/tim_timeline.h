@@ -0,0 +1,60 @@
+#pragma once
+
+#include "tim_signal.h"
+
+#include <cstddef>
+#include <memory>
+
+
+namespace tim
+{
+
+class post_archive;
+class post_shards;
+class sqlite_db;
+struct post;
+
+namespace p
+{
+
+struct timeline;
+
+}
+
+/**
+ * Keyset-paginated view of the posts ordered by (timestamp, id).
+ *
+ * Every page is emitted through the fetched signal in chronological order.
+ * Pages are located by seeking the (timestamp, id) index of every shard
+ * from the page boundary, so the cost of a page does not depend on how
+ * deep it is. The shards stream their rows in page order and a k-way
+ * merge on (timestamp, id) takes the page from them, reading no more
+ * than a row per shard past it.
+ * Once the main database runs out of older posts, paging goes on through
+ * the archive months, newest first; a page does not span two sources.
+ * The slots must not call the timeline back.
+ */
+class timeline
+{
+
+public:
+
+    tim::signal<const tim::post & /* post */> fetched;
+
+    timeline(const tim::sqlite_db *db, const tim::post_shards *shards, tim::post_archive *archive = nullptr);
+    ~timeline();
+
+    bool latest(std::size_t count);
+    bool older(std::size_t count);
+    bool newer(std::size_t count);
+
+    bool empty() const;
+    bool at_begin() const;
+    void reset();
+
+private:
+
+    std::unique_ptr<tim::p::timeline> _d;
+};
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "tim_post.h"
+#include "tim_sqlite_query.h"
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace tim
+{
+
+class post_archive;
+class post_shards;
+class timeline;
+
+namespace p
+{
+
+struct timeline_key
+{
+    std::int64_t timestamp = 0;
+    std::string id;
+
+    bool operator<(const tim::p::timeline_key &other) const
+    {
+        return timestamp < other.timestamp
+                   || (timestamp == other.timestamp
+                           && id < other.id);
+    }
+};
+
+// The head of a source in the merge.
+struct timeline_row
+{
+    tim::p::timeline_key key;
+    tim::post post;
+    tim::sqlite_query *source = nullptr;
+};
+
+struct timeline
+{
+    timeline(tim::timeline *q, const tim::sqlite_db *db, const tim::post_shards *shards, tim::post_archive *archive);
+
+    static bool read(tim::sqlite_query &query, tim::p::timeline_row &row, bool &done);
+
+    bool fetch(const std::vector<tim::sqlite_query *> &queries,
+               bool backward,
+               std::size_t count,
+               const tim::p::timeline_key *from,
+               bool update_first,
+               bool update_last,
+               std::size_t &fetched);
+    bool fetch_older(std::size_t count, std::size_t &fetched);
+    void next_source();
+
+    tim::timeline *const _q;
+
+    const tim::sqlite_db *const _db;
+    tim::post_archive *const _archive;
+
+    std::vector<std::unique_ptr<tim::sqlite_query>> _queries;
+    std::vector<tim::sqlite_query *> _latest; // By shard.
+    std::vector<tim::sqlite_query *> _older;
+    std::vector<tim::sqlite_query *> _newer;
+
+    tim::p::timeline_key _first; // The oldest post fetched.
+    tim::p::timeline_key _last; // The newest post fetched.
+    std::string _month; // The archive month being read, the shards if empty.
+    bool _at_begin = false;
+};
+
+}
+
+}
@@ -0,0 +1,724 @@
+#include "tim_jsonl_transfer.h"
+
+#include "tim_jsonl_transfer_p.h"
+
+#include "tim_config.h"
+#include "tim_file_tools.h"
+#include "tim_json.h"
+#include "tim_post_shards.h"
+#include "tim_sqlite_db.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+#include "tim_uuid.h"
+
+#include "mbedtls/base64.h"
+#include "sqlite3.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// The replies look their posts up in the staged ones too.
+static const char *const PREPARE_SQL =
+R"(CREATE TEMP TABLE IF NOT EXISTS import_post (id, user_id, post_id, timestamp, text);
+CREATE INDEX IF NOT EXISTS temp.import_post_id ON import_post(id);
+DELETE FROM temp.import_post;)";
+
+// Posts are moved from the staging table with one statement per batch.
+// The FTS5 index is filled by the post triggers several times faster
+// that way than with one statement per post.
+static const char *const FLUSH_SQL =
+R"(INSERT OR IGNORE INTO main.post (id, user_id, post_id, timestamp, text)
+    SELECT id, user_id, post_id, timestamp, text
+        FROM temp.import_post
+        ORDER BY rowid)";
+
+static const char *const LOCATE_SQL =
+R"(SELECT 1 FROM temp.import_post WHERE id = :id
+UNION ALL
+SELECT 1 FROM main.post WHERE id = :id
+LIMIT 1)";
+
+static const char *const STAGED_SQL =
+R"(SELECT id, user_id, post_id, timestamp, text
+    FROM temp.import_post
+    ORDER BY rowid)";
+
+
+// Public
+
+tim::jsonl_transfer::jsonl_transfer(tim::sqlite_db *db, tim::post_shards *shards)
+    : _d(new tim::p::jsonl_transfer(this))
+{
+    assert(db);
+    assert(db->is_open());
+    assert(shards);
+
+    _d->_db = db;
+    _d->_shards = shards;
+    _d->_inserts.resize(_d->database_count());
+    _d->_stages.resize(_d->database_count());
+    _d->_locates.resize(shards->count());
+    _d->_staged.resize(shards->count());
+}
+
+tim::jsonl_transfer::~jsonl_transfer() = default;
+
+bool tim::jsonl_transfer::import_file(const std::filesystem::path &path)
+{
+    _d->_stats = {};
+    std::fill(_d->_staged.begin(), _d->_staged.end(), 0);
+    _d->_batch_rows = 0;
+
+    std::error_code ec;
+    const std::uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to open file '%s': %s"_en,
+                              "Ошибка при открытии файла '%s': %s"_ru),
+                        path.string().c_str(),
+                        ec.message().c_str());
+
+    for (std::size_t k = 0; k < _d->_shards->count(); ++k)
+        if (!_d->_shards->db(k)->exec(PREPARE_SQL))
+            return false;
+
+    if (!_d->begin())
+        return false;
+
+    // A line split between two chunks is carried over, so only
+    // the longest line is ever copied.
+    std::string line;
+    bool ok = true;
+    const std::size_t processed = tim::process_file(path,
+        [&](const tim::byte_vector &chunk)
+        {
+            const char *begin = (const char *)chunk.data();
+            const char *const end = begin + chunk.size();
+            while (begin < end)
+            {
+                const char *eol = (const char *)std::memchr(begin, '\n', end - begin);
+                if (!eol)
+                {
+                    line.append(begin, end);
+                    if (line.size() > tim::DB_TRANSFER_MAX_LINE)
+                        ok = TIM_TRACE(Error,
+                                      TIM_TR("Line %zu of file '%s' is too long."_en,
+                                            "Строка %zu файла '%s' слишком длинная."_ru),
+                                      _d->_stats.lines + 1,
+                                      path.string().c_str());
+                    break;
+                }
+
+                if (line.empty())
+                    ok = _d->import_line(begin, eol);
+                else
+                {
+                    line.append(begin, eol);
+                    ok = _d->import_line(line.data(), line.data() + line.size());
+                    line.clear();
+                }
+
+                if (!ok)
+                    break;
+
+                begin = eol + 1;
+            }
+
+            return ok;
+        },
+        tim::DB_TRANSFER_CHUNK_SIZE);
+
+    if (ok
+            && !line.empty())
+        ok = _d->import_line(line.data(), line.data() + line.size());
+
+    ok = ok
+            && processed == size;
+
+    if (!ok)
+    {
+        _d->rollback();
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to import file '%s', stopped at line %zu."_en,
+                              "Ошибка при импорте файла '%s', остановлено на строке %zu."_ru),
+                        path.string().c_str(),
+                        _d->_stats.lines);
+    }
+
+    if (!_d->commit_batch(true))
+    {
+        _d->rollback();
+        return false;
+    }
+
+    return true;
+}
+
+bool tim::jsonl_transfer::export_file(const std::filesystem::path &path)
+{
+    _d->_stats = {};
+
+    std::vector<char> buf(tim::DB_TRANSFER_CHUNK_SIZE);
+    std::ofstream os;
+    os.rdbuf()->pubsetbuf(buf.data(), buf.size());
+    os.open(path, std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to open file '%s': %s"_en,
+                              "Ошибка при открытии файла '%s': %s"_ru),
+                        path.string().c_str(),
+                        std::strerror(errno));
+
+    // One read transaction per database. Nothing else writes them while
+    // the application exports, so the tables are consistent.
+    if (!_d->begin())
+        return false;
+
+    bool ok = true;
+    for (std::size_t table = 0; ok && table < tim::p::jsonl_transfer::tables().size(); ++table)
+    {
+        const tim::p::jsonl_transfer::table &t = tim::p::jsonl_transfer::tables()[table];
+        const bool is_main = table == tim::p::jsonl_transfer::USER_TABLE;
+        const std::size_t end = is_main
+                                    ? 1
+                                    : _d->database_count();
+        for (std::size_t db = is_main ? 0 : 1; db < end; ++db)
+        {
+            tim::sqlite_query q(_d->database(db), t.select_sql);
+            if (!q.prepare())
+            {
+                ok = false;
+                break;
+            }
+
+            nlohmann::json j = nlohmann::json::object();
+            bool done = false;
+            while ((ok = q.next(&done))
+                        && !done)
+            {
+                j.clear();
+                j["type"] = t.name;
+                for (int i = 0; t.columns[i]; ++i)
+                    if (q.type(i) != SQLITE_NULL)
+                        j[t.columns[i]] = tim::p::jsonl_transfer::encode(q, i);
+
+                os << j.dump() << '\n';
+                ++_d->_stats.lines;
+                ++_d->_stats.rows;
+            }
+
+            if (!ok
+                    || !os)
+            {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    for (std::size_t db = 0; db < _d->database_count(); ++db)
+        _d->database(db)->commit();
+    os.close();
+
+    if (!ok
+            || !os)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to export to file '%s'."_en,
+                              "Ошибка при экспорте в файл '%s'."_ru),
+                        path.string().c_str());
+
+    return true;
+}
+
+const tim::jsonl_transfer::statistics &tim::jsonl_transfer::stats() const
+{
+    return _d->_stats;
+}
+
+
+// Private
+
+const std::array<tim::p::jsonl_transfer::table, 3> &tim::p::jsonl_transfer::tables()
+{
+    static const std::array<table, 3> tables =
+    {{
+        {
+            "user",
+            "INSERT OR IGNORE INTO user (id, pub_key, nick, icon, motto) VALUES (?, ?, ?, ?, ?)",
+            nullptr,
+            "SELECT id, pub_key, nick, icon, motto FROM user",
+            { "id", "pub_key", "nick", "icon", "motto", nullptr }
+        },
+        {
+            "post",
+            "INSERT OR IGNORE INTO post (id, user_id, post_id, timestamp, text) VALUES (?, ?, ?, ?, ?)",
+            "INSERT INTO temp.import_post (id, user_id, post_id, timestamp, text) VALUES (?, ?, ?, ?, ?)",
+            "SELECT id, user_id, post_id, timestamp, text FROM post ORDER BY timestamp, rowid",
+            { "id", "user_id", "post_id", "timestamp", "text", nullptr }
+        },
+        {
+            "reaction",
+            // Unlike OR IGNORE, the upsert still fails a reaction without a user.
+            "INSERT INTO reaction (id, post_id, user_id, timestamp, weight) VALUES (?, ?, ?, ?, ?) ON CONFLICT DO NOTHING",
+            nullptr,
+            "SELECT id, post_id, user_id, timestamp, weight FROM reaction ORDER BY timestamp, rowid",
+            { "id", "post_id", "user_id", "timestamp", "weight", nullptr }
+        }
+    }};
+
+    return tables;
+}
+
+bool tim::p::jsonl_transfer::is_utf8(std::string_view s)
+{
+    // As strict as nlohmann::json::dump(): no overlong forms, surrogates
+    // or code points above U+10FFFF.
+    for (std::size_t i = 0; i < s.size();)
+    {
+        const unsigned char c = s[i];
+        std::size_t n = 0;
+        char32_t cp = 0;
+        char32_t min = 0;
+        if (c < 0x80)
+        {
+            ++i;
+            continue;
+        }
+        else if ((c & 0xE0) == 0xC0)
+        {
+            n = 1;
+            cp = c & 0x1F;
+            min = 0x80;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            n = 2;
+            cp = c & 0x0F;
+            min = 0x800;
+        }
+        else if ((c & 0xF8) == 0xF0)
+        {
+            n = 3;
+            cp = c & 0x07;
+            min = 0x10000;
+        }
+        else
+            return false;
+
+        if (s.size() - i <= n)
+            return false;
+
+        for (std::size_t k = 1; k <= n; ++k)
+        {
+            const unsigned char b = s[i + k];
+            if ((b & 0xC0) != 0x80)
+                return false;
+            cp = (cp << 6) | (b & 0x3F);
+        }
+
+        if (cp < min
+                || cp > 0x10FFFF
+                || (cp >= 0xD800
+                        && cp <= 0xDFFF))
+            return false;
+
+        i += n + 1;
+    }
+
+    return true;
+}
+
+std::string tim::p::jsonl_transfer::to_base64(tim::byte_view data)
+{
+    std::size_t size = 0;
+    mbedtls_base64_encode(nullptr, 0, &size, data.data, data.size);
+
+    std::string s(size, '\0');
+    mbedtls_base64_encode((unsigned char *)s.data(), s.size(), &size, data.data, data.size);
+    s.resize(size);
+
+    return s;
+}
+
+bool tim::p::jsonl_transfer::from_base64(const std::string &s, std::string &data)
+{
+    std::size_t size = 0;
+    if (mbedtls_base64_decode(nullptr, 0, &size, (const unsigned char *)s.data(), s.size())
+            == MBEDTLS_ERR_BASE64_INVALID_CHARACTER)
+        return false;
+
+    data.resize(size);
+    if (mbedtls_base64_decode((unsigned char *)data.data(), data.size(), &size,
+                              (const unsigned char *)s.data(), s.size()))
+        return false;
+
+    data.resize(size);
+    return true;
+}
+
+nlohmann::json tim::p::jsonl_transfer::encode(const tim::sqlite_query &q, int index)
+{
+    switch (q.type(index))
+    {
+        case SQLITE_INTEGER:
+            return q.to_int64(index);
+
+        case SQLITE_FLOAT:
+            return q.to_double(index);
+
+        case SQLITE_BLOB:
+            return { { "blob", to_base64(q.to_blob(index)) } };
+
+        default:
+        {
+            // Raw telnet bytes would make dump() fail.
+            const std::string_view s = q.to_string_view(index);
+            if (is_utf8(s))
+                return s;
+
+            return { { "base64", to_base64({ (const std::uint8_t *)s.data(), s.size() }) } };
+        }
+    }
+}
+
+bool tim::p::jsonl_transfer::bind_encoded(tim::sqlite_query *q, int index, const nlohmann::json &j)
+{
+    assert(q);
+
+    const bool blob = j.contains("blob");
+    const nlohmann::json::const_iterator it = j.find(blob
+                                                         ? "blob"
+                                                         : "base64");
+    std::string data;
+    if (j.size() != 1
+            || it == j.end()
+            || !it->is_string()
+            || !from_base64(it->get_ref<const std::string &>(), data))
+        return false;
+
+    return blob
+               ? q->bind(index, tim::byte_view{ (const std::uint8_t *)data.data(), data.size() })
+               : q->bind(index, data);
+}
+
+std::size_t tim::p::jsonl_transfer::database_count() const
+{
+    return _shards->count() + 1;
+}
+
+tim::sqlite_db *tim::p::jsonl_transfer::database(std::size_t db) const
+{
+    return db
+               ? _shards->db(db - 1)
+               : _db;
+}
+
+tim::sqlite_query *tim::p::jsonl_transfer::statement(std::size_t db, std::size_t table, bool stage)
+{
+    std::unique_ptr<tim::sqlite_query> &q = stage
+                                                ? _stages[db][table]
+                                                : _inserts[db][table];
+    if (!q)
+    {
+        q.reset(new tim::sqlite_query(database(db),
+                                      stage
+                                          ? tables()[table].stage_sql
+                                          : tables()[table].insert_sql));
+        if (!q->prepare())
+        {
+            q.reset();
+            return nullptr;
+        }
+    }
+
+    return q.get();
+}
+
+/**
+ * Finds the shard of a post, staged or not.
+ */
+bool tim::p::jsonl_transfer::locate(const nlohmann::json &post_id, std::size_t &shard)
+{
+    if (!post_id.is_string())
+        return false;
+
+    for (std::size_t k = 0; k < _locates.size(); ++k)
+    {
+        std::unique_ptr<tim::sqlite_query> &q = _locates[k];
+        if (!q)
+        {
+            q.reset(new tim::sqlite_query(_shards->db(k), LOCATE_SQL));
+            if (!q->prepare())
+            {
+                q.reset();
+                return false;
+            }
+        }
+
+        bool done = true;
+        const bool ok = q->bind(":id", post_id.get_ref<const std::string &>())
+                            && q->next(&done);
+
+        q->reset();
+        q->clear_bindings();
+
+        if (ok
+                && !done)
+        {
+            shard = k;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool tim::p::jsonl_transfer::import_line(const char *begin, const char *end)
+{
+    ++_stats.lines;
+
+    while (begin < end
+                && std::isspace((unsigned char)*begin))
+        ++begin;
+    if (begin == end)
+        return true;
+
+    const nlohmann::json j = nlohmann::json::parse(begin, end, nullptr, false);
+    const nlohmann::json::const_iterator type = j.is_object()
+                                                    ? j.find("type")
+                                                    : j.end();
+    std::size_t index = 0;
+    if (type != j.end()
+            && type->is_string())
+        while (index < tables().size()
+                    && *type != tables()[index].name)
+            ++index;
+    else
+        index = tables().size();
+
+    if (index == tables().size())
+    {
+        TIM_TRACE(Warning,
+                  TIM_TR("Line %zu is not a user, post or reaction."_en,
+                         "Строка %zu не является пользователем, сообщением или реакцией."_ru),
+                  _stats.lines);
+        ++_stats.rejected;
+        return true;
+    }
+
+    // A root post goes to the shard of its author, the rest follow their
+    // post. Reactions may refer to the staged posts.
+    const table &t = tables()[index];
+    const bool stage = t.stage_sql != nullptr;
+    std::size_t db = 0;
+    if (index != USER_TABLE)
+    {
+        const nlohmann::json::const_iterator post_id = j.find("post_id");
+        const nlohmann::json::const_iterator user_id = j.find("user_id");
+        std::size_t shard = 0;
+        if (post_id != j.end()
+                && !post_id->is_null())
+        {
+            if (!locate(*post_id, shard))
+            {
+                ++_stats.rejected;
+                return commit_batch(false);
+            }
+        }
+        else
+            shard = _shards->shard(user_id != j.end()
+                                           && user_id->is_string()
+                                       ? tim::uuid(user_id->get_ref<const std::string &>())
+                                       : tim::uuid());
+
+        if (!stage
+                && !flush(shard))
+            return false;
+
+        db = shard + 1;
+    }
+
+    tim::sqlite_query *q = statement(db, index, stage);
+    if (!q)
+        return false;
+
+    // Missing fields stay NULL.
+    bool ok = true;
+    for (int i = 0; ok && t.columns[i]; ++i)
+    {
+        const nlohmann::json::const_iterator it = j.find(t.columns[i]);
+        if (it == j.end())
+            continue;
+
+        switch (it->type())
+        {
+            case nlohmann::json::value_t::string:
+                ok = q->bind(i + 1, it->get_ref<const std::string &>());
+                break;
+
+            case nlohmann::json::value_t::number_integer:
+            case nlohmann::json::value_t::number_unsigned:
+                ok = q->bind(i + 1, it->get<std::int64_t>());
+                break;
+
+            case nlohmann::json::value_t::number_float:
+                ok = q->bind(i + 1, it->get<double>());
+                break;
+
+            case nlohmann::json::value_t::object:
+                ok = bind_encoded(q, i + 1, *it);
+                break;
+
+            case nlohmann::json::value_t::null:
+                break;
+
+            default:
+                ok = false;
+                break;
+        }
+    }
+
+    // A constraint violation fails the statement, not the transaction.
+    // Rows already present are ignored and not counted.
+    if (!ok
+            || !q->exec())
+        ++_stats.rejected;
+    else if (stage)
+        ++_staged[db - 1];
+    else
+        _stats.rows += sqlite3_changes(database(db)->sqlite());
+
+    q->reset();
+    q->clear_bindings();
+
+    return commit_batch(false);
+}
+
+bool tim::p::jsonl_transfer::flush(std::size_t shard)
+{
+    if (!_staged[shard])
+        return true;
+
+    _staged[shard] = 0;
+
+    tim::sqlite_db *db = _shards->db(shard);
+    if (db->exec(FLUSH_SQL))
+        _stats.rows += sqlite3_changes(db->sqlite());
+    else
+    {
+        // A single bad post fails the whole batch, so it is moved post by post.
+        tim::sqlite_query staged(db, STAGED_SQL);
+        tim::sqlite_query *q = statement(shard + 1, POST_TABLE, false);
+        if (!q
+                || !staged.prepare())
+            return false;
+
+        bool done = false;
+        while (staged.next(&done)
+                    && !done)
+        {
+            bool ok = true;
+            for (int i = 0; ok && i < (int)staged.column_count(); ++i)
+                switch (staged.type(i))
+                {
+                    case SQLITE_INTEGER:
+                        ok = q->bind(i + 1, staged.to_int64(i));
+                        break;
+
+                    case SQLITE_FLOAT:
+                        ok = q->bind(i + 1, staged.to_double(i));
+                        break;
+
+                    case SQLITE_BLOB:
+                        ok = q->bind(i + 1, staged.to_blob(i));
+                        break;
+
+                    case SQLITE_NULL:
+                        break;
+
+                    default:
+                        ok = q->bind(i + 1, staged.to_string(i));
+                        break;
+                }
+
+            if (!ok
+                    || !q->exec())
+                ++_stats.rejected;
+            else
+                _stats.rows += sqlite3_changes(db->sqlite());
+
+            q->reset();
+            q->clear_bindings();
+        }
+
+        if (!done)
+            return false;
+    }
+
+    return db->exec("DELETE FROM temp.import_post");
+}
+
+bool tim::p::jsonl_transfer::flush()
+{
+    for (std::size_t k = 0; k < _staged.size(); ++k)
+        if (!flush(k))
+            return false;
+
+    return true;
+}
+
+bool tim::p::jsonl_transfer::begin()
+{
+    for (std::size_t db = 0; db < database_count(); ++db)
+        if (!database(db)->begin())
+        {
+            rollback();
+            return false;
+        }
+
+    return true;
+}
+
+void tim::p::jsonl_transfer::rollback()
+{
+    for (std::size_t db = 0; db < database_count(); ++db)
+        if (database(db)->is_transaction_active())
+            database(db)->rollback();
+}
+
+/**
+ * Commits the databases one by one, a batch is not atomic across them.
+ */
+bool tim::p::jsonl_transfer::commit_batch(bool last)
+{
+    if (!last
+            && ++_batch_rows < tim::DB_TRANSFER_BATCH_SIZE)
+        return true;
+
+    _batch_rows = 0;
+
+    if (!flush())
+        return false;
+
+    for (std::size_t db = 0; db < database_count(); ++db)
+        if (!database(db)->commit())
+            return false;
+
+    if (!last)
+        return begin();
+
+    TIM_TRACE(Info,
+              TIM_TR("%zu lines read, %zu rows imported, %zu rejected."_en,
+                     "Прочитано строк: %zu, импортировано записей: %zu, отклонено: %zu."_ru),
+              _stats.lines,
+              _stats.rows,
+              _stats.rejected);
+
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+
+namespace tim
+{
+
+class post_shards;
+class sqlite_db;
+
+namespace p
+{
+
+struct jsonl_transfer;
+
+}
+
+/**
+ * Bulk import and export of the user, post and reaction tables as JSON Lines.
+ *
+ * Every line is an object with the table name in "type" and the columns
+ * as fields, like {"type":"post","id":"{...}","user_id":"{...}",...}.
+ * Text that is not valid UTF-8 is written as {"base64":"..."} and blobs
+ * as {"blob":"..."}, so any value stored goes back as it was.
+ * Export writes users, then the posts and then the reactions of every
+ * shard by time, so that a reply follows its post and a reaction its
+ * post. Import reads the file in DB_TRANSFER_CHUNK_SIZE chunks through
+ * cached statements and commits every DB_TRANSFER_BATCH_SIZE rows, so
+ * the memory used does not depend on the file size. A root post goes to
+ * the shard of its author, a reply or a reaction to the shard of its
+ * post. Posts are staged in a temporary table of their shard and moved
+ * with one statement per batch. Lines that are not valid JSON, of an
+ * unknown type or rejected by the database, like a reaction without
+ * a user, are counted and skipped, so are the replies and reactions to
+ * posts in no shard. Rows already present are left as they are and not
+ * counted as imported.
+ */
+class jsonl_transfer
+{
+
+public:
+
+    struct statistics
+    {
+        std::size_t lines = 0;
+        std::size_t rows = 0;
+        std::size_t rejected = 0;
+    };
+
+    jsonl_transfer(tim::sqlite_db *db, tim::post_shards *shards);
+    ~jsonl_transfer();
+
+    bool import_file(const std::filesystem::path &path);
+    bool export_file(const std::filesystem::path &path);
+
+    const statistics &stats() const;
+
+private:
+
+    std::unique_ptr<tim::p::jsonl_transfer> _d;
+};
+
+}
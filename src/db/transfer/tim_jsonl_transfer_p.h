@@ -0,0 +1,69 @@
+#pragma once
+
+#include "tim_jsonl_transfer.h"
+
+#include "tim_json.h"
+#include "tim_sqlite_query.h"
+
+#include <array>
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace tim::p
+{
+
+struct jsonl_transfer
+{
+    struct table
+    {
+        const char *name;
+        const char *insert_sql;
+        const char *stage_sql; // Rows are staged and moved in batches if set.
+        const char *select_sql;
+        std::array<const char *, 6> columns; // Null terminated.
+    };
+
+    static const std::array<table, 3> &tables();
+    static const std::size_t USER_TABLE = 0; // The only one in the main database.
+    static const std::size_t POST_TABLE = 1; // The only staged one.
+
+    explicit jsonl_transfer(tim::jsonl_transfer *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    static bool is_utf8(std::string_view s);
+    static std::string to_base64(tim::byte_view data);
+    static bool from_base64(const std::string &s, std::string &data);
+    static nlohmann::json encode(const tim::sqlite_query &q, int index);
+    static bool bind_encoded(tim::sqlite_query *q, int index, const nlohmann::json &j);
+
+    std::size_t database_count() const;
+    tim::sqlite_db *database(std::size_t db) const;
+    tim::sqlite_query *statement(std::size_t db, std::size_t table, bool stage);
+    bool locate(const nlohmann::json &post_id, std::size_t &shard);
+    bool import_line(const char *begin, const char *end);
+    bool flush(std::size_t shard);
+    bool flush();
+    bool begin();
+    void rollback();
+    bool commit_batch(bool last);
+
+    tim::jsonl_transfer *const _q;
+
+    // The database 0 is the main one, the database k + 1 the shard k.
+    tim::sqlite_db *_db = nullptr;
+    tim::post_shards *_shards = nullptr;
+    std::vector<std::array<std::unique_ptr<tim::sqlite_query>, 3>> _inserts; // By database and table, prepared on first use.
+    std::vector<std::array<std::unique_ptr<tim::sqlite_query>, 3>> _stages;
+    std::vector<std::unique_ptr<tim::sqlite_query>> _locates; // By shard.
+    std::vector<std::size_t> _staged; // By shard, rows in temp.import_post.
+    std::size_t _batch_rows = 0;
+    tim::jsonl_transfer::statistics _stats;
+};
+
+}
@@ -0,0 +1,122 @@
+#include "tim_user_directory.h"
+
+#include "tim_user_directory_p.h"
+
+#include "tim_application.h"
+#include "tim_config.h"
+#include "tim_mqtt_client.h"
+#include "tim_sqlite_db.h"
+#include "tim_sqlite_query.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+
+// Public
+
+tim::user_directory::user_directory(const tim::sqlite_db *db)
+    : changed()
+    , _d(new tim::p::user_directory(this))
+{
+    assert(db);
+
+    _d->_db = db;
+    _d->_index.reserve(tim::USER_CACHE_SIZE);
+
+    tim::app()->mqtt()->connected.connect(std::bind(&tim::p::user_directory::subscribe, _d.get()));
+
+    if (tim::app()->mqtt()->is_connected())
+        _d->subscribe();
+}
+
+tim::user_directory::~user_directory() = default;
+
+const tim::user &tim::user_directory::find(const tim::uuid &id)
+{
+    std::unordered_map<tim::uuid, std::list<tim::user>::iterator>::iterator it = _d->_index.find(id);
+    if (it != _d->_index.end())
+    {
+        ++_d->_stats.hits;
+        _d->_users.splice(_d->_users.begin(), _d->_users, it->second);
+        return *it->second;
+    }
+
+    ++_d->_stats.misses;
+
+    if (_d->_users.size() >= tim::USER_CACHE_SIZE)
+    {
+        ++_d->_stats.evictions;
+        _d->_index.erase(_d->_users.back().id);
+        _d->_users.pop_back();
+    }
+
+    tim::user &user = _d->_users.emplace_front();
+    user.id = id;
+    _d->load(user);
+    _d->_index.emplace(id, _d->_users.begin());
+    _d->_stats.size = _d->_users.size();
+
+    return user;
+}
+
+void tim::user_directory::invalidate(const tim::uuid &id)
+{
+    std::unordered_map<tim::uuid, std::list<tim::user>::iterator>::iterator it = _d->_index.find(id);
+    if (it != _d->_index.end())
+    {
+        _d->_users.erase(it->second);
+        _d->_index.erase(it);
+        _d->_stats.size = _d->_users.size();
+    }
+
+    changed(id);
+}
+
+void tim::user_directory::clear()
+{
+    _d->_users.clear();
+    _d->_index.clear();
+    _d->_stats.size = 0;
+}
+
+const tim::user_directory::statistics &tim::user_directory::stats() const
+{
+    return _d->_stats;
+}
+
+
+// Private
+
+void tim::p::user_directory::subscribe()
+{
+    tim::app()->mqtt()->subscribe("user/#",
+                                  std::bind(&tim::p::user_directory::on_event, this,
+                                            std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void tim::p::user_directory::on_event(const std::filesystem::path &topic, const char *data, std::size_t size)
+{
+    // "user/connect" carries the user id, the others end with it.
+    const std::string s = topic.filename() == "connect"
+                                ? std::string(data, size)
+                                : topic.filename().string();
+
+    tim::uuid id;
+    if (id.from_chars(s.data(), s.size()))
+        _q->invalidate(id);
+}
+
+bool tim::p::user_directory::load(tim::user &user) const
+{
+    tim::sqlite_query q(_db, "SELECT pub_key, nick, icon, motto FROM user WHERE id = ?");
+
+    bool done = true;
+    if (!q.prepare()
+            || !q.bind(1, user.id.to_string())
+            || !q.next(&done, user.pub_key, user.nick, user.icon, user.motto))
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to load user '%s'."_en,
+                              "Ошибка при загрузке пользователя '%s'."_ru),
+                        user.id.to_string().c_str());
+
+    return !done;
+}
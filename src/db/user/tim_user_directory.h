@@ -0,0 +1,61 @@
+#pragma once
+
+#include "tim_signal.h"
+
+#include <cstddef>
+#include <memory>
+
+
+namespace tim
+{
+
+class sqlite_db;
+class uuid;
+struct user;
+
+namespace p
+{
+
+struct user_directory;
+
+}
+
+/**
+ * LRU cache of the users, loaded from the user table on first use.
+ *
+ * Unknown users are cached too, as users with only the id set, so a
+ * lookup in steady state never touches the database. A user is dropped
+ * from the cache when it changes, either through invalidate() or on a
+ * "user/#" MQTT event, and reloaded on the next lookup.
+ */
+class user_directory
+{
+
+public:
+
+    tim::signal<const tim::uuid & /* user_id */> changed;
+
+    struct statistics
+    {
+        std::size_t size = 0;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+    };
+
+    explicit user_directory(const tim::sqlite_db *db);
+    ~user_directory();
+
+    // The reference stays valid until the next lookup.
+    const tim::user &find(const tim::uuid &id);
+    void invalidate(const tim::uuid &id);
+    void clear();
+
+    const statistics &stats() const;
+
+private:
+
+    std::unique_ptr<tim::p::user_directory> _d;
+};
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "tim_user_directory.h"
+
+#include "tim_user.h"
+
+#include <cassert>
+#include <filesystem>
+#include <list>
+#include <unordered_map>
+
+
+namespace tim::p
+{
+
+struct user_directory
+{
+    explicit user_directory(tim::user_directory *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    void subscribe();
+    void on_event(const std::filesystem::path &topic, const char *data, std::size_t size);
+    bool load(tim::user &user) const;
+
+    tim::user_directory *const _q;
+
+    const tim::sqlite_db *_db = nullptr;
+    std::list<tim::user> _users; // Most recently used first.
+    std::unordered_map<tim::uuid, std::list<tim::user>::iterator> _index;
+    tim::user_directory::statistics _stats;
+};
+
+}
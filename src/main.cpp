@@ -13,7 +13,5 @@ int main(int argc, char **argv)
 
     std::unique_ptr<tim::application> app(new tim::application(argc, argv));
 
-    app->exec();
-
-    return EXIT_SUCCESS;
+    return app->exec();
 }
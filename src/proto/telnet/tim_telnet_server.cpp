@@ -69,8 +69,6 @@ void tim::telnet_server::process_raw_data(const char *data, std::size_t size)
 
 void tim::p::telnet_server::event_handler(telnet_t *telnet, telnet_event_t *event, void *data)
 {
-    (void) telnet;
-
     tim::p::telnet_server *self = (tim::p::telnet_server *)data;
     assert(self);
 
@@ -91,15 +89,18 @@ void tim::p::telnet_server::event_handler(telnet_t *telnet, telnet_event_t *even
                 case TELNET_TELOPT_NAWS:
                     if (event->sub.size >= 4)
                     {
+                        const unsigned cols = self->_cols;
+                        const unsigned rows = self->_rows;
                         self->_cols = ((std::uint8_t)event->sub.buffer[0] << 8) | (std::uint8_t)event->sub.buffer[1];
                         self->_rows = ((std::uint8_t)event->sub.buffer[2] << 8) | (std::uint8_t)event->sub.buffer[3];
                         TIM_TRACE(Debug, "Terminal size: %ux%u.", self->_cols, self->_rows);
-                    }
-                    break;
 
-                case TELNET_TELOPT_TTYPE:
-                    self->_term_name = std::string(event->sub.buffer, event->sub.size);
-                    TIM_TRACE(Debug, "Terminal name: '%s'.", self->_term_name.c_str());
+                        if (cols
+                                && rows
+                                && (cols != self->_cols
+                                        || rows != self->_rows))
+                            self->_q->resized(self->_q->rows(), self->_q->cols());
+                    }
                     break;
 
                 default:
@@ -108,6 +109,23 @@ void tim::p::telnet_server::event_handler(telnet_t *telnet, telnet_event_t *even
             break;
         }
 
+        case TELNET_EV_WILL:
+            // The client agreed to DO TTYPE, now it is asked for the name.
+            if (event->neg.telopt == TELNET_TELOPT_TTYPE)
+                telnet_ttype_send(telnet);
+            break;
+
+        case TELNET_EV_TTYPE:
+            if (event->ttype.cmd == TELNET_TTYPE_IS
+                    && event->ttype.name
+                    && self->_term_name != event->ttype.name)
+            {
+                self->_term_name = event->ttype.name;
+                TIM_TRACE(Debug, "Terminal name: '%s'.", self->_term_name.c_str());
+                self->_q->terminal_name_changed(self->_term_name);
+            }
+            break;
+
         case TELNET_EV_ERROR:
             TIM_TRACE(Error,
                       TIM_TR("TELNET error: %s"_en,
@@ -5,5 +5,7 @@
 
 tim::a_terminal_protocol::a_terminal_protocol(tim::a_io_device *io)
     : tim::a_protocol(io)
+    , terminal_name_changed()
+    , resized()
 {
 }
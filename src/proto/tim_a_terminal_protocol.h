@@ -2,6 +2,8 @@
 
 #include "tim_a_protocol.h"
 
+#include <string>
+
 
 namespace tim
 {
@@ -11,6 +13,9 @@ class a_terminal_protocol : public tim::a_protocol
 
 public:
 
+    tim::signal<const std::string & /* name */> terminal_name_changed;
+    tim::signal<std::size_t /* rows */, std::size_t /* cols */> resized; // Not on the first size reported.
+
     explicit a_terminal_protocol(tim::a_io_device *io);
 
     virtual const std::string &terminal_name() const = 0;
@@ -0,0 +1,122 @@
+#include "tim_tcl_cmd_db.h"
+
+#include "tim_a_terminal.h"
+#include "tim_application.h"
+#include "tim_sqlite_backup.h"
+#include "tim_sqlite_maintenance.h"
+#include "tim_tcl.h"
+#include "tim_tcl_cmd.h"
+#include "tim_translator.h"
+#include "tim_user_directory.h"
+
+#include "lil.hpp"
+
+#include <cassert>
+#include <cstring>
+
+
+// Static
+
+static lil_value_t tim_tcl_cmd_backup(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    tim::sqlite_backup *backup = tim::app()->db_backup();
+    const char *action = argc ? lil_to_string(argv[0]) : "status";
+
+    // The copy goes to the backup folder only, and is cancelled
+    // by the session that started it.
+    if (!std::strcmp(action, "start") && argc == 1)
+    {
+        if (!backup->start(tcl))
+        {
+            lil_set_error(lil,
+                          TIM_TR("Failed to start backup."_en,
+                                 "Не удалось начать резервное копирование."_ru));
+            return nullptr;
+        }
+    }
+    else if (!std::strcmp(action, "cancel") && argc == 1)
+    {
+        if (!backup->cancel(tcl))
+            lil_set_error(lil,
+                          TIM_TR("The backup was not started from this session."_en,
+                                 "Резервное копирование запущено не из этого сеанса."_ru));
+        return nullptr;
+    }
+    else if (std::strcmp(action, "status") || argc > 1)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Usage: backup ?start|cancel|status?"_en,
+                             "Использование: backup ?start|cancel|status?"_ru));
+        return nullptr;
+    }
+
+    if (backup->running())
+        tcl->terminal()->printf(TIM_TR("Backup to '%s': %d of %d pages left\n"_en,
+                                       "Копирование в '%s': осталось %d из %d страниц\n"_ru),
+                                backup->path().string().c_str(),
+                                backup->remaining_page_count(),
+                                backup->total_page_count());
+    else
+        tcl->terminal()->printf(TIM_TR("No backup is running\n"_en,
+                                       "Резервное копирование не выполняется\n"_ru));
+
+    return nullptr;
+}
+
+static lil_value_t tim_tcl_cmd_dbstat(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    (void) argv;
+
+    if (argc)
+    {
+        lil_set_error(lil,
+                      TIM_TR("No arguments expected."_en,
+                             "Команда не имеет параметров."_ru));
+        return nullptr;
+    }
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    const tim::sqlite_maintenance::statistics &s = tim::app()->db_maintenance()->stats();
+
+    tcl->terminal()->printf(TIM_TR("WAL: %zu bytes, %zu frames pending\n"
+                                   "Checkpoints: %zu, busy %zu, last %lld us, max %lld us\n"
+                                   "Free pages: %zu, vacuumed %zu\n"_en,
+                                   "WAL: %zu байт, ожидают переноса %zu кадров\n"
+                                   "Переносов WAL: %zu, не завершено %zu, последний %lld мкс, максимум %lld мкс\n"
+                                   "Свободных страниц: %zu, освобождено %zu\n"_ru),
+                            s.wal_size,
+                            s.wal_frames,
+                            s.checkpoint_count,
+                            s.busy_checkpoint_count,
+                            (long long)s.last_checkpoint_duration.count(),
+                            (long long)s.max_checkpoint_duration.count(),
+                            s.freelist_pages,
+                            s.vacuumed_pages);
+
+    const tim::user_directory::statistics &u = tim::app()->user_directory()->stats();
+
+    tcl->terminal()->printf(TIM_TR("Users cached: %zu, hits %zu, misses %zu, evicted %zu\n"_en,
+                                   "Пользователей в кэше: %zu, попаданий %zu, промахов %zu, вытеснено %zu\n"_ru),
+                            u.size,
+                            u.hits,
+                            u.misses,
+                            u.evictions);
+
+    return nullptr;
+}
+
+
+// Public
+
+void tim::tcl_add_db(lil_t lil)
+{
+    assert(lil);
+
+    TIM_TCL_REGISTER(lil, backup);
+    TIM_TCL_REGISTER(lil, dbstat);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+typedef struct _lil_t *lil_t;
+
+namespace tim
+{
+
+void tcl_add_db(lil_t lil);
+
+}
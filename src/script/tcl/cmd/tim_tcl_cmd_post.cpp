@@ -0,0 +1,286 @@
+#include "tim_tcl_cmd_post.h"
+
+#include "tim_a_protocol.h"
+#include "tim_a_terminal.h"
+#include "tim_application.h"
+#include "tim_config.h"
+#include "tim_mqtt_client.h"
+#include "tim_post.h"
+#include "tim_post_ranking.h"
+#include "tim_post_shards.h"
+#include "tim_post_thread.h"
+#include "tim_signal_connection.h"
+#include "tim_sqlite_query.h"
+#include "tim_tcl.h"
+#include "tim_tcl_cmd.h"
+#include "tim_translator.h"
+#include "tim_user.h"
+#include "tim_user_directory.h"
+
+#include "lil.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+
+// Static
+
+// The id goes on its own line, so that it can be copied to reply.
+static void tim_tcl_print_post(tim::a_terminal *term,
+                               const std::string &prefix,
+                               std::size_t indent,
+                               const tim::uuid &id,
+                               const tim::uuid &user_id,
+                               std::int64_t timestamp,
+                               std::string_view text)
+{
+    assert(term);
+
+    const std::time_t t = timestamp / 1000;
+    char time[32];
+    if (!std::strftime(time, sizeof(time), "%Y-%m-%d %H:%M", std::localtime(&t)))
+        time[0] = '\0';
+
+    term->set_color(term->theme().colors.at(tim::terminal_color_index::Info));
+    term->printf("%s%s ", prefix.c_str(), time);
+    term->set_color(term->theme().colors.at(tim::terminal_color_index::EmText));
+    term->write_str(tim::app()->user_directory()->find(user_id).title());
+    term->set_default_color();
+    term->printf(": %.*s\n", (int)text.size(), text.data());
+    term->set_color(term->theme().colors.at(tim::terminal_color_index::Info));
+    term->printf("%*s%s\n", (int)indent, "", id.to_string(tim::uuid::format::NoBrackets).c_str());
+    term->reset_colors();
+}
+
+static bool tim_tcl_post_id(lil_t lil, lil_value_t value, tim::uuid &post_id)
+{
+    const std::string s = lil_to_string(value);
+    if (post_id.from_chars(s.data(), s.size()))
+        return true;
+
+    lil_set_error(lil,
+                  TIM_TR("Invalid post ID."_en,
+                         "Некорректный идентификатор сообщения."_ru));
+    return false;
+}
+
+static lil_value_t tim_tcl_cmd_hot(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    if (argc > 1)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Invalid number of arguments. Expecting ?count?"_en,
+                             "Некорректные аргументы. Ожидается ?count?"_ru));
+        return nullptr;
+    }
+
+    std::size_t count = tim::TIMELINE_PAGE_SIZE;
+    if (argc == 1)
+    {
+        const lilint_t n = lil_to_integer(argv[0]);
+        if (n <= 0)
+        {
+            lil_set_error(lil,
+                          TIM_TR("The post count must be a positive number."_en,
+                                 "Количество сообщений должно быть положительным числом."_ru));
+            return nullptr;
+        }
+        count = (std::size_t)n;
+    }
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    const std::vector<tim::post_ranking::entry> hot = tim::app()->post_ranking()->hot(count);
+    if (hot.empty())
+    {
+        lil_set_error(lil,
+                      TIM_TR("There are no hot posts."_en,
+                             "Популярных сообщений нет."_ru));
+        return nullptr;
+    }
+
+    // A post is looked up in the shards one by one.
+    const tim::post_shards *shards = tim::app()->post_shards();
+    std::vector<std::unique_ptr<tim::sqlite_query>> queries;
+    for (std::size_t k = 0; k < shards->count(); ++k)
+    {
+        queries.emplace_back(new tim::sqlite_query(shards->db(k), "SELECT user_id, timestamp, text FROM post WHERE id = ?"));
+        if (!queries.back()->prepare())
+        {
+            lil_set_error(lil,
+                          TIM_TR("Failed to read hot posts."_en,
+                                 "Ошибка при чтении популярных сообщений."_ru));
+            return nullptr;
+        }
+    }
+
+    tim::uuid user_id;
+    std::int64_t timestamp = 0;
+    std::string_view text;
+    std::size_t n = 0;
+    bool ok = true;
+    for (const tim::post_ranking::entry &e: hot)
+    {
+        // The post may be archived already.
+        for (const std::unique_ptr<tim::sqlite_query> &q: queries)
+        {
+            bool done = true;
+            ok = q->bind(1, e.post_id.to_string())
+                    && q->next(&done, user_id, timestamp, text);
+
+            if (ok
+                    && !done)
+            {
+                char rank[32];
+                std::snprintf(rank, sizeof(rank), "%2zu. %.1f ", ++n, e.score);
+                tim_tcl_print_post(tcl->terminal(), rank, 4, e.post_id, user_id, timestamp, text);
+            }
+
+            q->reset();
+
+            if (!ok
+                    || !done)
+                break;
+        }
+
+        if (!ok)
+            break;
+    }
+
+    return nullptr;
+}
+
+static lil_value_t tim_tcl_cmd_react(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    if (argc < 1
+            || argc > 2)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Invalid number of arguments. Expecting post_id ?weight?"_en,
+                             "Некорректные аргументы. Ожидается post_id ?weight?"_ru));
+        return nullptr;
+    }
+
+    tim::uuid post_id;
+    if (!tim_tcl_post_id(lil, argv[0], post_id))
+        return nullptr;
+
+    const lilint_t weight = argc == 2
+                                ? lil_to_integer(argv[1])
+                                : 1;
+    if (weight != 1
+            && weight != -1)
+    {
+        lil_set_error(lil,
+                      TIM_TR("The weight is 1 or -1."_en,
+                             "Вес равен 1 или -1."_ru));
+        return nullptr;
+    }
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    tim::app()->mqtt()->publish(std::filesystem::path("reaction")
+                                    / post_id.to_string(tim::uuid::format::NoBrackets)
+                                    / tcl->user_id().to_string(tim::uuid::format::NoBrackets),
+                                std::to_string(weight));
+
+    return nullptr;
+}
+
+static lil_value_t tim_tcl_cmd_reply(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    if (argc != 2)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Invalid number of arguments. Expecting post_id text"_en,
+                             "Некорректные аргументы. Ожидается post_id text"_ru));
+        return nullptr;
+    }
+
+    tim::uuid post_id;
+    if (!tim_tcl_post_id(lil, argv[0], post_id))
+        return nullptr;
+
+    const std::string text = lil_to_string(argv[1]);
+    if (text.empty())
+    {
+        lil_set_error(lil,
+                      TIM_TR("The reply is empty."_en,
+                             "Пустой ответ."_ru));
+        return nullptr;
+    }
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    tcl->replied(post_id, text);
+
+    return nullptr;
+}
+
+static lil_value_t tim_tcl_cmd_thread(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    if (argc != 1)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Invalid number of arguments. Expecting post_id"_en,
+                             "Некорректные аргументы. Ожидается post_id"_ru));
+        return nullptr;
+    }
+
+    tim::uuid post_id;
+    if (!tim_tcl_post_id(lil, argv[0], post_id))
+        return nullptr;
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    tim::uuid root_id;
+    if (!tcl->thread()->root(post_id, root_id))
+    {
+        lil_set_error(lil,
+                      TIM_TR("No such post."_en,
+                             "Нет такого сообщения."_ru));
+        return nullptr;
+    }
+
+    std::size_t reply_count = 0;
+    if (tcl->thread()->count(root_id, reply_count))
+        tcl->terminal()->printf(TIM_TR("Replies: %zu\n"_en,
+                                       "Ответов: %zu\n"_ru),
+                                reply_count);
+
+    tim::signal_connection connection(tcl->thread()->fetched.connect(
+        [&](const tim::post &post, std::size_t depth)
+        {
+            const std::size_t indent = 2 * std::min(depth, tim::THREAD_MAX_INDENT);
+            tim_tcl_print_post(tcl->terminal(), std::string(indent, ' '), indent,
+                               post.id, post.user_id, post.timestamp, post.text);
+        }));
+
+    if (!tcl->thread()->fetch(root_id))
+        lil_set_error(lil,
+                      TIM_TR("Failed to read the thread."_en,
+                             "Ошибка при чтении ветки обсуждения."_ru));
+
+    return nullptr;
+}
+
+
+// Public
+
+void tim::tcl_add_post(lil_t lil)
+{
+    assert(lil);
+
+    TIM_TCL_REGISTER(lil, hot);
+    TIM_TCL_REGISTER(lil, react);
+    TIM_TCL_REGISTER(lil, reply);
+    TIM_TCL_REGISTER(lil, thread);
+}
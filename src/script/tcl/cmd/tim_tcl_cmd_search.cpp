@@ -0,0 +1,135 @@
+#include "tim_tcl_cmd_search.h"
+
+#include "tim_a_protocol.h"
+#include "tim_a_terminal.h"
+#include "tim_config.h"
+#include "tim_post.h"
+#include "tim_post_search.h"
+#include "tim_signal_connection.h"
+#include "tim_tcl.h"
+#include "tim_tcl_cmd.h"
+#include "tim_translator.h"
+
+#include "lil.hpp"
+
+#include <cassert>
+#include <ctime>
+
+
+// Static
+
+static void tim_tcl_print_match(tim::a_terminal *term, const tim::post &post, std::string_view snippet)
+{
+    assert(term);
+
+    const std::time_t t = post.timestamp / 1000;
+    char time[32];
+    if (!std::strftime(time, sizeof(time), "%Y-%m-%d %H:%M ", std::localtime(&t)))
+        time[0] = '\0';
+
+    term->set_color(term->theme().colors.at(tim::terminal_color_index::Info));
+    term->write_str(time);
+    term->set_default_color();
+
+    std::string s;
+    s.reserve(snippet.size());
+    for (const char c: snippet)
+        switch (c)
+        {
+            case tim::post_search::MATCH_BEGIN:
+                term->write_str(s);
+                s.clear();
+                term->set_color(term->theme().colors.at(tim::terminal_color_index::EmText));
+                break;
+
+            case tim::post_search::MATCH_END:
+                term->write_str(s);
+                s.clear();
+                term->set_default_color();
+                break;
+
+            case '\r':
+            case '\n':
+            case '\t':
+                s += ' ';
+                break;
+
+            default:
+                s += c;
+                break;
+        }
+
+    s += '\n';
+    term->write_str(s);
+    term->reset_colors();
+}
+
+static lil_value_t tim_tcl_cmd_search(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    if (argc > 2)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Invalid number of arguments. Expecting ?query? ?count?"_en,
+                             "Некорректные аргументы. Ожидается ?query? ?count?"_ru));
+        return nullptr;
+    }
+
+    std::size_t count = tim::TIMELINE_PAGE_SIZE;
+    if (argc == 2)
+    {
+        const lilint_t n = lil_to_integer(argv[1]);
+        if (n <= 0)
+        {
+            lil_set_error(lil,
+                          TIM_TR("The post count must be a positive number."_en,
+                                 "Количество сообщений должно быть положительным числом."_ru));
+            return nullptr;
+        }
+        count = (std::size_t)n;
+    }
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    if (!argc
+            && tcl->search()->at_end())
+    {
+        lil_set_error(lil,
+                      TIM_TR("There are no more matches."_en,
+                             "Больше совпадений нет."_ru));
+        return nullptr;
+    }
+
+    std::size_t found = 0;
+    tim::signal_connection connection(tcl->search()->found.connect(
+        [&](const tim::post &post, std::string_view snippet)
+        {
+            tim_tcl_print_match(tcl->terminal(), post, snippet);
+            ++found;
+        }));
+
+    const bool ok = argc
+                        ? tcl->search()->find(lil_to_string(argv[0]), count)
+                        : tcl->search()->next(count);
+    if (!ok)
+        lil_set_error(lil,
+                      TIM_TR("Search failed."_en,
+                             "Ошибка при поиске."_ru));
+    else if (argc
+                && !found)
+        lil_set_error(lil,
+                      TIM_TR("Nothing found."_en,
+                             "Ничего не найдено."_ru));
+
+    return nullptr;
+}
+
+
+// Public
+
+void tim::tcl_add_search(lil_t lil)
+{
+    assert(lil);
+
+    TIM_TCL_REGISTER(lil, search);
+}
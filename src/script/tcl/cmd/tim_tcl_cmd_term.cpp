@@ -2,6 +2,7 @@
 
 #include "tim_a_protocol.h"
 #include "tim_a_terminal.h"
+#include "tim_config.h"
 #include "tim_tcl.h"
 #include "tim_tcl_cmd.h"
 #include "tim_trace.h"
@@ -43,8 +44,8 @@ static lil_value_t tim_tcl_cmd_puts(lil_t lil, size_t argc, lil_value_t *argv)
     switch (argc)
     {
         case 1:
-            tcl->terminal()->protocol()->write_str(lil_to_string(argv[0]));
-            tcl->terminal()->protocol()->write("\n", 1);
+            tcl->terminal()->write_str(lil_to_string(argv[0]));
+            tcl->terminal()->write("\n", 1);
             return nullptr;
 
         case 2:
@@ -56,7 +57,7 @@ static lil_value_t tim_tcl_cmd_puts(lil_t lil, size_t argc, lil_value_t *argv)
                 return nullptr;
             }
 
-            tcl->terminal()->protocol()->write_str(lil_to_string(argv[0]));
+            tcl->terminal()->write_str(lil_to_string(argv[0]));
 
             return nullptr;
 
@@ -70,6 +71,61 @@ static lil_value_t tim_tcl_cmd_puts(lil_t lil, size_t argc, lil_value_t *argv)
     return nullptr;
 }
 
+static lil_value_t tim_tcl_cmd_scroll(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    if (argc > 1)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Invalid number of arguments. Expecting ?count?"_en,
+                             "Некорректные аргументы. Ожидается ?count?"_ru));
+        return nullptr;
+    }
+
+    std::size_t count = tim::TIMELINE_PAGE_SIZE;
+    if (argc == 1)
+    {
+        const lilint_t n = lil_to_integer(argv[0]);
+        if (n <= 0)
+        {
+            lil_set_error(lil,
+                          TIM_TR("The message count must be a positive number."_en,
+                                 "Количество сообщений должно быть положительным числом."_ru));
+            return nullptr;
+        }
+        count = (std::size_t)n;
+    }
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    tcl->scrolled(count);
+
+    return nullptr;
+}
+
+static lil_value_t tim_tcl_cmd_screen(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    const char *mode = argc == 1
+                           ? lil_to_string(argv[0])
+                           : "";
+    const bool on = !std::strcmp(mode, "on");
+    if (!on
+            && std::strcmp(mode, "off"))
+    {
+        lil_set_error(lil,
+                      TIM_TR("Invalid arguments. Expecting on|off"_en,
+                             "Некорректные аргументы. Ожидается on|off"_ru));
+        return nullptr;
+    }
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    tcl->screen_switched(on);
+
+    return nullptr;
+}
+
 static lil_value_t tim_tcl_cmd_palette256(lil_t lil, size_t argc, lil_value_t *argv)
 {
     (void) argv;
@@ -91,11 +147,11 @@ static lil_value_t tim_tcl_cmd_palette256(lil_t lil, size_t argc, lil_value_t *a
     {
         if (c > 0
                 && c % ITEMS_PER_LINE == 0)
-            tcl->terminal()->protocol()->write("\n", 1);
+            tcl->terminal()->write("\n", 1);
 
         tcl->terminal()->printf("%3zu", c);
         tcl->terminal()->cprintf(tim::color{}, tcl->terminal()->color(c), "%s", "  ");
-        tcl->terminal()->protocol()->write(" ", 1);
+        tcl->terminal()->write(" ", 1);
     }
 
     return nullptr;
@@ -110,5 +166,7 @@ void tim::tcl_add_term(lil_t lil)
 
     TIM_TCL_REGISTER(lil, clear);
     TIM_TCL_REGISTER(lil, puts);
+    TIM_TCL_REGISTER(lil, scroll);
+    TIM_TCL_REGISTER(lil, screen);
     TIM_TCL_REGISTER(lil, palette256);
 }
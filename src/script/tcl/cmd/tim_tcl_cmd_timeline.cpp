@@ -0,0 +1,100 @@
+#include "tim_tcl_cmd_timeline.h"
+
+#include "tim_config.h"
+#include "tim_tcl.h"
+#include "tim_tcl_cmd.h"
+#include "tim_timeline.h"
+#include "tim_translator.h"
+
+#include "lil.hpp"
+
+#include <cassert>
+
+
+// Static
+
+static bool tim_tcl_page_size(lil_t lil, std::size_t argc, lil_value_t *argv, std::size_t &count)
+{
+    switch (argc)
+    {
+        case 0:
+            count = tim::TIMELINE_PAGE_SIZE;
+            return true;
+
+        case 1:
+        {
+            const lilint_t n = lil_to_integer(argv[0]);
+            if (n > 0)
+            {
+                count = (std::size_t)n;
+                return true;
+            }
+
+            lil_set_error(lil,
+                          TIM_TR("The post count must be a positive number."_en,
+                                 "Количество сообщений должно быть положительным числом."_ru));
+            return false;
+        }
+
+        default:
+            break;
+    }
+
+    lil_set_error(lil,
+                  TIM_TR("Invalid number of arguments. Expecting ?count?"_en,
+                         "Некорректные аргументы. Ожидается ?count?"_ru));
+    return false;
+}
+
+static lil_value_t tim_tcl_cmd_history(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    std::size_t count = 0;
+    if (!tim_tcl_page_size(lil, argc, argv, count))
+        return nullptr;
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    if (!tcl->timeline()->latest(count))
+        lil_set_error(lil,
+                      TIM_TR("Failed to read the timeline."_en,
+                             "Ошибка при чтении ленты сообщений."_ru));
+
+    return nullptr;
+}
+
+static lil_value_t tim_tcl_cmd_older(lil_t lil, size_t argc, lil_value_t *argv)
+{
+    std::size_t count = 0;
+    if (!tim_tcl_page_size(lil, argc, argv, count))
+        return nullptr;
+
+    tim::tcl *tcl = (tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    if (tcl->timeline()->at_begin())
+    {
+        lil_set_error(lil,
+                      TIM_TR("There are no older posts."_en,
+                             "Более ранних сообщений нет."_ru));
+        return nullptr;
+    }
+
+    if (!tcl->timeline()->older(count))
+        lil_set_error(lil,
+                      TIM_TR("Failed to read the timeline."_en,
+                             "Ошибка при чтении ленты сообщений."_ru));
+
+    return nullptr;
+}
+
+
+// Public
+
+void tim::tcl_add_timeline(lil_t lil)
+{
+    assert(lil);
+
+    TIM_TCL_REGISTER(lil, history);
+    TIM_TCL_REGISTER(lil, older);
+}
@@ -2,6 +2,8 @@
 
 #include "tim_application.h"
 #include "tim_mqtt_client.h"
+#include "tim_post_fanout.h"
+#include "tim_sqlite_query.h"
 #include "tim_tcl_cmd.h"
 #include "tim_translator.h"
 #include "tim_tcl.h"
@@ -13,6 +15,85 @@
 
 // Static
 
+// A user is given by id or by nick.
+static bool tim_tcl_find_user(const std::string &s, tim::uuid &id)
+{
+    if (id.from_chars(s.data(), s.size()))
+        return true;
+
+    tim::sqlite_query q(tim::app()->db(), "SELECT id FROM user WHERE nick = ?");
+    bool done = true;
+    return q.prepare()
+                && q.bind(1, s)
+                && q.next(&done, id)
+                && !done
+                && id.valid();
+}
+
+static lil_value_t tim_tcl_cmd_follow(lil_t lil,
+                                      std::size_t argc,
+                                      lil_value_t *argv)
+{
+    if (argc != 1)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Expected user id or nick"_en,
+                             "Ожидаем параметр user id или nick"_ru));
+        return nullptr;
+    }
+
+    const tim::tcl *tcl = (const tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    tim::uuid publisher_id;
+    if (!tim_tcl_find_user(lil_to_string(argv[0]), publisher_id))
+    {
+        lil_set_error(lil,
+                      TIM_TR("No such user"_en,
+                             "Нет такого пользователя"_ru));
+        return nullptr;
+    }
+
+    if (!tim::app()->post_fanout()->follow(tcl->user_id(), publisher_id))
+        lil_set_error(lil,
+                      TIM_TR("Failed to follow the user"_en,
+                             "Не удалось подписаться на пользователя"_ru));
+
+    return nullptr;
+}
+
+static lil_value_t tim_tcl_cmd_unfollow(lil_t lil,
+                                        std::size_t argc,
+                                        lil_value_t *argv)
+{
+    if (argc != 1)
+    {
+        lil_set_error(lil,
+                      TIM_TR("Expected user id or nick"_en,
+                             "Ожидаем параметр user id или nick"_ru));
+        return nullptr;
+    }
+
+    const tim::tcl *tcl = (const tim::tcl *)lil_get_data(lil);
+    assert(tcl);
+
+    tim::uuid publisher_id;
+    if (!tim_tcl_find_user(lil_to_string(argv[0]), publisher_id))
+    {
+        lil_set_error(lil,
+                      TIM_TR("No such user"_en,
+                             "Нет такого пользователя"_ru));
+        return nullptr;
+    }
+
+    if (!tim::app()->post_fanout()->unfollow(tcl->user_id(), publisher_id))
+        lil_set_error(lil,
+                      TIM_TR("Failed to unfollow the user"_en,
+                             "Не удалось отписаться от пользователя"_ru));
+
+    return nullptr;
+}
+
 static lil_value_t tim_tcl_cmd_setnick(lil_t lil,
                                        std::size_t argc,
                                        lil_value_t *argv)
@@ -71,4 +152,6 @@ void tim::tcl_add_user(lil_t lil)
 
     TIM_TCL_REGISTER(lil, setnick);
     TIM_TCL_REGISTER(lil, seticon);
+    TIM_TCL_REGISTER(lil, follow);
+    TIM_TCL_REGISTER(lil, unfollow);
 }
@@ -5,12 +5,19 @@
 #include "tim_a_protocol.h"
 #include "tim_a_terminal.h"
 #include "tim_application.h"
+#include "tim_post_search.h"
+#include "tim_post_thread.h"
 #include "tim_string_tools.h"
+#include "tim_timeline.h"
 #include "tim_translator.h"
 
 // Commands
+#include "tim_tcl_cmd_db.h"
 #include "tim_tcl_cmd_general.h"
+#include "tim_tcl_cmd_post.h"
+#include "tim_tcl_cmd_search.h"
 #include "tim_tcl_cmd_term.h"
+#include "tim_tcl_cmd_timeline.h"
 #include "tim_tcl_cmd_user.h"
 
 #include "lil.hpp"
@@ -23,16 +30,26 @@
 
 tim::tcl::tcl(tim::a_terminal *term, const tim::uuid &user_id)
     : tim::a_script_engine("Tcl", term)
+    , replied()
+    , scrolled()
+    , screen_switched()
     , _d(new tim::p::tcl(this))
 {
     _d->_lil = lil_new();
     _d->_user_id = user_id;
+    _d->_timeline.reset(new tim::timeline(tim::app()->db(), tim::app()->post_shards(), tim::app()->post_archive()));
+    _d->_search.reset(new tim::post_search(tim::app()->post_shards()));
+    _d->_thread.reset(new tim::post_thread(tim::app()->post_shards()));
 
     lil_callback(_d->_lil, LIL_CALLBACK_WRITE, (lil_callback_proc_t)tim::p::tcl::write);
     lil_callback(_d->_lil, LIL_CALLBACK_DISPATCH, (lil_callback_proc_t)tim::p::tcl::dispatch);
 
+    tim::tcl_add_db(_d->_lil);
     tim::tcl_add_general(_d->_lil);
+    tim::tcl_add_post(_d->_lil);
+    tim::tcl_add_search(_d->_lil);
     tim::tcl_add_term(_d->_lil);
+    tim::tcl_add_timeline(_d->_lil);
     tim::tcl_add_user(_d->_lil);
 }
 
@@ -46,6 +63,21 @@ const tim::uuid &tim::tcl::user_id() const
     return _d->_user_id;
 }
 
+tim::timeline *tim::tcl::timeline() const
+{
+    return _d->_timeline.get();
+}
+
+tim::post_search *tim::tcl::search() const
+{
+    return _d->_search.get();
+}
+
+tim::post_thread *tim::tcl::thread() const
+{
+    return _d->_thread.get();
+}
+
 bool tim::tcl::evaluating() const
 {
     return _d->_evaluating;
@@ -191,7 +223,7 @@ void tim::p::tcl::write(lil_t lil, const char *msg)
     tim::tcl *self = (tim::tcl *)lil_get_data(lil);
     assert(self);
 
-    self->terminal()->protocol()->write_str(msg);
+    self->terminal()->write_str(msg);
 }
 
 void tim::p::tcl::dispatch(lil_t lil)
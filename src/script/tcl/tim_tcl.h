@@ -1,6 +1,7 @@
 #pragma once
 
 #include "tim_a_script_engine.h"
+#include "tim_signal.h"
 #include "tim_uuid.h"
 
 #include <cstddef>
@@ -19,16 +20,26 @@ struct tcl;
 }
 
 class a_terminal;
+class post_search;
+class post_thread;
+class timeline;
 
 class tcl : public tim::a_script_engine
 {
 
 public:
 
+    tim::signal<const tim::uuid & /* post_id */, const std::string & /* text */> replied;
+    tim::signal<std::size_t /* count */> scrolled;
+    tim::signal<bool /* enable */> screen_switched;
+
     tcl(tim::a_terminal *term, const tim::uuid &user_id);
     virtual ~tcl();
 
     const tim::uuid &user_id() const;
+    tim::timeline *timeline() const;
+    tim::post_search *search() const;
+    tim::post_thread *thread() const;
 
     bool evaluating() const override;
     bool eval(const std::string &program, std::string *res = nullptr) override;
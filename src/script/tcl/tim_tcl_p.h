@@ -3,6 +3,7 @@
 #include "tim_uuid.h"
 
 #include <cassert>
+#include <memory>
 #include <string>
 
 
@@ -11,7 +12,10 @@ typedef struct _lil_t *lil_t;
 namespace tim
 {
 
+class post_search;
+class post_thread;
 class tcl;
+class timeline;
 
 namespace p
 {
@@ -31,6 +35,9 @@ struct tcl
 
     lil_t _lil = nullptr;
     tim::uuid _user_id;
+    std::unique_ptr<tim::timeline> _timeline;
+    std::unique_ptr<tim::post_search> _search;
+    std::unique_ptr<tim::post_thread> _thread;
     bool _evaluating = false;
     std::string _prompt = "► ";
     std::string _error_msg;
@@ -0,0 +1,195 @@
+#include "tim_post_fanout.h"
+
+#include "tim_post_fanout_p.h"
+
+#include "tim_application.h"
+#include "tim_mqtt_client.h"
+#include "tim_sqlite_db.h"
+#include "tim_sqlite_query.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+#include <algorithm>
+
+
+// Public
+
+tim::post_fanout::post_fanout(tim::sqlite_db *db)
+    : _d(new tim::p::post_fanout(this))
+{
+    assert(db);
+
+    _d->_db = db;
+    _d->load();
+
+    tim::app()->mqtt()->connected.connect(std::bind(&tim::p::post_fanout::subscribe, _d.get()));
+
+    if (tim::app()->mqtt()->is_connected())
+        _d->subscribe();
+}
+
+tim::post_fanout::~post_fanout() = default;
+
+tim::post_fanout::feed_signal &tim::post_fanout::feed(const tim::uuid &user_id)
+{
+    std::unique_ptr<feed_signal> &feed = _d->_feeds[_d->index(user_id)];
+    if (!feed)
+        feed.reset(new feed_signal());
+
+    return *feed;
+}
+
+bool tim::post_fanout::follow(const tim::uuid &subscriber_id, const tim::uuid &publisher_id)
+{
+    tim::sqlite_query q(_d->_db, "INSERT OR IGNORE INTO subscription (publisher_id, subscriber_id) VALUES (?, ?)");
+    if (!q.prepare()
+            || !q.bind(1, publisher_id.to_string())
+            || !q.bind(2, subscriber_id.to_string())
+            || !q.exec())
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to subscribe user '%s' to user '%s'."_en,
+                              "Ошибка при подписке пользователя '%s' на пользователя '%s'."_ru),
+                        subscriber_id.to_string().c_str(),
+                        publisher_id.to_string().c_str());
+
+    const std::uint32_t subscriber = _d->index(subscriber_id);
+    _d->link(subscriber, _d->index(publisher_id));
+
+    return true;
+}
+
+bool tim::post_fanout::unfollow(const tim::uuid &subscriber_id, const tim::uuid &publisher_id)
+{
+    tim::sqlite_query q(_d->_db, "DELETE FROM subscription WHERE publisher_id = ? AND subscriber_id = ?");
+    if (!q.prepare()
+            || !q.bind(1, publisher_id.to_string())
+            || !q.bind(2, subscriber_id.to_string())
+            || !q.exec())
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to unsubscribe user '%s' from user '%s'."_en,
+                              "Ошибка при отписке пользователя '%s' от пользователя '%s'."_ru),
+                        subscriber_id.to_string().c_str(),
+                        publisher_id.to_string().c_str());
+
+    std::uint32_t subscriber, publisher;
+    if (_d->find(subscriber_id, subscriber)
+            && _d->find(publisher_id, publisher))
+    {
+        std::vector<std::uint32_t> &followers = _d->_followers[publisher];
+        std::vector<std::uint32_t>::iterator it = std::lower_bound(followers.begin(), followers.end(), subscriber);
+        if (it != followers.end()
+                && *it == subscriber)
+            followers.erase(it);
+    }
+
+    return true;
+}
+
+bool tim::post_fanout::follows(const tim::uuid &subscriber_id, const tim::uuid &publisher_id) const
+{
+    std::uint32_t subscriber, publisher;
+    return _d->find(subscriber_id, subscriber)
+                && _d->find(publisher_id, publisher)
+                && std::binary_search(_d->_followers[publisher].begin(), _d->_followers[publisher].end(), subscriber);
+}
+
+std::size_t tim::post_fanout::follower_count(const tim::uuid &publisher_id) const
+{
+    std::uint32_t publisher;
+    return _d->find(publisher_id, publisher)
+                ? _d->_followers[publisher].size()
+                : 0;
+}
+
+void tim::post_fanout::deliver(const std::filesystem::path &topic, const char *data, std::size_t size) const
+{
+    // post/<user id>/<session id> or reply/<post id>/<user id>/<session id>
+    const std::string s = topic.parent_path().filename().string();
+
+    tim::uuid author_id;
+    std::uint32_t author;
+    if (!author_id.from_chars(s.data(), s.size())
+            || !_d->find(author_id, author))
+        return;
+
+    if (_d->_feeds[author])
+        (*_d->_feeds[author])(topic, data, size);
+
+    for (const std::uint32_t follower: _d->_followers[author])
+        if (_d->_feeds[follower])
+            (*_d->_feeds[follower])(topic, data, size);
+}
+
+
+// Private
+
+void tim::p::post_fanout::subscribe()
+{
+    tim::app()->mqtt()->subscribe("post/+/+",
+                                  std::bind(&tim::post_fanout::deliver, _q,
+                                            std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    tim::app()->mqtt()->subscribe("reply/+/+/+",
+                                  std::bind(&tim::post_fanout::deliver, _q,
+                                            std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+bool tim::p::post_fanout::load()
+{
+    tim::sqlite_query q(_db, "SELECT subscriber_id, publisher_id FROM subscription");
+    if (!q.prepare())
+        return false;
+
+    tim::uuid subscriber_id, publisher_id;
+    bool done = false;
+    while (q.next(&done, subscriber_id, publisher_id)
+                && !done)
+        _followers[index(publisher_id)].push_back(index(subscriber_id));
+
+    for (std::vector<std::uint32_t> &followers: _followers)
+    {
+        std::sort(followers.begin(), followers.end());
+        followers.shrink_to_fit();
+    }
+
+    if (!done)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to load subscriptions from database '%s'."_en,
+                              "Ошибка при загрузке подписок из базы данных '%s'."_ru),
+                        _db->path().string().c_str());
+
+    return true;
+}
+
+std::uint32_t tim::p::post_fanout::index(const tim::uuid &id)
+{
+    const std::pair<std::unordered_map<tim::uuid, std::uint32_t>::iterator, bool> res =
+        _indices.emplace(id, (std::uint32_t)_followers.size());
+
+    if (res.second)
+    {
+        _followers.emplace_back();
+        _feeds.emplace_back();
+    }
+
+    return res.first->second;
+}
+
+bool tim::p::post_fanout::find(const tim::uuid &id, std::uint32_t &index) const
+{
+    std::unordered_map<tim::uuid, std::uint32_t>::const_iterator it = _indices.find(id);
+    if (it == _indices.end())
+        return false;
+
+    index = it->second;
+    return true;
+}
+
+void tim::p::post_fanout::link(std::uint32_t subscriber, std::uint32_t publisher)
+{
+    std::vector<std::uint32_t> &followers = _followers[publisher];
+    std::vector<std::uint32_t>::iterator it = std::lower_bound(followers.begin(), followers.end(), subscriber);
+    if (it == followers.end()
+            || *it != subscriber)
+        followers.insert(it, subscriber);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "tim_signal.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+
+namespace tim
+{
+
+class sqlite_db;
+class uuid;
+
+namespace p
+{
+
+struct post_fanout;
+
+}
+
+/**
+ * Delivers the posts only to the sessions of the author's followers.
+ *
+ * The follower graph from the subscription table is kept in memory as
+ * sorted adjacency arrays over dense user indices. Every post and reply is
+ * received from MQTT once and emitted through the feeds of its author and of the
+ * users following the author. follow() and unfollow() update the table
+ * and the graph together.
+ */
+class post_fanout
+{
+
+public:
+
+    using feed_signal = tim::signal<const std::filesystem::path & /* topic */,
+                                    const char * /* data */,
+                                    std::size_t /* size */>;
+
+    explicit post_fanout(tim::sqlite_db *db);
+    ~post_fanout();
+
+    feed_signal &feed(const tim::uuid &user_id);
+
+    bool follow(const tim::uuid &subscriber_id, const tim::uuid &publisher_id);
+    bool unfollow(const tim::uuid &subscriber_id, const tim::uuid &publisher_id);
+    bool follows(const tim::uuid &subscriber_id, const tim::uuid &publisher_id) const;
+    std::size_t follower_count(const tim::uuid &publisher_id) const;
+
+    void deliver(const std::filesystem::path &topic, const char *data, std::size_t size) const;
+
+private:
+
+    std::unique_ptr<tim::p::post_fanout> _d;
+};
+
+}
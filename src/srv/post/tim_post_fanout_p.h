@@ -0,0 +1,38 @@
+#pragma once
+
+#include "tim_post_fanout.h"
+
+#include "tim_uuid.h"
+
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+namespace tim::p
+{
+
+struct post_fanout
+{
+    explicit post_fanout(tim::post_fanout *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    void subscribe();
+    bool load();
+    std::uint32_t index(const tim::uuid &id);
+    bool find(const tim::uuid &id, std::uint32_t &index) const;
+    void link(std::uint32_t subscriber, std::uint32_t publisher);
+
+    tim::post_fanout *const _q;
+
+    tim::sqlite_db *_db = nullptr;
+    std::unordered_map<tim::uuid, std::uint32_t> _indices;
+    std::vector<std::vector<std::uint32_t>> _followers; // Sorted subscriber indices by publisher index.
+    std::vector<std::unique_ptr<tim::post_fanout::feed_signal>> _feeds; // By user index, nullptr without sessions.
+};
+
+}
@@ -0,0 +1,410 @@
+#include "tim_post_ranking.h"
+
+#include "tim_post_ranking_p.h"
+
+#include "tim_application.h"
+#include "tim_config.h"
+#include "tim_mqtt_client.h"
+#include "tim_post_archive.h"
+#include "tim_post_shards.h"
+#include "tim_sqlite_db.h"
+#include "tim_sqlite_query.h"
+#include "tim_sqlite_writer.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
+
+#include "mongoose.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+
+// The posts are in the shards, the archived ones leave _scores first.
+static const char *const SAVE_SQL =
+R"(INSERT OR REPLACE INTO post_score (post_id, score, timestamp)
+    VALUES (:post_id, :score, :timestamp))";
+
+
+// Public
+
+tim::post_ranking::post_ranking(mg_mgr *mg, tim::sqlite_db *db)
+    : _d(new tim::p::post_ranking(this))
+{
+    assert(mg);
+    assert(db);
+    assert(db->is_open());
+
+    _d->_db = db;
+    _d->_epoch = tim::p::post_ranking::now();
+    _d->load();
+
+    _d->_timer = mg_timer_add(mg, tim::HOT_CHECKPOINT_INTERVAL.count(),
+                              MG_TIMER_REPEAT,
+                              &tim::p::post_ranking::on_timer, _d.get());
+
+    tim::app()->mqtt()->connected.connect(std::bind(&tim::p::post_ranking::subscribe, _d.get()));
+
+    if (tim::app()->mqtt()->is_connected())
+        _d->subscribe();
+
+    tim::app()->post_archive()->archived.connect(std::bind(&tim::p::post_ranking::on_archived, _d.get(),
+                                                           std::placeholders::_1));
+}
+
+tim::post_ranking::~post_ranking()
+{
+    if (_d->_db->is_open())
+        checkpoint();
+}
+
+/**
+ * Saves the reaction through the group commit of the shard of the post,
+ * the score changes once it is committed.
+ */
+void tim::post_ranking::react(const tim::uuid &post_id, const tim::uuid &user_id, int weight)
+{
+    assert(weight == 1
+               || weight == -1);
+
+    std::size_t shard = 0;
+    if (!tim::app()->post_shards()->find(post_id, shard))
+    {
+        TIM_TRACE(Error,
+                  TIM_TR("Post '%s' is archived or does not exist, the reaction is not saved."_en,
+                         "Сообщение '%s' в архиве или не существует, реакция не сохранена."_ru),
+                  post_id.to_string().c_str());
+        return;
+    }
+
+    const std::int64_t timestamp = tim::p::post_ranking::now();
+    std::shared_ptr<bool> added = std::make_shared<bool>(false);
+
+    tim::app()->post_shards()->writer(shard)->post(
+        [id = tim::uuid::create(), post_id, user_id, weight, timestamp, added](tim::sqlite_db *db)
+        {
+            tim::sqlite_query q(db, "INSERT OR IGNORE INTO reaction (id, post_id, user_id, timestamp, weight) VALUES (?, ?, ?, ?, ?)");
+            if (!q.prepare()
+                    || !q.bind(1, id.to_string())
+                    || !q.bind(2, post_id.to_string())
+                    || !q.bind(3, user_id.to_string())
+                    || !q.bind(4, timestamp)
+                    || !q.bind(5, weight)
+                    || !q.exec())
+                return TIM_TRACE(Error,
+                                TIM_TR("Failed to save a reaction to post '%s'."_en,
+                                      "Ошибка при сохранении реакции на сообщение '%s'."_ru),
+                                post_id.to_string().c_str());
+
+            if (!(*added = db->change_count() > 0))
+                TIM_TRACE(Debug,
+                          TIM_TR("User '%s' has reacted to post '%s' already."_en,
+                                 "Пользователь '%s' уже реагировал на сообщение '%s'."_ru),
+                          user_id.to_string().c_str(),
+                          post_id.to_string().c_str());
+
+            return true;
+        },
+        [this, post_id, weight, timestamp, added](bool ok)
+        {
+            if (ok
+                    && *added)
+                add(post_id, weight, timestamp);
+        });
+}
+
+void tim::post_ranking::add(const tim::uuid &post_id, double weight, std::int64_t timestamp)
+{
+    std::unordered_map<tim::uuid, double>::iterator it = _d->_scores.emplace(post_id, 0.0).first;
+    const double old_score = it->second;
+    const double new_score = old_score + weight * _d->scale(timestamp);
+
+    _d->_dirty.insert(post_id);
+
+    const bool was_top = _d->_top.erase({ old_score, post_id }) > 0;
+
+    if (new_score > 0)
+        it->second = new_score;
+    else
+        _d->_scores.erase(it);
+
+    // A post going down may give its place to one out of the top.
+    if (was_top
+            && new_score < old_score
+            && _d->_scores.size() > tim::HOT_POST_COUNT)
+    {
+        _d->refill();
+        return;
+    }
+
+    if (new_score > 0
+            && (_d->_top.size() < tim::HOT_POST_COUNT
+                    || new_score > _d->_top.rbegin()->first))
+    {
+        _d->_top.emplace(new_score, post_id);
+        if (_d->_top.size() > tim::HOT_POST_COUNT)
+            _d->_top.erase(std::prev(_d->_top.end()));
+    }
+}
+
+double tim::post_ranking::score(const tim::uuid &post_id) const
+{
+    std::unordered_map<tim::uuid, double>::const_iterator it = _d->_scores.find(post_id);
+    if (it == _d->_scores.end())
+        return 0;
+
+    return it->second / _d->scale(tim::p::post_ranking::now());
+}
+
+std::vector<tim::post_ranking::entry> tim::post_ranking::hot(std::size_t count) const
+{
+    const double scale = _d->scale(tim::p::post_ranking::now());
+
+    std::vector<tim::post_ranking::entry> res;
+    res.reserve(std::min(count, _d->_top.size()));
+    for (const std::pair<double, tim::uuid> &top: _d->_top)
+    {
+        if (res.size() == count)
+            break;
+
+        res.push_back({ top.second, top.first / scale });
+    }
+
+    return res;
+}
+
+bool tim::post_ranking::checkpoint()
+{
+    const std::int64_t now = tim::p::post_ranking::now();
+    if (now - _d->_epoch >= std::chrono::duration_cast<std::chrono::milliseconds>(tim::HOT_HALF_LIFE).count())
+        _d->rebase(now);
+
+    if (_d->_dirty.empty())
+        return true;
+
+    tim::sqlite_query save(_d->_db, SAVE_SQL);
+    tim::sqlite_query drop(_d->_db, "DELETE FROM post_score WHERE post_id = ?");
+    if (!save.prepare()
+            || !drop.prepare()
+            || !_d->_db->begin())
+        return false;
+
+    bool ok = true;
+    for (const tim::uuid &post_id: _d->_dirty)
+    {
+        std::unordered_map<tim::uuid, double>::const_iterator it = _d->_scores.find(post_id);
+        if (it != _d->_scores.end())
+            ok = save.bind(":post_id", post_id.to_string())
+                    && save.bind(":score", it->second)
+                    && save.bind(":timestamp", _d->_epoch)
+                    && save.exec()
+                    && save.reset();
+        else
+            ok = drop.bind(1, post_id.to_string())
+                    && drop.exec()
+                    && drop.reset();
+
+        if (!ok)
+            break;
+    }
+
+    if (!ok
+            || !_d->_db->commit())
+    {
+        _d->_db->rollback();
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to save post scores to database '%s'."_en,
+                              "Ошибка при сохранении рейтинга сообщений в базе данных '%s'."_ru),
+                        _d->_db->path().string().c_str());
+    }
+
+    _d->_dirty.clear();
+
+    return true;
+}
+
+
+// Private
+
+void tim::p::post_ranking::on_timer(void *self)
+{
+    tim::p::post_ranking *d = (tim::p::post_ranking *)self;
+    assert(d);
+
+    if (!d->_db->is_open()
+            || d->_db->is_transaction_active())
+        return;
+
+    d->_q->checkpoint();
+}
+
+std::int64_t tim::p::post_ranking::now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void tim::p::post_ranking::subscribe()
+{
+    tim::app()->mqtt()->subscribe("reaction/+/+",
+                                  std::bind(&tim::p::post_ranking::on_reaction, this,
+                                            std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void tim::p::post_ranking::on_reaction(const std::filesystem::path &topic, const char *data, std::size_t size)
+{
+    // reaction/<post id>/<user id>, the payload is the weight, 1 if empty.
+    const std::string p = topic.parent_path().filename().string();
+    const std::string u = topic.filename().string();
+
+    tim::uuid post_id;
+    tim::uuid user_id;
+    int weight = 1;
+    if (!post_id.from_chars(p.data(), p.size())
+            || !user_id.from_chars(u.data(), u.size())
+            || (size
+                    && std::from_chars(data, data + size, weight).ec != std::errc())
+            || !weight)
+    {
+        TIM_TRACE(Error,
+                  TIM_TR("Invalid reaction '%s'."_en,
+                         "Некорректная реакция '%s'."_ru),
+                  topic.string().c_str());
+        return;
+    }
+
+    // Whatever a client sends, a reaction counts as one vote.
+    weight = std::clamp(weight, -1, 1);
+
+    _q->react(post_id, user_id, weight);
+}
+
+void tim::p::post_ranking::on_archived(const std::vector<tim::uuid> &post_ids)
+{
+    // Their post_score rows are deleted by the next checkpoint.
+    bool was_top = false;
+    for (const tim::uuid &post_id: post_ids)
+    {
+        std::unordered_map<tim::uuid, double>::iterator it = _scores.find(post_id);
+        if (it == _scores.end())
+            continue;
+
+        was_top = _top.erase({ it->second, post_id }) > 0
+                      || was_top;
+        _scores.erase(it);
+        _dirty.insert(post_id);
+    }
+
+    if (was_top)
+        refill();
+}
+
+bool tim::p::post_ranking::load()
+{
+    tim::sqlite_query q(_db, "SELECT post_id, score, timestamp FROM post_score");
+    if (!q.prepare())
+        return false;
+
+    tim::uuid post_id;
+    double score = 0;
+    std::int64_t timestamp = 0;
+    bool done = false;
+    while (q.next(&done, post_id, score, timestamp)
+                && !done)
+    {
+        score *= scale(timestamp);
+        if (score >= tim::HOT_MIN_SCORE)
+            _scores.emplace(post_id, score);
+        else
+            _dirty.insert(post_id);
+    }
+
+    if (!done)
+        return TIM_TRACE(Error,
+                        TIM_TR("Failed to load post scores from database '%s'."_en,
+                              "Ошибка при загрузке рейтинга сообщений из базы данных '%s'."_ru),
+                        _db->path().string().c_str());
+
+    // The scores were never saved, so they are counted from the reactions once.
+    if (_scores.empty()
+            && _dirty.empty())
+        return rebuild();
+
+    refill();
+
+    return true;
+}
+
+bool tim::p::post_ranking::rebuild()
+{
+    const tim::post_shards *shards = tim::app()->post_shards();
+    for (std::size_t k = 0; k < shards->count(); ++k)
+    {
+        tim::sqlite_query q(shards->db(k), "SELECT post_id, timestamp, weight FROM reaction");
+        if (!q.prepare())
+            return false;
+
+        tim::uuid post_id;
+        std::int64_t timestamp = 0;
+        int weight = 0;
+        bool done = false;
+        while (q.next(&done, post_id, timestamp, weight)
+                    && !done)
+            _q->add(post_id, weight, timestamp);
+
+        if (!done)
+            return TIM_TRACE(Error,
+                            TIM_TR("Failed to load reactions from database '%s'."_en,
+                                  "Ошибка при загрузке реакций из базы данных '%s'."_ru),
+                            shards->path(k).string().c_str());
+    }
+
+    return true;
+}
+
+void tim::p::post_ranking::rebase(std::int64_t epoch)
+{
+    const double factor = scale(epoch);
+    _epoch = epoch;
+
+    for (std::unordered_map<tim::uuid, double>::iterator it = _scores.begin(); it != _scores.end();)
+    {
+        // The saved scores keep their own timestamps, only the forgotten go.
+        it->second /= factor;
+        if (it->second < tim::HOT_MIN_SCORE)
+        {
+            _dirty.insert(it->first);
+            it = _scores.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    refill();
+}
+
+void tim::p::post_ranking::refill()
+{
+    std::vector<std::pair<double, tim::uuid>> scores(_scores.size());
+    std::transform(_scores.begin(), _scores.end(), scores.begin(),
+                   [](const std::pair<const tim::uuid, double> &score)
+                   {
+                       return std::make_pair(score.second, score.first);
+                   });
+
+    const std::size_t count = std::min(scores.size(), tim::HOT_POST_COUNT);
+    std::nth_element(scores.begin(), scores.begin() + count, scores.end(), std::greater<>());
+
+    _top.clear();
+    _top.insert(scores.begin(), scores.begin() + count);
+}
+
+double tim::p::post_ranking::scale(std::int64_t timestamp) const
+{
+    static const double half_life
+        = (double)std::chrono::duration_cast<std::chrono::milliseconds>(tim::HOT_HALF_LIFE).count();
+
+    return std::exp2((double)(timestamp - _epoch) / half_life);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "tim_uuid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+struct mg_mgr;
+
+namespace tim
+{
+
+class sqlite_db;
+
+namespace p
+{
+
+struct post_ranking;
+
+}
+
+/**
+ * Ranks the posts by the weight of their reactions decayed over time.
+ *
+ * A user reacts to a post once, with a weight of 1 or -1. A reaction of
+ * weight w made at t adds w * 2^((t - epoch) / HOT_HALF_LIFE)
+ * to the post score. All the scores share the epoch, so their order never
+ * changes with time and a reaction updates a single score in O(1).
+ * The HOT_POST_COUNT best posts are kept ordered in memory, so hot()
+ * costs O(count). Changed scores are saved to the post_score table every
+ * HOT_CHECKPOINT_INTERVAL. The epoch is moved forward about once in
+ * HOT_HALF_LIFE, the scores below HOT_MIN_SCORE are forgotten then.
+ * Posts moved to the archive leave the ranking at once.
+ */
+class post_ranking
+{
+
+public:
+
+    struct entry
+    {
+        tim::uuid post_id;
+        double score = 0; // Decayed to now.
+    };
+
+    post_ranking(mg_mgr *mg, tim::sqlite_db *db);
+    ~post_ranking();
+
+    void react(const tim::uuid &post_id, const tim::uuid &user_id, int weight = 1);
+    void add(const tim::uuid &post_id, double weight, std::int64_t timestamp);
+
+    double score(const tim::uuid &post_id) const;
+    std::vector<entry> hot(std::size_t count) const;
+
+    bool checkpoint();
+
+private:
+
+    std::unique_ptr<tim::p::post_ranking> _d;
+};
+
+}
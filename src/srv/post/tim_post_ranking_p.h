@@ -0,0 +1,49 @@
+#pragma once
+
+#include "tim_post_ranking.h"
+
+#include <cassert>
+#include <filesystem>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+
+struct mg_timer;
+
+namespace tim::p
+{
+
+struct post_ranking
+{
+    explicit post_ranking(tim::post_ranking *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    static void on_timer(void *self);
+    static std::int64_t now();
+
+    void subscribe();
+    void on_reaction(const std::filesystem::path &topic, const char *data, std::size_t size);
+    void on_archived(const std::vector<tim::uuid> &post_ids);
+    bool load();
+    bool rebuild();
+    void rebase(std::int64_t epoch);
+    void refill();
+    double scale(std::int64_t timestamp) const;
+
+    tim::post_ranking *const _q;
+
+    tim::sqlite_db *_db = nullptr;
+    mg_timer *_timer = nullptr;
+    std::int64_t _epoch = 0; // In milliseconds.
+    std::unordered_map<tim::uuid, double> _scores; // Scaled to the epoch.
+    std::set<std::pair<double, tim::uuid>, std::greater<>> _top; // Best first, at most HOT_POST_COUNT.
+    std::unordered_set<tim::uuid> _dirty; // Not saved yet, or to be deleted if not in _scores.
+};
+
+}
@@ -4,8 +4,10 @@
 
 #include "tim_application.h"
 #include "tim_mqtt_client.h"
+#include "tim_post_shards.h"
 #include "tim_sqlite_db.h"
 #include "tim_sqlite_query.h"
+#include "tim_sqlite_writer.h"
 #include "tim_trace.h"
 #include "tim_translator.h"
 #include "tim_uuid.h"
@@ -30,28 +32,89 @@ tim::post_service::~post_service() = default;
 
 void tim::p::post_service::subscribe()
 {
-    tim::app()->mqtt()->subscribe("post/+",
+    tim::app()->mqtt()->subscribe("post/+/+",
                                   std::bind(&tim::p::post_service::on_post, this,
                                             std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    tim::app()->mqtt()->subscribe("reply/+/+/+",
+                                  std::bind(&tim::p::post_service::on_reply, this,
+                                            std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 }
 
 void tim::p::post_service::on_post(const std::filesystem::path &topic, const char *data, std::size_t size)
 {
-    const tim::uuid user_id = topic.filename().string();
-
-    tim::sqlite_query q(tim::app()->db(),
-                        "INSERT OR REPLACE INTO post (id, user_id, text) VALUES (?, ?, ?)");
-    if (!q.prepare())
-        TIM_TRACE(Fatal,
-                  TIM_TR("Failed to prepare database query '%s'."_en,
-                         "Не могу подготовить запрос '%s' к базе данных."_ru),
-                  q.sql().c_str());
-    q.bind(1, tim::uuid::create().to_string());
-    q.bind(2, user_id.to_string());
-    q.bind(3, std::string(data, size));
-    if (!q.exec())
+    // post/<user id>/<session id>
+    const tim::uuid user_id = topic.parent_path().filename().string();
+
+    // A new thread goes to the shard of its author.
+    tim::post_shards *shards = tim::app()->post_shards();
+    shards->writer(shards->shard(user_id))->post(
+        [id = tim::uuid::create(), user_id, session_id = topic.filename().string(), text = std::string(data, size)](tim::sqlite_db *db)
+        {
+            tim::sqlite_query q(db,
+                                "INSERT INTO post (id, user_id, text) VALUES (?, ?, ?)");
+            if (!q.prepare())
+                TIM_TRACE(Fatal,
+                          TIM_TR("Failed to prepare database query '%s'."_en,
+                                 "Не могу подготовить запрос '%s' к базе данных."_ru),
+                          q.sql().c_str());
+            q.bind(1, id.to_string());
+            q.bind(2, user_id.to_string());
+            q.bind(3, text);
+            if (!q.exec())
+                return TIM_TRACE(Error,
+                                TIM_TR("Failed to save post '%s' to the database."_en,
+                                      "Ошибка при сохранении поста '%s' в базе данных."_ru),
+                                session_id.c_str());
+
+            return true;
+        });
+}
+
+void tim::p::post_service::on_reply(const std::filesystem::path &topic, const char *data, std::size_t size)
+{
+    // reply/<post id>/<user id>/<session id>
+    const tim::uuid user_id = topic.parent_path().filename().string();
+    const tim::uuid post_id = topic.parent_path().parent_path().filename().string();
+
+    // The reply goes to the shard of its thread, where the post_closure_insert
+    // trigger links it. Archived threads are closed, their posts are in no shard.
+    std::size_t shard = 0;
+    if (!tim::app()->post_shards()->find(post_id, shard))
+    {
         TIM_TRACE(Error,
-                  TIM_TR("Failed to save post '%s' to the database."_en,
-                         "Ошибка при сохранении поста '%s' в базе данных."_ru),
-                  topic.filename().string().c_str());
+                  TIM_TR("Post '%s' is archived or does not exist, the reply is not saved."_en,
+                         "Сообщение '%s' в архиве или не существует, ответ не сохранен."_ru),
+                  post_id.to_string().c_str());
+        return;
+    }
+
+    tim::app()->post_shards()->writer(shard)->post(
+        [id = tim::uuid::create(), user_id, post_id, text = std::string(data, size)](tim::sqlite_db *db)
+        {
+            tim::sqlite_query q(db,
+                                "INSERT INTO post (id, user_id, post_id, text) SELECT ?, ?, id, ? FROM post WHERE id = ?");
+            if (!q.prepare())
+                TIM_TRACE(Fatal,
+                          TIM_TR("Failed to prepare database query '%s'."_en,
+                                 "Не могу подготовить запрос '%s' к базе данных."_ru),
+                          q.sql().c_str());
+            q.bind(1, id.to_string());
+            q.bind(2, user_id.to_string());
+            q.bind(3, text);
+            q.bind(4, post_id.to_string());
+            if (!q.exec())
+                return TIM_TRACE(Error,
+                                TIM_TR("Failed to save reply to post '%s' to the database."_en,
+                                      "Ошибка при сохранении ответа на сообщение '%s' в базе данных."_ru),
+                                post_id.to_string().c_str());
+
+            if (!db->change_count())
+                return TIM_TRACE(Error,
+                                TIM_TR("Post '%s' is archived or does not exist, the reply is not saved."_en,
+                                      "Сообщение '%s' в архиве или не существует, ответ не сохранен."_ru),
+                                post_id.to_string().c_str());
+
+            return true;
+        });
 }
@@ -10,5 +10,6 @@ struct post_service
 {
     void subscribe();
     void on_post(const std::filesystem::path &topic, const char *data, std::size_t size);
+    void on_reply(const std::filesystem::path &topic, const char *data, std::size_t size);
 };
 }
@@ -0,0 +1,162 @@
+#include "tim_bubble_cache.h"
+
+#include "tim_bubble_cache_p.h"
+
+#include "tim_box.h"
+#include "tim_config.h"
+#include "tim_display_width.h"
+#include "tim_math_tools.h"
+#include "tim_string_tools.h"
+
+#include <functional>
+#include <string_view>
+
+
+// Public
+
+tim::bubble_cache::bubble_cache()
+    : _d(new tim::p::bubble_cache(this))
+{
+    _d->_entries.reserve(tim::BUBBLE_CACHE_SIZE);
+}
+
+tim::bubble_cache::~bubble_cache() = default;
+
+tim::bubble_cache::buffer tim::bubble_cache::find(const std::string &title,
+                                                  const std::string &text,
+                                                  const tim::color &bg_color,
+                                                  std::size_t cols,
+                                                  tim::color_depth depth)
+{
+    const std::size_t hash = tim::p::bubble_cache::hash(title, text, bg_color, cols, depth);
+    for (const tim::p::bubble_cache::entry &e: _d->_entries)
+        if (e.hash == hash
+                && e.cols == cols
+                && e.depth == depth
+                && ::operator==(e.bg_color, bg_color)
+                && e.text == text
+                && e.title == title)
+        {
+            ++_d->_stats.hits;
+            return e.bytes;
+        }
+
+    ++_d->_stats.misses;
+
+    std::string bytes;
+    _d->render(bytes, title, text, bg_color, cols, tim::vt_style::encoder(depth));
+
+    tim::p::bubble_cache::entry *e = nullptr;
+    if (_d->_entries.size() < tim::BUBBLE_CACHE_SIZE)
+        e = &_d->_entries.emplace_back();
+    else
+    {
+        e = &_d->_entries[_d->_next];
+        _d->_next = (_d->_next + 1) % _d->_entries.size();
+    }
+
+    e->hash = hash;
+    e->title = title;
+    e->text = text;
+    e->bg_color = bg_color;
+    e->cols = cols;
+    e->depth = depth;
+    e->bytes = std::make_shared<const std::string>(std::move(bytes));
+
+    return e->bytes;
+}
+
+void tim::bubble_cache::clear()
+{
+    _d->_entries.clear();
+    _d->_next = 0;
+}
+
+const tim::bubble_cache::statistics &tim::bubble_cache::stats() const
+{
+    return _d->_stats;
+}
+
+
+// Private
+
+std::size_t tim::p::bubble_cache::hash(const std::string &title,
+                                       const std::string &text,
+                                       const tim::color &bg_color,
+                                       std::size_t cols,
+                                       tim::color_depth depth)
+{
+    std::size_t h = std::hash<std::string_view>()(text);
+    h = h * 31 + std::hash<std::string_view>()(title);
+    h = h * 31 + ((std::size_t)bg_color.r << 24 | bg_color.g << 16 | bg_color.b << 8 | bg_color.a);
+    h = h * 31 + cols;
+    return h * 31 + (std::size_t)depth;
+}
+
+/**
+ * The bytes tim::prompt_shell::cloud() used to write through the
+ * color calls: each line is colored on its own, so the background does
+ * not spill to the right margin on a new line, and the default style
+ * is back at the end.
+ */
+void tim::p::bubble_cache::render(std::string &out,
+                                  const std::string &title,
+                                  const std::string &text,
+                                  const tim::color &bg_color,
+                                  std::size_t cols,
+                                  tim::vt_color_encoder encoder)
+{
+    const std::string t = tim::trim(text);
+    if (t.empty())
+        return;
+
+    if (text.at(0) == '\n')
+        out += '\n';
+
+    const std::size_t t_len = tim::display_width(t);
+    const std::string ttl = ' '
+                                + tim::elided(tim::trim(title), 16)
+                                + ' ';
+    const std::size_t ttl_len = tim::display_width(ttl);
+    const std::size_t text_width = tim::bound(ttl_len,
+                                              t_len > cols * 2
+                                                  ? cols / 2
+                                                  : cols / 3,
+                                              cols - 6);
+    _layout.clear();
+    tim::aligned(_layout, t, tim::text_align::Justify, text_width);
+
+    _box.clear();
+    tim::box(_box, _layout);
+
+    const tim::vt_style style{ bg_color.text_color(), bg_color, {} };
+    _on.clear();
+    tim::vt_style::append_sgr(_on, tim::vt_style{}, style, encoder);
+    _off.clear();
+    tim::vt_style::append_sgr(_off, style, tim::vt_style{}, encoder);
+
+    if (ttl_len > 2) // Not only padding spaces.
+    {
+        out += _on;
+        out += ttl;
+        out += _off;
+        out += '\n';
+    }
+
+    const std::string_view box = _box;
+    for (std::size_t pos = 0, eol = box.find('\n');; eol = box.find('\n', pos))
+    {
+        out += _on;
+        out.append(box.substr(pos, eol - pos));
+        out += _off;
+
+        if (eol == std::string_view::npos)
+            break;
+        out += '\n';
+        pos = eol + 1;
+    }
+
+    if (text.size() > 1
+            && text.at(text.size() - 1) == '\n')
+        out += '\n';
+}
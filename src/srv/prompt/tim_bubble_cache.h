@@ -0,0 +1,66 @@
+#pragma once
+
+#include "tim_color.h"
+#include "tim_terminal_caps.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+
+namespace tim
+{
+
+namespace p
+{
+
+struct bubble_cache;
+
+}
+
+/**
+ * Message bubbles rendered once for all the sessions showing them.
+ *
+ * A post reaches the sessions of all the followers of its author at
+ * once, and they mostly share a few terminal widths. The first session
+ * to show a bubble renders it to the bytes for its terminal width and
+ * color depth, the sessions with the same ones write that immutable
+ * buffer as is. The last BUBBLE_CACHE_SIZE renderings are kept, so the
+ * timeline pages fetched again are not rendered again either.
+ */
+class bubble_cache
+{
+
+public:
+
+    using buffer = std::shared_ptr<const std::string>;
+
+    struct statistics
+    {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+    };
+
+    bubble_cache();
+    ~bubble_cache();
+
+    /**
+     * The bubble of \a text titled \a title, ready for tim::vt::write_encoded().
+     * Empty if the text is only spaces.
+     */
+    buffer find(const std::string &title,
+                const std::string &text,
+                const tim::color &bg_color,
+                std::size_t cols,
+                tim::color_depth depth);
+
+    void clear();
+
+    const statistics &stats() const;
+
+private:
+
+    std::unique_ptr<tim::p::bubble_cache> _d;
+};
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "tim_bubble_cache.h"
+
+#include "tim_vt_style.h"
+
+#include <cassert>
+#include <vector>
+
+
+namespace tim::p
+{
+
+struct bubble_cache
+{
+    explicit bubble_cache(tim::bubble_cache *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    struct entry
+    {
+        std::size_t hash = 0;
+        std::string title;
+        std::string text;
+        tim::color bg_color;
+        std::size_t cols = 0;
+        tim::color_depth depth = tim::color_depth::TrueColor;
+        tim::bubble_cache::buffer bytes;
+    };
+
+    static std::size_t hash(const std::string &title,
+                            const std::string &text,
+                            const tim::color &bg_color,
+                            std::size_t cols,
+                            tim::color_depth depth);
+
+    void render(std::string &out,
+                const std::string &title,
+                const std::string &text,
+                const tim::color &bg_color,
+                std::size_t cols,
+                tim::vt_color_encoder encoder);
+
+    tim::bubble_cache *const _q;
+
+    std::vector<entry> _entries; // At most BUBBLE_CACHE_SIZE, replaced in turn.
+    std::size_t _next = 0; // Replaced by the next miss once full.
+    std::string _layout; // Reused by render().
+    std::string _box; // Reused by render().
+    std::string _on; // SGR sequences of the bubble style,
+    std::string _off; // and back to the default one.
+    tim::bubble_cache::statistics _stats;
+};
+
+}
@@ -0,0 +1,87 @@
+#include "tim_frame_scheduler.h"
+
+#include "tim_frame_scheduler_p.h"
+
+#include "tim_application.h"
+#include "tim_config.h"
+
+#include "mongoose.h"
+
+#include <utility>
+
+
+// Public
+
+tim::frame_scheduler::frame_scheduler(mg_mgr *mg)
+    : _d(new tim::p::frame_scheduler(this))
+{
+    assert(mg);
+
+    _d->_timer = mg_timer_add(mg, tim::PROMPT_FRAME_INTERVAL.count(),
+                              MG_TIMER_REPEAT,
+                              &tim::p::frame_scheduler::on_timer, _d.get());
+
+    // Armed now rather than on the next poll, so the deadline is known.
+    _d->_timer->expire = mg_millis() + tim::PROMPT_FRAME_INTERVAL.count();
+}
+
+tim::frame_scheduler::~frame_scheduler() = default;
+
+void tim::frame_scheduler::schedule(std::uint64_t session_id, frame f)
+{
+    assert(f);
+
+    ++_d->_stats.requests;
+    // The event loop would not wake up for the timer otherwise.
+    if (_d->_pending.try_emplace(session_id, std::move(f)).second)
+        tim::app()->wake_up_at(_d->_timer->expire);
+}
+
+/**
+ * Call it before the session goes, its frame may be pending.
+ */
+void tim::frame_scheduler::cancel(std::uint64_t session_id)
+{
+    _d->_pending.erase(session_id);
+    _d->_ready.erase(session_id);
+}
+
+/**
+ * Draws the pending frames. A frame may close its session, or another
+ * one, so they are taken one by one.
+ */
+void tim::frame_scheduler::tick()
+{
+    if (_d->_pending.empty())
+        return;
+
+    _d->_ready.swap(_d->_pending);
+
+    while (!_d->_ready.empty())
+    {
+        const frame f = std::move(_d->_ready.extract(_d->_ready.begin()).mapped());
+        ++_d->_stats.frames;
+        f();
+    }
+}
+
+std::size_t tim::frame_scheduler::pending_count() const
+{
+    return _d->_pending.size();
+}
+
+const tim::frame_scheduler::statistics &tim::frame_scheduler::stats() const
+{
+    return _d->_stats;
+}
+
+
+// Private
+
+void tim::p::frame_scheduler::on_timer(void *self)
+{
+    tim::p::frame_scheduler *d = (tim::p::frame_scheduler *)self;
+    assert(d);
+
+    d->_q->tick();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+
+struct mg_mgr;
+
+namespace tim
+{
+
+namespace p
+{
+
+struct frame_scheduler;
+
+}
+
+/**
+ * Frame pacing of the prompt sessions.
+ *
+ * A session asks for a frame when it has something to draw and gets
+ * called back once on the next tick, every PROMPT_FRAME_INTERVAL, no
+ * matter how many times it asked meanwhile. So a burst of posts is
+ * drawn in one go, with the line being edited hidden and shown again
+ * once per frame instead of once per post.
+ */
+class frame_scheduler
+{
+
+public:
+
+    using frame = std::function<void ()>;
+
+    struct statistics
+    {
+        std::size_t requests = 0;
+        std::size_t frames = 0; // Requests of a session are drawn together.
+    };
+
+    explicit frame_scheduler(mg_mgr *mg);
+    ~frame_scheduler();
+
+    void schedule(std::uint64_t session_id, frame f);
+    void cancel(std::uint64_t session_id);
+    void tick();
+
+    std::size_t pending_count() const;
+    const statistics &stats() const;
+
+private:
+
+    std::unique_ptr<tim::p::frame_scheduler> _d;
+};
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "tim_frame_scheduler.h"
+
+#include <cassert>
+#include <unordered_map>
+
+
+struct mg_timer;
+
+namespace tim::p
+{
+
+struct frame_scheduler
+{
+    explicit frame_scheduler(tim::frame_scheduler *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    static void on_timer(void *self);
+
+    tim::frame_scheduler *const _q;
+
+    mg_timer *_timer = nullptr;
+    std::unordered_map<std::uint64_t, tim::frame_scheduler::frame> _pending; // Of the next tick,
+    std::unordered_map<std::uint64_t, tim::frame_scheduler::frame> _ready; // and of this one.
+    tim::frame_scheduler::statistics _stats;
+};
+
+}
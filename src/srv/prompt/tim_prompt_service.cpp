@@ -3,12 +3,19 @@
 #include "tim_prompt_service_p.h"
 
 #include "tim_application.h"
+#include "tim_config.h"
+#include "tim_frame_scheduler.h"
 #include "tim_mqtt_client.h"
+#include "tim_post.h"
+#include "tim_post_fanout.h"
 #include "tim_prompt_shell.h"
-#include "tim_string_tools.h"
+#include "tim_scrollback.h"
+#include "tim_signal_connection.h"
 #include "tim_tcl.h"
 #include "tim_telnet_server.h"
+#include "tim_timeline.h"
 #include "tim_trace.h"
+#include "tim_user_directory.h"
 #include "tim_vt.h"
 
 
@@ -23,7 +30,9 @@ tim::prompt_service::prompt_service(mg_connection *c)
     _d->_tcl.reset(new tim::tcl(_d->_terminal.get(), _d->_user.id));
     _d->_shell.reset(new tim::prompt_shell(_d->_terminal.get(), _d->_tcl.get()));
 
-    _d->_topic = std::filesystem::path("post") / std::to_string(id());
+    _d->_topic = std::filesystem::path("post")
+                    / _d->_user.id.to_string(tim::uuid::format::NoBrackets)
+                    / std::to_string(id());
 
     _d->_telnet->data_ready.connect(
         std::bind(&tim::p::prompt_service::on_data_ready, _d.get(),
@@ -32,17 +41,56 @@ tim::prompt_service::prompt_service(mg_connection *c)
     _d->_shell->posted.connect(
         [&](const std::string &text)
         {
+            tim::app()->scrollback()->add(id(), _d->_user.id, text);
+
             if (tim::app()->mqtt()->is_connected())
                 tim::app()->mqtt()->publish(_d->_topic, text.c_str(), text.size());
         });
 
+    _d->_tcl->replied.connect(
+        [&](const tim::uuid &post_id, const std::string &text)
+        {
+            if (tim::app()->mqtt()->is_connected())
+                tim::app()->mqtt()->publish(std::filesystem::path("reply")
+                                                / post_id.to_string(tim::uuid::format::NoBrackets)
+                                                / _d->_topic.parent_path().filename()
+                                                / _d->_topic.filename(),
+                                            text.c_str(), text.size());
+        });
+
+    _d->_tcl->scrolled.connect(
+        std::bind(&tim::p::prompt_service::on_scrolled, _d.get(), std::placeholders::_1));
+
+    _d->_tcl->screen_switched.connect(
+        std::bind(&tim::p::prompt_service::on_screen_switched, _d.get(), std::placeholders::_1));
+
+    _d->_telnet->resized.connect(
+        std::bind(&tim::p::prompt_service::on_resized, _d.get(),
+                  std::placeholders::_1, std::placeholders::_2));
+
+    _d->_tcl->timeline()->fetched.connect(
+        std::bind(&tim::p::prompt_service::on_post_fetched, _d.get(), std::placeholders::_1));
+
+    _d->_feed.reset(new tim::signal_connection(tim::app()->post_fanout()->feed(_d->_user.id).connect(
+        std::bind(&tim::p::prompt_service::on_post, _d.get(),
+                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3))));
+
     tim::app()->mqtt()->connected.connect(std::bind(&tim::p::prompt_service::subscribe, _d.get()));
 
     if (tim::app()->mqtt()->is_connected())
         _d->subscribe();
+
+    // Catch up with the latest posts.
+    if (_d->_tcl->timeline()->latest(tim::TIMELINE_PAGE_SIZE)
+            && !_d->_tcl->timeline()->empty())
+        _d->_shell->new_line();
 }
 
-tim::prompt_service::~prompt_service() = default;
+tim::prompt_service::~prompt_service()
+{
+    tim::app()->frame_scheduler()->cancel(id());
+    tim::app()->scrollback()->remove(id());
+}
 
 
 // Private
@@ -50,9 +98,6 @@ tim::prompt_service::~prompt_service() = default;
 void tim::p::prompt_service::subscribe()
 {
     tim::app()->mqtt()->publish("user/connect", _user.id);
-    tim::app()->mqtt()->subscribe(_topic.parent_path() / "+",
-                                  std::bind(&tim::p::prompt_service::on_post, this,
-                                            std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 }
 
 void tim::p::prompt_service::on_data_ready(const char *data, std::size_t size)
@@ -61,17 +106,132 @@ void tim::p::prompt_service::on_data_ready(const char *data, std::size_t size)
 
     if (size
             && !_shell->write(data, size))
+    {
         _q->close();
+        return;
+    }
+
+    _shell->terminal()->flush();
 }
 
 void tim::p::prompt_service::on_post(const std::filesystem::path &topic, const char *data, std::size_t size)
 {
-    if (topic != _topic)
+    // post/<user id>/<session id> or reply/<post id>/<user id>/<session id>
+    if (topic.filename() != _topic.filename()
+            || topic.parent_path().filename() != _topic.parent_path().filename())
     {
-        _shell->cloud(_user.title(),
-                      '\n' + std::string(data, size),
-                      _shell->terminal()->color(
-                        tim::to_int(topic.filename()) % (_shell->terminal()->color_count() - 1) + 1));
-        _shell->new_line();
+        const tim::uuid user_id = topic.parent_path().filename().string();
+
+        _frame.push_back(tim::app()->scrollback()->add(_q->id(), user_id, std::string_view(data, size)));
+        tim::app()->frame_scheduler()->schedule(_q->id(), std::bind(&tim::p::prompt_service::on_frame, this));
     }
 }
+
+void tim::p::prompt_service::on_post_fetched(const tim::post &post)
+{
+    draw(post.user_id, post.text);
+    tim::app()->scrollback()->add(_q->id(), post.user_id, post.text);
+}
+
+/**
+ * A window drag reports many sizes, the screen is drawn again at the
+ * last one on the next frame.
+ */
+void tim::p::prompt_service::on_resized(std::size_t rows, std::size_t cols)
+{
+    (void) rows;
+    (void) cols;
+
+    _resized = true;
+    tim::app()->frame_scheduler()->schedule(_q->id(), std::bind(&tim::p::prompt_service::on_frame, this));
+}
+
+void tim::p::prompt_service::on_scrolled(std::size_t count)
+{
+    tim::app()->scrollback()->for_each(_q->id(), count,
+                                       [this](const tim::scrollback::item &item)
+                                       {
+                                           draw(item.user_id, *item.text);
+                                       });
+}
+
+/**
+ * The screen model starts blank, so it gets the latest posts drawn into
+ * it. Everything written to the terminal, the line being edited too,
+ * goes through the model then and reaches the terminal as the difference
+ * from the last flush, once per input and per frame.
+ */
+void tim::p::prompt_service::on_screen_switched(bool enable)
+{
+    _shell->terminal()->set_screen_enabled(enable);
+    if (!enable)
+        return;
+
+    _shell->terminal()->clear();
+    tim::app()->scrollback()->for_each(_q->id(), _shell->terminal()->rows() / 4,
+                                       [this](const tim::scrollback::item &item)
+                                       {
+                                           draw(item.user_id, *item.text);
+                                       });
+    _shell->terminal()->write("\n", 1);
+}
+
+/**
+ * The posts came since the last frame are drawn together, with the line
+ * being edited hidden once and shown again below them, as a single
+ * update if the terminal supports it.
+ */
+void tim::p::prompt_service::on_frame()
+{
+    if (_resized)
+    {
+        redraw();
+        return;
+    }
+
+    if (_frame.empty())
+        return;
+
+    _shell->terminal()->begin_update();
+    _shell->hide();
+    for (const tim::scrollback::item &item: _frame)
+        draw(item.user_id, *item.text);
+    _shell->terminal()->write("\n", 1);
+    _shell->show();
+    _shell->terminal()->end_update();
+    _shell->terminal()->flush();
+
+    _frame.clear();
+}
+
+/**
+ * The screen is drawn again from the scrollback at the current width.
+ * A bubble takes four rows at least, so no more than rows / 4 of
+ * them fit on the screen.
+ */
+void tim::p::prompt_service::redraw()
+{
+    // The posts waiting for a frame are in the scrollback too.
+    _frame.clear();
+    _resized = false;
+
+    _shell->terminal()->begin_update();
+    _shell->terminal()->clear();
+    tim::app()->scrollback()->for_each(_q->id(), _shell->terminal()->rows() / 4,
+                                       [this](const tim::scrollback::item &item)
+                                       {
+                                           draw(item.user_id, *item.text);
+                                       });
+    _shell->terminal()->write("\n", 1);
+    _shell->show();
+    _shell->terminal()->end_update();
+    _shell->terminal()->flush();
+}
+
+void tim::p::prompt_service::draw(const tim::uuid &user_id, std::string_view text)
+{
+    _shell->cloud(tim::app()->user_directory()->find(user_id).title(),
+                  '\n' + std::string(text),
+                  _shell->terminal()->color(
+                    std::hash<tim::uuid>{}(user_id) % (_shell->terminal()->color_count() - 1) + 1));
+}
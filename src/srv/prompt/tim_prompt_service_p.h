@@ -1,16 +1,21 @@
 #pragma once
 
+#include "tim_scrollback.h"
 #include "tim_user.h"
 
 #include <cassert>
 #include <filesystem>
+#include <string_view>
+#include <vector>
 
 
 namespace tim
 {
 
+struct post;
 class prompt_service;
 class prompt_shell;
+class signal_connection;
 class tcl;
 class telnet_server;
 class vt;
@@ -29,6 +34,13 @@ struct prompt_service
     void subscribe();
     void on_data_ready(const char *data, std::size_t size);
     void on_post(const std::filesystem::path &topic, const char *data, std::size_t size);
+    void on_post_fetched(const tim::post &post);
+    void on_resized(std::size_t rows, std::size_t cols);
+    void on_scrolled(std::size_t count);
+    void on_screen_switched(bool enable);
+    void on_frame();
+    void redraw();
+    void draw(const tim::uuid &user_id, std::string_view text);
 
     tim::prompt_service *const _q;
 
@@ -37,7 +49,14 @@ struct prompt_service
     std::unique_ptr<tim::tcl> _tcl;
     std::unique_ptr<tim::prompt_shell> _shell;
     std::filesystem::path _topic;
+    std::unique_ptr<tim::signal_connection> _feed; // Posts of the user and of the followed users.
+    std::vector<tim::scrollback::item> _frame; // Posts drawn on the next frame.
+    bool _resized = false; // The whole screen is drawn on the next frame.
 
+    // Every session is this user until the sessions log in, so the feed
+    // and follow/unfollow act for this one identity. Its setnick and
+    // seticon are also the only user changes the directory hears of from
+    // the sessions.
     const tim::user _user
     {
         .id = "7ce5bba5-3eda-46dc-99c0-317f16bc9b3d",
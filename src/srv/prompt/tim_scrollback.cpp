@@ -0,0 +1,151 @@
+#include "tim_scrollback.h"
+
+#include "tim_scrollback_p.h"
+
+#include "tim_config.h"
+
+#include <algorithm>
+
+
+// Public
+
+tim::scrollback::scrollback(std::size_t memory_limit)
+    : _d(new tim::p::scrollback(this))
+{
+    _d->_memory_limit = memory_limit;
+}
+
+tim::scrollback::~scrollback() = default;
+
+/**
+ * Returns the item added, it may be trimmed from the session already.
+ */
+tim::scrollback::item tim::scrollback::add(std::uint64_t session_id, const tim::uuid &user_id, std::string_view text)
+{
+    const std::pair<std::unordered_map<std::uint64_t, tim::p::scrollback::ring>::iterator, bool> res =
+        _d->_rings.try_emplace(session_id);
+    tim::p::scrollback::ring &r = res.first->second;
+    if (res.second)
+    {
+        r.lru = _d->_lru.insert(_d->_lru.end(), session_id);
+        ++_d->_stats.sessions;
+        _d->_stats.memory += sizeof(r);
+    }
+    else
+        _d->_lru.splice(_d->_lru.end(), _d->_lru, r.lru);
+
+    if (r.items.size() == tim::SCROLLBACK_SIZE)
+        _d->pop(r);
+
+    const tim::scrollback::item item{ user_id, _d->intern(text) };
+    r.items.push_back(item);
+    ++_d->_stats.items;
+    _d->_stats.memory += sizeof(tim::scrollback::item);
+
+    _d->trim();
+
+    return item;
+}
+
+void tim::scrollback::remove(std::uint64_t session_id)
+{
+    std::unordered_map<std::uint64_t, tim::p::scrollback::ring>::iterator it = _d->_rings.find(session_id);
+    if (it == _d->_rings.end())
+        return;
+
+    while (!it->second.items.empty())
+        _d->pop(it->second);
+
+    _d->_lru.erase(it->second.lru);
+    _d->_rings.erase(it);
+    --_d->_stats.sessions;
+    _d->_stats.memory -= sizeof(tim::p::scrollback::ring);
+}
+
+void tim::scrollback::for_each(std::uint64_t session_id,
+                               std::size_t count,
+                               const std::function<void (const tim::scrollback::item &)> &fn)
+{
+    std::unordered_map<std::uint64_t, tim::p::scrollback::ring>::iterator it = _d->_rings.find(session_id);
+    if (it == _d->_rings.end())
+        return;
+
+    tim::p::scrollback::ring &r = it->second;
+    _d->_lru.splice(_d->_lru.end(), _d->_lru, r.lru);
+
+    for (std::deque<tim::scrollback::item>::const_iterator item = r.items.end() - std::min(count, r.items.size());
+            item != r.items.end();
+            ++item)
+        fn(*item);
+}
+
+std::size_t tim::scrollback::size(std::uint64_t session_id) const
+{
+    std::unordered_map<std::uint64_t, tim::p::scrollback::ring>::const_iterator it = _d->_rings.find(session_id);
+    return it == _d->_rings.end()
+                ? 0
+                : it->second.items.size();
+}
+
+const tim::scrollback::statistics &tim::scrollback::stats() const
+{
+    return _d->_stats;
+}
+
+
+// Private
+
+/**
+ * A text delivered to many sessions is kept once. It leaves the
+ * index and the memory count with its last item.
+ */
+std::shared_ptr<const std::string> tim::p::scrollback::intern(std::string_view text)
+{
+    std::unordered_map<std::string_view, std::weak_ptr<const std::string>>::const_iterator it = _texts.find(text);
+    if (it != _texts.end())
+        return it->second.lock();
+
+    std::shared_ptr<const std::string> s(new std::string(text),
+                                         [this](const std::string *s)
+                                         {
+                                             _texts.erase(*s);
+                                             --_stats.texts;
+                                             _stats.memory -= sizeof(*s) + s->capacity();
+                                             delete s;
+                                         });
+    _texts.emplace(*s, s);
+    ++_stats.texts;
+    _stats.memory += sizeof(*s) + s->capacity();
+
+    return s;
+}
+
+void tim::p::scrollback::pop(ring &r)
+{
+    assert(!r.items.empty());
+
+    r.items.pop_front();
+    --_stats.items;
+    _stats.memory -= sizeof(tim::scrollback::item);
+}
+
+/**
+ * The least recently active session loses its oldest item until the
+ * memory fits. Shared texts go with the last session holding them.
+ */
+void tim::p::scrollback::trim()
+{
+    while (_stats.memory > _memory_limit
+               && _stats.items)
+    {
+        ring &r = _rings.at(_lru.front());
+        if (r.items.empty())
+        {
+            _lru.splice(_lru.end(), _lru, r.lru);
+            continue;
+        }
+
+        pop(r);
+        ++_stats.trimmed;
+    }
+}
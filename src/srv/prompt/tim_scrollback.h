@@ -0,0 +1,76 @@
+#pragma once
+
+#include "tim_uuid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+
+namespace tim
+{
+
+namespace p
+{
+
+struct scrollback;
+
+}
+
+/**
+ * Recent messages of the prompt sessions, to draw them again after
+ * a resize or on the scroll command.
+ *
+ * A session keeps its last SCROLLBACK_SIZE messages as the author and
+ * the text, the bubble is rendered again at the width of the moment.
+ * The texts are shared: a post delivered to many sessions is kept
+ * once. When all the sessions together take more than the memory
+ * limit, the oldest messages of the least recently active sessions
+ * are dropped first.
+ */
+class scrollback
+{
+
+public:
+
+    struct item
+    {
+        tim::uuid user_id; // The author.
+        std::shared_ptr<const std::string> text;
+    };
+
+    struct statistics
+    {
+        std::size_t sessions = 0;
+        std::size_t items = 0;
+        std::size_t texts = 0;
+        std::size_t memory = 0; // Bytes of the items and texts, the allocator overhead aside.
+        std::size_t trimmed = 0; // Items dropped over the memory limit.
+    };
+
+    explicit scrollback(std::size_t memory_limit);
+    ~scrollback();
+
+    tim::scrollback::item add(std::uint64_t session_id, const tim::uuid &user_id, std::string_view text);
+    void remove(std::uint64_t session_id);
+
+    /**
+     * Calls \a fn for the last \a count messages of the session,
+     * oldest first.
+     */
+    void for_each(std::uint64_t session_id,
+                  std::size_t count,
+                  const std::function<void (const tim::scrollback::item &)> &fn);
+    std::size_t size(std::uint64_t session_id) const;
+
+    const statistics &stats() const;
+
+private:
+
+    std::unique_ptr<tim::p::scrollback> _d;
+};
+
+}
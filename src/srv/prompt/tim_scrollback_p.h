@@ -0,0 +1,41 @@
+#pragma once
+
+#include "tim_scrollback.h"
+
+#include <cassert>
+#include <deque>
+#include <list>
+#include <unordered_map>
+
+
+namespace tim::p
+{
+
+struct scrollback
+{
+    explicit scrollback(tim::scrollback *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    struct ring
+    {
+        std::deque<tim::scrollback::item> items; // Oldest first, at most SCROLLBACK_SIZE.
+        std::list<std::uint64_t>::iterator lru;
+    };
+
+    std::shared_ptr<const std::string> intern(std::string_view text);
+    void pop(ring &r);
+    void trim();
+
+    tim::scrollback *const _q;
+
+    std::size_t _memory_limit = 0;
+    std::unordered_map<std::string_view, std::weak_ptr<const std::string>> _texts; // Shared by the rings, so goes before them.
+    std::list<std::uint64_t> _lru; // Least recently active session first.
+    std::unordered_map<std::uint64_t, ring> _rings;
+    tim::scrollback::statistics _stats;
+};
+
+}
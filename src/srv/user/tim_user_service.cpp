@@ -7,6 +7,7 @@
 #include "tim_mqtt_client.h"
 #include "tim_sqlite_db.h"
 #include "tim_sqlite_query.h"
+#include "tim_user_directory.h"
 #include "tim_trace.h"
 #include "tim_translator.h"
 
@@ -91,6 +92,8 @@ void tim::p::user_service::setnick(const std::filesystem::path &topic,
                          "Ошибка при обновлении ника у пользователя '%s'."_ru),
                   user_id.to_string().c_str());
 
+    tim::app()->user_directory()->invalidate(user_id);
+
 }
 
 void tim::p::user_service::seticon(const std::filesystem::path &topic,
@@ -119,4 +122,6 @@ void tim::p::user_service::seticon(const std::filesystem::path &topic,
                          "Ошибка при обновлении иконки у пользователя '%s'."_ru),
                   user_id.to_string().c_str());
 
+    tim::app()->user_directory()->invalidate(user_id);
+
 }
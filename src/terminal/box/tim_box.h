@@ -0,0 +1,108 @@
+#pragma once
+
+#include "tim_display_width.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+
+namespace tim
+{
+
+/**
+ * Border styles of tim::box(), drawn like the libfort ones of the same name.
+ */
+struct solid_border
+{
+    static constexpr std::string_view top_left = "┌";
+    static constexpr std::string_view top_right = "┐";
+    static constexpr std::string_view bottom_left = "└";
+    static constexpr std::string_view bottom_right = "┘";
+    static constexpr std::string_view horizontal = "─";
+    static constexpr std::string_view vertical = "│";
+};
+
+struct solid_round_border : tim::solid_border
+{
+    static constexpr std::string_view top_left = "╭";
+    static constexpr std::string_view top_right = "╮";
+    static constexpr std::string_view bottom_left = "╰";
+    static constexpr std::string_view bottom_right = "╯";
+};
+
+struct double_border
+{
+    static constexpr std::string_view top_left = "╔";
+    static constexpr std::string_view top_right = "╗";
+    static constexpr std::string_view bottom_left = "╚";
+    static constexpr std::string_view bottom_right = "╝";
+    static constexpr std::string_view horizontal = "═";
+    static constexpr std::string_view vertical = "║";
+};
+
+/**
+ * Appends \a text framed by \a Border to \a out, the lines separated
+ * by '\n' and the last one not terminated. Every line of the text is
+ * padded to the widest one, plus \a padding spaces on both sides.
+ * A trailing '\n' of the text makes an empty last line, like
+ * in a libfort cell.
+ */
+template<class Border = tim::solid_round_border>
+void box(std::string &out, std::string_view text, std::size_t padding = 1);
+
+}
+
+
+// Implementation
+
+template<class Border>
+void tim::box(std::string &out, std::string_view text, std::size_t padding)
+{
+    // Measured first, the lines are padded to the widest one.
+    std::size_t width = 0;
+    std::size_t rows = 1;
+    for (std::size_t pos = 0, eol = text.find('\n');; eol = text.find('\n', pos))
+    {
+        const std::size_t w = tim::display_width(text.substr(pos, eol - pos));
+        if (w > width)
+            width = w;
+
+        if (eol == std::string_view::npos)
+            break;
+        pos = eol + 1;
+        ++rows;
+    }
+
+    const std::size_t inner = width + padding * 2;
+    out.reserve(out.size()
+                    + text.size()
+                    + (Border::top_left.size() + Border::top_right.size() + inner * Border::horizontal.size() + 1) * 2
+                    + (Border::vertical.size() * 2 + inner + 1) * rows);
+
+    out.append(Border::top_left);
+    for (std::size_t i = 0; i < inner; ++i)
+        out.append(Border::horizontal);
+    out.append(Border::top_right);
+
+    for (std::size_t pos = 0, eol = text.find('\n');; eol = text.find('\n', pos))
+    {
+        const std::string_view line = text.substr(pos, eol - pos);
+        out += '\n';
+        out.append(Border::vertical);
+        out.append(padding, ' ');
+        out.append(line);
+        out.append(width - tim::display_width(line) + padding, ' ');
+        out.append(Border::vertical);
+
+        if (eol == std::string_view::npos)
+            break;
+        pos = eol + 1;
+    }
+
+    out += '\n';
+    out.append(Border::bottom_left);
+    for (std::size_t i = 0; i < inner; ++i)
+        out.append(Border::horizontal);
+    out.append(Border::bottom_right);
+}
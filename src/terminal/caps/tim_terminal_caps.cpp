@@ -0,0 +1,105 @@
+#include "tim_terminal_caps.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <utility>
+
+
+using depth = tim::color_depth;
+
+// Sorted by name. Families match by prefix, so "xterm" covers
+// "xterm-color", and "xterm-kitty" is more specific than "xterm".
+static constexpr std::array<tim::terminal_caps, 22> TERMINAL_CAPS =
+{{
+    //  name            colors              scroll  paste   sync
+    { "alacritty",      depth::TrueColor,   true,   true,   true },
+    { "ansi",           depth::Colors16,    true,   false,  false },
+    { "contour",        depth::TrueColor,   true,   true,   true },
+    { "cygwin",         depth::Colors16,    true,   false,  false },
+    { "dumb",           depth::Mono,        false,  false,  false },
+    { "foot",           depth::TrueColor,   true,   true,   true },
+    { "gnome",          depth::TrueColor,   true,   true,   false },
+    { "iterm2",         depth::TrueColor,   true,   true,   true },
+    { "konsole",        depth::TrueColor,   true,   true,   false },
+    { "linux",          depth::Colors16,    true,   false,  false },
+    { "mintty",         depth::TrueColor,   true,   true,   true },
+    { "putty",          depth::Colors256,   true,   true,   false },
+    { "rxvt",           depth::Colors16,    true,   true,   false },
+    { "screen",         depth::Colors16,    true,   true,   false },
+    { "st",             depth::Colors256,   true,   true,   true },
+    { "tmux",           depth::Colors256,   true,   true,   true },
+    { "vt",             depth::Mono,        true,   false,  false },
+    { "vte",            depth::TrueColor,   true,   true,   false },
+    { "wezterm",        depth::TrueColor,   true,   true,   true },
+    { "xterm",          depth::Colors256,   true,   true,   false },
+    { "xterm-ghostty",  depth::TrueColor,   true,   true,   true },
+    { "xterm-kitty",    depth::TrueColor,   true,   true,   true }
+}};
+
+static constexpr bool is_sorted(const std::array<tim::terminal_caps, TERMINAL_CAPS.size()> &caps)
+{
+    for (std::size_t i = 1; i < caps.size(); ++i)
+        if (std::string_view(caps[i - 1].name) >= std::string_view(caps[i].name))
+            return false;
+
+    return true;
+}
+
+static_assert(is_sorted(TERMINAL_CAPS), "TERMINAL_CAPS must be sorted by name.");
+
+// The suffixes are checked in order, the first found wins.
+static constexpr std::array<std::pair<std::string_view, tim::color_depth>, 7> DEPTH_SUFFIXES =
+{{
+    { "-direct",    depth::TrueColor },
+    { "-truecolor", depth::TrueColor },
+    { "-24bit",     depth::TrueColor },
+    { "-256color",  depth::Colors256 },
+    { "-88color",   depth::Colors256 },
+    { "-16color",   depth::Colors16 },
+    { "-mono",      depth::Mono }
+}};
+
+
+// Public
+
+tim::terminal_caps tim::terminal_caps::find(std::string_view name)
+{
+    // TTYPE names are often upper case.
+    char buf[64];
+    const std::size_t size = std::min(name.size(), sizeof(buf));
+    for (std::size_t i = 0; i < size; ++i)
+        buf[i] = (char)std::tolower((unsigned char)name[i]);
+    const std::string_view term(buf, size);
+
+    tim::terminal_caps res;
+    if (term.empty())
+        return res;
+
+    std::size_t best = 0;
+    for (const tim::terminal_caps &caps: TERMINAL_CAPS)
+    {
+        const std::string_view family(caps.name);
+        // A family is followed by the end or by a dash, so "st" is not "stterm".
+        if (family.size() > best
+                && term.compare(0, family.size(), family) == 0
+                && (term.size() == family.size()
+                        || term[family.size()] == '-'
+                        || (family == "vt"
+                                && std::isdigit((unsigned char)term[family.size()]))))
+        {
+            res = caps;
+            best = family.size();
+        }
+    }
+
+    for (const std::pair<std::string_view, tim::color_depth> &suffix: DEPTH_SUFFIXES)
+        if (term.size() > suffix.first.size()
+                && term.compare(term.size() - suffix.first.size(), suffix.first.size(), suffix.first) == 0)
+        {
+            res.colors = suffix.second;
+            break;
+        }
+
+    return res;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string_view>
+
+
+namespace tim
+{
+
+enum class color_depth
+{
+    Mono,
+    Colors16,
+    Colors256,
+    TrueColor
+};
+
+/**
+ * What a terminal type can do, like terminfo says it.
+ */
+struct terminal_caps
+{
+    const char *name = ""; // The terminal type or the prefix of its family.
+    tim::color_depth colors = tim::color_depth::TrueColor;
+    bool scroll_region = true; // DECSTBM.
+    bool bracketed_paste = false; // Mode 2004.
+    bool synchronized_output = false; // Mode 2026.
+
+    /**
+     * Finds the capabilities of the terminal type as reported by TTYPE,
+     * case insensitive. The longest known prefix matches, the usual
+     * suffixes like "-256color" or "-direct" set the color depth.
+     * Unknown terminals get the defaults.
+     */
+    static tim::terminal_caps find(std::string_view name);
+};
+
+}
@@ -28,6 +28,18 @@ void tim::a_terminal::set_theme(const tim::terminal_theme &theme)
     _d->_theme = theme;
 }
 
+bool tim::a_terminal::write(const char *data, std::size_t size)
+{
+    return _d->_proto->write(data, size);
+}
+
+bool tim::a_terminal::write_str(const std::string &s)
+{
+    return s.empty()
+                ? true
+                : write(s.c_str(), s.size());
+}
+
 int tim::a_terminal::vprintf(const char *format, va_list args)
 {
     assert(format && *format);
@@ -40,7 +52,7 @@ int tim::a_terminal::vprintf(const char *format, va_list args)
     va_end(args_copy);
 
     if (n > 0)
-        _d->_proto->write(s.c_str(), n);
+        write(s.c_str(), n);
 
     return n;
 }
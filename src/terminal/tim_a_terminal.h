@@ -4,6 +4,7 @@
 
 #include <cstdarg>
 #include <memory>
+#include <string>
 
 
 namespace tim
@@ -45,6 +46,9 @@ public:
     virtual void reverse_colors() = 0;
     virtual void reset_colors() = 0;
 
+    virtual bool write(const char *data, std::size_t size);
+    bool write_str(const std::string &s);
+
     int vprintf(const char *format, va_list args);
     int printf(const char *format, ... )
                __attribute__ ((format(printf, 2, 3)));
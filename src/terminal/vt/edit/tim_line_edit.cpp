@@ -3,6 +3,7 @@
 #include "tim_line_edit_p.h"
 
 #include "tim_a_protocol.h"
+#include "tim_display_width.h"
 #include "tim_file_tools.h"
 #include "tim_string_tools.h"
 #include "tim_vt.h"
@@ -110,8 +111,8 @@ bool tim::line_edit::new_line()
 
     const std::string p = prompt();
     return (!_d->_line_count++
-                        || _d->_terminal->protocol()->write("\n", 1))
-                    && _d->_terminal->protocol()->write(p.c_str(), p.size());
+                        || _d->_terminal->write("\n", 1))
+                    && _d->_terminal->write(p.c_str(), p.size());
 }
 
 /**
@@ -170,7 +171,7 @@ tim::line_edit::status tim::line_edit::get_line(const char *data, std::size_t si
             return status::Finished;
 
         case (char)tim::key::Ctrl_C:
-            _d->_terminal->protocol()->write_str("^C");
+            _d->_terminal->write_str("^C");
             clear();
             return status::Break;
 
@@ -357,6 +358,9 @@ void tim::line_edit::hide()
 
 void tim::line_edit::show()
 {
+    // The terminal may have been resized while hidden.
+    _d->_cols = _d->_terminal->cols();
+
     if (_d->_in_completion)
         _d->refresh_line_with_completion(nullptr, tim::p::line_edit::refresh_flag::Write);
     else
@@ -599,6 +603,19 @@ std::int32_t tim::p::line_edit::complete_line(std::int32_t key_pressed)
     return c; /* Return last read character */
 }
 
+/** Number of terminal cells the \a n characters at \a s take on the screen.
+  */
+std::size_t tim::p::line_edit::columns(const wchar_t *s, std::size_t n) const
+{
+    if (_mask_mode)
+        return n;
+
+    std::size_t res = 0;
+    for (std::size_t i = 0; i < n; ++i)
+        res += tim::char_width((char32_t)s[i]);
+    return res;
+}
+
 /** Helper of refresh_single_line() and refresh_multi_line() to show hints
   * to the right of the prompt.
   */
@@ -609,7 +626,7 @@ void tim::p::line_edit::refresh_show_hints(std::wstring &s)
 
     _cols = _terminal->cols();
 
-    if (_plen + _line.size() < _cols)
+    if (_plen + columns(_line.c_str(), _line.size()) < _cols)
     {
         int color = -1, bold = 0;
         const std::wstring hint = tim::to_wstring(_hinter(tim::from_wstring(_line), color, bold));
@@ -644,14 +661,16 @@ void tim::p::line_edit::refresh_single_line(refresh_flags flags)
     std::size_t len = _line.size();
     std::size_t pos = _pos;
 
-    while (_plen + pos >= _cols)
+    while (pos
+                && _plen + columns(buf, pos) >= _cols)
     {
         ++buf;
         --len;
         --pos;
     }
 
-    while (_plen + len > _cols)
+    while (len
+                && _plen + columns(buf, len) > _cols)
         --len;
 
     /* Cursor to the left edge. */
@@ -675,11 +694,11 @@ void tim::p::line_edit::refresh_single_line(refresh_flags flags)
     if (flags.test(refresh_flag::Write))
     {
         /* Move cursor to the original position. */
-        ws += tim::to_wstring(tim::sprintf("\r\x1b[%dC", (int)(pos + _plen)));
+        ws += tim::to_wstring(tim::sprintf("\r\x1b[%dC", (int)(columns(buf, pos) + _plen)));
     }
 
     const std::string s = tim::from_wstring(ws);
-    if (!_terminal->protocol()->write(s.c_str(), s.size()))
+    if (!_terminal->write(s.c_str(), s.size()))
     {
         /* Can't recover from write error. */
     }
@@ -696,7 +715,8 @@ void tim::p::line_edit::refresh_multi_line(refresh_flags flags)
 {
     _cols = _terminal->cols();
 
-    int rows = static_cast<int>((_plen + _line.size() + _cols - 1) / _cols); /* Rows used by current buf. */
+    const std::size_t pos = columns(_line.c_str(), _pos); /* Cursor position in cells. */
+    int rows = static_cast<int>((_plen + columns(_line.c_str(), _line.size()) + _cols - 1) / _cols); /* Rows used by current buf. */
     int rpos = static_cast<int>((_plen + _old_pos + _cols) / _cols); /* Cursor relative row. */
     int rpos2; /* rpos after refresh. */
     int col; /* Column position, zero-based. */
@@ -742,7 +762,7 @@ void tim::p::line_edit::refresh_multi_line(refresh_flags flags)
          * emit a newline and move the prompt to the first column. */
         if (_pos
                 && _pos == _line.size()
-                && (_pos + _plen) % _cols == 0)
+                && (pos + _plen) % _cols == 0)
         {
             ws += L"\n\r";
             ++rows;
@@ -751,24 +771,24 @@ void tim::p::line_edit::refresh_multi_line(refresh_flags flags)
         }
 
         /* Move cursor to right position. */
-        rpos2 = static_cast<int>((_plen + _pos + _cols) / _cols); /* Current cursor relative row. */
+        rpos2 = static_cast<int>((_plen + pos + _cols) / _cols); /* Current cursor relative row. */
 
         /* Go up till we reach the expected position. */
         if (rows - rpos2 > 0)
             ws += tim::to_wstring(tim::sprintf("\x1b[%dA", rows - rpos2));
 
         /* Set column. */
-        col = (_plen + (int)_pos) % (int)_cols;
+        col = (_plen + (int)pos) % (int)_cols;
         if (col)
             ws += tim::to_wstring(tim::sprintf("\r\x1b[%dC", col));
         else
             ws += L'\r';
     }
 
-    _old_pos = _pos;
+    _old_pos = pos;
 
     const std::string s = tim::from_wstring(ws);
-    if (!_terminal->protocol()->write(s.c_str(), s.size()))
+    if (!_terminal->write(s.c_str(), s.size()))
     {
         /* Can't recover from write error. */
     }
@@ -804,7 +824,7 @@ bool tim::p::line_edit::edit_insert(std::int32_t c)
     ++_pos;
     if (_pos == _line.size()
             && !_ml_mode
-            && _plen + _line.size() < _cols
+            && _plen + columns(_line.c_str(), _line.size()) < _cols
             && !_hinter)
     {
         /* Avoid a full update of the line in the trivial case. */
@@ -813,7 +833,7 @@ bool tim::p::line_edit::edit_insert(std::int32_t c)
                             : c;
         std::string s(utf8codepointsize(d), 0);
         utf8catcodepoint((utf8_int8_t *)(&s[0]), d, s.size());
-        if (!_terminal->protocol()->write(s.c_str(), s.size()))
+        if (!_terminal->write(s.c_str(), s.size()))
             return false;
     }
     else
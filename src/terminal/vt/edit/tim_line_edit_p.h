@@ -65,6 +65,7 @@ struct line_edit
     void refresh_line_with_completion(const tim::line_edit::completions *c, refresh_flags flags);
     std::int32_t complete_line(std::int32_t key_pressed);
 
+    std::size_t columns(const wchar_t *s, std::size_t n) const;
     void refresh_show_hints(std::wstring &s);
     void refresh_single_line(refresh_flags flags);
     void refresh_multi_line(refresh_flags flags);
@@ -92,9 +93,9 @@ struct line_edit
     std::wstring _line; /* Edited line buffer. */
     static constexpr const std::size_t MAX_LINE_SIZE = 4096;
     std::wstring _prompt; /* Prompt to display. */
-    std::size_t _plen = 0; /* Prompt length. We calculate uncolorized prompt length here. */
+    std::size_t _plen = 0; /* Prompt width in cells. We calculate uncolorized prompt width here. */
     std::size_t _pos = 0; /* Current cursor position. */
-    std::size_t _old_pos = 0; /* Previous refresh cursor position. */
+    std::size_t _old_pos = 0; /* Previous refresh cursor position, in cells. */
     std::size_t _cols = 0; /* Number of columns in terminal. */
     std::size_t _old_rows = 0; /* Rows used by last refreshed line (multiline mode) */
 
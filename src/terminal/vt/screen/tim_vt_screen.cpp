@@ -0,0 +1,637 @@
+#include "tim_vt_screen.h"
+
+#include "tim_vt_screen_p.h"
+
+#include "tim_a_protocol.h"
+#include "tim_display_width.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+
+
+static const tim::vt_screen::cell BLANK_CELL;
+
+static constexpr std::size_t MAX_CSI_SIZE = 64; // Longer sequences are dropped.
+static constexpr std::size_t MAX_BRIDGE = 4; // Unchanged cells rewritten rather than moved over.
+
+static void append_number(std::string &s, std::size_t n)
+{
+    char buf[24];
+    const std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), n);
+    s.append(buf, res.ptr);
+}
+
+static void append_move(std::string &s, std::size_t n, char final)
+{
+    s += "\x1b[";
+    if (n != 1)
+        append_number(s, n);
+    s += final;
+}
+
+static void append_utf8(std::string &s, char32_t c)
+{
+    if (c < 0x80)
+        s += (char)c;
+    else if (c < 0x800)
+    {
+        s += (char)(0xC0 | (c >> 6));
+        s += (char)(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000)
+    {
+        s += (char)(0xE0 | (c >> 12));
+        s += (char)(0x80 | ((c >> 6) & 0x3F));
+        s += (char)(0x80 | (c & 0x3F));
+    }
+    else
+    {
+        s += (char)(0xF0 | (c >> 18));
+        s += (char)(0x80 | ((c >> 12) & 0x3F));
+        s += (char)(0x80 | ((c >> 6) & 0x3F));
+        s += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+
+// Public
+
+tim::vt_screen::vt_screen(tim::a_protocol *proto, std::size_t rows, std::size_t cols)
+    : _d(new tim::p::vt_screen(this))
+{
+    assert(proto);
+
+    _d->_proto = proto;
+    resize(rows, cols);
+}
+
+tim::vt_screen::~vt_screen() = default;
+
+std::size_t tim::vt_screen::rows() const
+{
+    return _d->_rows;
+}
+
+std::size_t tim::vt_screen::cols() const
+{
+    return _d->_cols;
+}
+
+/**
+ * Keeps the top left part of the grid. The terminal reflows its
+ * contents on resize in its own way, so the next flush redraws all.
+ */
+void tim::vt_screen::resize(std::size_t rows, std::size_t cols)
+{
+    assert(rows > 0);
+    assert(cols > 0);
+
+    if (rows == _d->_rows
+            && cols == _d->_cols)
+        return;
+
+    std::vector<tim::vt_screen::cell> back(rows * cols);
+    for (std::size_t r = 0; r < std::min(rows, _d->_rows); ++r)
+        std::copy_n(_d->_back.begin() + r * _d->_cols,
+                    std::min(cols, _d->_cols),
+                    back.begin() + r * cols);
+
+    _d->_back.swap(back);
+    _d->_front.assign(rows * cols, BLANK_CELL);
+    _d->_rows = rows;
+    _d->_cols = cols;
+    _d->_row = std::min(_d->_row, rows - 1);
+    _d->_col = std::min(_d->_col, cols);
+
+    invalidate();
+}
+
+std::size_t tim::vt_screen::row() const
+{
+    return _d->_row;
+}
+
+std::size_t tim::vt_screen::col() const
+{
+    return _d->_col;
+}
+
+void tim::vt_screen::move(std::size_t row, std::size_t col)
+{
+    _d->_row = std::min(row, _d->_rows - 1);
+    _d->_col = std::min(col, _d->_cols - 1);
+}
+
+const tim::vt_style &tim::vt_screen::style() const
+{
+    return _d->_style;
+}
+
+void tim::vt_screen::set_style(const tim::vt_style &style)
+{
+    _d->_style = style;
+}
+
+void tim::vt_screen::set_color_encoder(tim::vt_color_encoder encoder)
+{
+    _d->_encoder = encoder;
+}
+
+void tim::vt_screen::write(const char *data, std::size_t size)
+{
+    assert(data || !size);
+
+    for (const char *const end = data + size; data < end; ++data)
+    {
+        const unsigned char c = (unsigned char)*data;
+
+        switch (_d->_state)
+        {
+            case tim::p::vt_screen::parse_state::Esc:
+                if (c == '[')
+                {
+                    _d->_state = tim::p::vt_screen::parse_state::Csi;
+                    _d->_params.clear();
+                }
+                else
+                    _d->_state = tim::p::vt_screen::parse_state::Text;
+                continue;
+
+            case tim::p::vt_screen::parse_state::Csi:
+                if (c >= 0x40
+                        && c <= 0x7E)
+                {
+                    _d->_state = tim::p::vt_screen::parse_state::Text;
+                    if (_d->_params.size() <= MAX_CSI_SIZE)
+                        _d->csi((char)c);
+                }
+                else if (_d->_params.size() <= MAX_CSI_SIZE)
+                    _d->_params += (char)c;
+                continue;
+
+            case tim::p::vt_screen::parse_state::Text:
+                break;
+        }
+
+        if (_d->_glyph_bytes)
+        {
+            if ((c & 0xC0) == 0x80)
+            {
+                _d->_glyph = (_d->_glyph << 6) | (c & 0x3F);
+                if (!--_d->_glyph_bytes)
+                    _d->put(_d->_glyph);
+                continue;
+            }
+
+            _d->_glyph_bytes = 0;
+            _d->put(U'\uFFFD');
+        }
+
+        if (c >= 0x80)
+        {
+            if ((c & 0xE0) == 0xC0)
+            {
+                _d->_glyph = c & 0x1F;
+                _d->_glyph_bytes = 1;
+            }
+            else if ((c & 0xF0) == 0xE0)
+            {
+                _d->_glyph = c & 0x0F;
+                _d->_glyph_bytes = 2;
+            }
+            else if ((c & 0xF8) == 0xF0)
+            {
+                _d->_glyph = c & 0x07;
+                _d->_glyph_bytes = 3;
+            }
+            else
+                _d->put(U'\uFFFD');
+            continue;
+        }
+
+        switch (c)
+        {
+            case '\x1b':
+                _d->_state = tim::p::vt_screen::parse_state::Esc;
+                break;
+
+            case '\r':
+                _d->_col = 0;
+                break;
+
+            case '\n':
+                _d->new_line();
+                break;
+
+            case '\b':
+                if (_d->_col)
+                    --_d->_col;
+                break;
+
+            case '\t':
+                _d->_col = std::min((_d->_col / 8 + 1) * 8, _d->_cols - 1);
+                break;
+
+            default:
+                if (c >= 0x20
+                        && c < 0x7F)
+                    _d->put(c);
+                break;
+        }
+    }
+}
+
+void tim::vt_screen::clear()
+{
+    std::fill(_d->_back.begin(), _d->_back.end(), BLANK_CELL);
+    _d->_row = 0;
+    _d->_col = 0;
+    _d->_clear = true;
+}
+
+/**
+ * Erases the line from the cursor to the end, with the current
+ * background color.
+ */
+void tim::vt_screen::clear_line()
+{
+    if (_d->_col >= _d->_cols)
+        return;
+
+    tim::vt_screen::cell blank;
+    blank.style.bg = _d->_style.bg;
+
+    std::fill(_d->_back.begin() + _d->_row * _d->_cols + _d->_col,
+              _d->_back.begin() + (_d->_row + 1) * _d->_cols,
+              blank);
+}
+
+const tim::vt_screen::cell &tim::vt_screen::at(std::size_t row, std::size_t col) const
+{
+    assert(row < _d->_rows);
+    assert(col < _d->_cols);
+
+    return _d->_back[row * _d->_cols + col];
+}
+
+/**
+ * Forgets what the terminal shows, the next flush redraws all.
+ */
+void tim::vt_screen::invalidate()
+{
+    _d->_clear = true;
+    _d->_term_row = tim::p::vt_screen::NO_POS;
+    _d->_term_col = tim::p::vt_screen::NO_POS;
+}
+
+bool tim::vt_screen::flush()
+{
+    std::string &out = _d->_out;
+    out.clear();
+
+    if (_d->_clear)
+    {
+        // The terminal state is not known, so the colors are reset too.
+        out += "\x1b[0m\x1b[H\x1b[2J";
+        std::fill(_d->_front.begin(), _d->_front.end(), BLANK_CELL);
+        _d->_term_row = 0;
+        _d->_term_col = 0;
+        _d->_term_style = tim::vt_style{};
+        _d->_scrolled = 0;
+        _d->_clear = false;
+    }
+    else if (_d->_scrolled)
+        _d->scroll();
+
+    for (std::size_t r = 0; r < _d->_rows; ++r)
+        _d->draw_row(r);
+
+    _d->move_cursor(_d->_row, std::min(_d->_col, _d->_cols - 1));
+
+    // Whatever is written around the screen starts with the defaults.
+    tim::vt_style::append_sgr(out, _d->_term_style, tim::vt_style{}, _d->_encoder);
+    _d->_term_style = tim::vt_style{};
+
+    if (out.empty())
+        return true;
+
+    _d->_bytes += out.size();
+
+    return _d->_proto->write(out.data(), out.size());
+}
+
+std::size_t tim::vt_screen::bytes_written() const
+{
+    return _d->_bytes;
+}
+
+bool tim::vt_screen::cell::operator==(const cell &other) const
+{
+    return glyph == other.glyph
+                && mark == other.mark
+                && style == other.style;
+}
+
+bool tim::vt_screen::cell::operator!=(const cell &other) const
+{
+    return !(*this == other);
+}
+
+
+// Private
+
+void tim::p::vt_screen::put(char32_t glyph)
+{
+    const std::size_t width = tim::char_width(glyph);
+    if (!width)
+    {
+        // Drawn by the terminal over the glyph before.
+        if (_col)
+        {
+            tim::vt_screen::cell *cell = &_back[_row * _cols + _col - 1];
+            if (!cell->glyph
+                    && _col > 1)
+                --cell;
+            cell->mark = glyph;
+        }
+        return;
+    }
+
+    // Wraps like the terminal does, on the glyph after the last column,
+    // or when a wide glyph does not fit in it.
+    if (_col + width > _cols)
+        new_line();
+    if (width > _cols)
+        return;
+
+    // A wide glyph overwritten in part is erased by the terminal.
+    tim::vt_screen::cell *const row = &_back[_row * _cols];
+    if (!row[_col].glyph
+            && _col)
+    {
+        row[_col - 1].glyph = U' ';
+        row[_col - 1].mark = 0;
+    }
+    if (_col + width < _cols
+            && !row[_col + width].glyph)
+        row[_col + width].glyph = U' ';
+
+    row[_col].glyph = glyph;
+    row[_col].mark = 0;
+    row[_col].style = _style;
+    if (width == 2)
+    {
+        row[_col + 1].glyph = 0;
+        row[_col + 1].mark = 0;
+        row[_col + 1].style = _style;
+    }
+
+    _col += width;
+}
+
+void tim::p::vt_screen::new_line()
+{
+    _col = 0;
+    if (_row + 1 < _rows)
+    {
+        ++_row;
+        return;
+    }
+
+    std::move(_back.begin() + _cols, _back.end(), _back.begin());
+    std::fill(_back.end() - _cols, _back.end(), BLANK_CELL);
+    ++_scrolled;
+}
+
+void tim::p::vt_screen::csi(char final)
+{
+    switch (final)
+    {
+        case 'm':
+            tim::vt_style::apply_sgr(_style, _params.data(), _params.size());
+            break;
+
+        case 'H':
+        {
+            // CUP: "row;col", both 1-based and optional.
+            const std::size_t sep = _params.find(';');
+            const std::size_t row = std::strtoul(_params.c_str(), nullptr, 10);
+            const std::size_t col = sep == std::string::npos
+                                        ? 0
+                                        : std::strtoul(_params.c_str() + sep + 1, nullptr, 10);
+            _q->move(row ? row - 1 : 0, col ? col - 1 : 0);
+            break;
+        }
+
+        case 'A':
+        case 'B':
+        case 'C':
+        case 'D':
+        {
+            // Cursor moves by the count, 1 if omitted.
+            const std::size_t n = std::max(1UL, std::strtoul(_params.c_str(), nullptr, 10));
+            const std::size_t col = std::min(_col, _cols - 1);
+            switch (final)
+            {
+                case 'A':
+                    _q->move(_row - std::min(n, _row), col);
+                    break;
+
+                case 'B':
+                    _q->move(_row + n, col);
+                    break;
+
+                case 'C':
+                    _q->move(_row, col + n);
+                    break;
+
+                default:
+                    _q->move(_row, col - std::min(n, col));
+                    break;
+            }
+            break;
+        }
+
+        case 'J':
+            if (_params == "2")
+                _q->clear();
+            break;
+
+        case 'K':
+            if (_params.empty()
+                    || _params == "0")
+                _q->clear_line();
+            break;
+
+        default:
+            break;
+    }
+}
+
+void tim::p::vt_screen::draw_row(std::size_t row)
+{
+    const tim::vt_screen::cell *const back = &_back[row * _cols];
+    tim::vt_screen::cell *const front = &_front[row * _cols];
+
+    std::size_t first = 0;
+    while (first < _cols
+                && back[first] == front[first])
+        ++first;
+    if (first == _cols)
+        return;
+
+    std::size_t last = _cols;
+    while (back[last - 1] == front[last - 1])
+        --last;
+
+    // Blanks at the end of the row are erased at once.
+    std::size_t tail = _cols;
+    while (tail > first
+                && back[tail - 1] == BLANK_CELL)
+        --tail;
+    const bool erase = last > tail;
+    const std::size_t end = erase
+                                ? tail
+                                : last;
+
+    for (std::size_t c = first; c < end; ++c)
+    {
+        if (back[c] == front[c])
+            continue;
+
+        // The right half of a wide glyph is drawn with the left one.
+        if (!back[c].glyph
+                && c)
+            --c;
+
+        // A few unchanged cells are cheaper to rewrite than to move over.
+        bool bridge = _term_row == row
+                            && _term_col < c
+                            && c - _term_col <= MAX_BRIDGE;
+        for (std::size_t i = _term_col; bridge && i < c; ++i)
+            bridge = back[i].style == _term_style
+                        && back[i].glyph >= 0x20
+                        && back[i].glyph < 0x80
+                        && !back[i].mark;
+
+        if (bridge)
+            for (std::size_t i = _term_col; i < c; ++i)
+                _out += (char)back[i].glyph;
+        else
+            move_cursor(row, c);
+
+        tim::vt_style::append_sgr(_out, _term_style, back[c].style, _encoder);
+        _term_style = back[c].style;
+        append_utf8(_out, back[c].glyph);
+        if (back[c].mark)
+            append_utf8(_out, back[c].mark);
+        front[c] = back[c];
+
+        const std::size_t width = c + 1 < _cols
+                                        && !back[c + 1].glyph
+                                      ? 2
+                                      : 1;
+        if (width == 2)
+            front[c + 1] = back[c + 1];
+
+        // The cursor stays in the last column waiting to wrap,
+        // terminals disagree on where it goes from there.
+        if (c + width < _cols)
+            _term_col = c + width;
+        else
+        {
+            _term_row = NO_POS;
+            _term_col = NO_POS;
+        }
+
+        c += width - 1;
+    }
+
+    if (erase)
+    {
+        move_cursor(row, tail);
+        tim::vt_style::append_sgr(_out, _term_style, tim::vt_style{}, _encoder);
+        _term_style = tim::vt_style{};
+        _out += "\x1b[K";
+        std::fill(front + tail, front + _cols, BLANK_CELL);
+    }
+}
+
+/**
+ * Picks the shortest of the absolute and relative moves.
+ */
+void tim::p::vt_screen::move_cursor(std::size_t row, std::size_t col)
+{
+    if (row == _term_row
+            && col == _term_col)
+        return;
+
+    std::string abs = "\x1b[";
+    if (row
+            || col)
+        append_number(abs, row + 1);
+    if (col)
+    {
+        abs += ';';
+        append_number(abs, col + 1);
+    }
+    abs += 'H';
+
+    if (_term_row == NO_POS)
+    {
+        _out += abs;
+        _term_row = row;
+        _term_col = col;
+        return;
+    }
+
+    std::string rel;
+    if (row < _term_row)
+        append_move(rel, _term_row - row, 'A');
+    else if (row > _term_row)
+        append_move(rel, row - _term_row, 'B');
+
+    if (col == 0)
+    {
+        if (_term_col)
+            rel += '\r';
+    }
+    else if (col > _term_col)
+        append_move(rel, col - _term_col, 'C');
+    else if (col < _term_col)
+    {
+        std::string back;
+        append_move(back, _term_col - col, 'D');
+        std::string forward = "\r";
+        append_move(forward, col, 'C');
+        rel += back.size() <= forward.size()
+                    ? back
+                    : forward;
+    }
+
+    _out += rel.size() < abs.size()
+                ? rel
+                : abs;
+    _term_row = row;
+    _term_col = col;
+}
+
+/**
+ * Scrolls the terminal the same lines as the grid has, so that only
+ * the new lines are drawn.
+ */
+void tim::p::vt_screen::scroll()
+{
+    const std::size_t lines = std::min(_scrolled, _rows);
+    _scrolled = 0;
+
+    // The terminal fills the new lines with the current background.
+    tim::vt_style::append_sgr(_out, _term_style, tim::vt_style{}, _encoder);
+    _term_style = tim::vt_style{};
+    move_cursor(_rows - 1, 0);
+    _out.append(lines, '\n');
+
+    std::move(_front.begin() + lines * _cols, _front.end(), _front.begin());
+    std::fill(_front.end() - lines * _cols, _front.end(), BLANK_CELL);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "tim_vt_style.h"
+
+#include <cstddef>
+#include <memory>
+
+
+namespace tim
+{
+
+class a_protocol;
+
+namespace p
+{
+
+struct vt_screen;
+
+}
+
+/**
+ * Model of the terminal screen, a grid of cells.
+ *
+ * Drawing changes the grid only. flush() compares it to what the
+ * terminal is known to show and sends the changed cells with the
+ * shortest cursor moves and SGR transitions, like curses does.
+ * Text may contain CR, LF, BS, TAB, SGR, cursor moves and erases,
+ * other escape sequences are dropped. Wide glyphs take two cells,
+ * combining marks go with the glyph before them.
+ */
+class vt_screen
+{
+
+public:
+
+    struct cell
+    {
+        char32_t glyph = U' '; // 0 for the right half of a wide glyph.
+        char32_t mark = 0; // Combining mark or variation selector drawn over the glyph.
+        tim::vt_style style;
+
+        bool operator==(const cell &other) const;
+        bool operator!=(const cell &other) const;
+    };
+
+    vt_screen(tim::a_protocol *proto, std::size_t rows, std::size_t cols);
+    ~vt_screen();
+
+    std::size_t rows() const;
+    std::size_t cols() const;
+    void resize(std::size_t rows, std::size_t cols);
+
+    std::size_t row() const;
+    std::size_t col() const;
+    void move(std::size_t row, std::size_t col);
+
+    const tim::vt_style &style() const;
+    void set_style(const tim::vt_style &style);
+    void set_color_encoder(tim::vt_color_encoder encoder);
+
+    void write(const char *data, std::size_t size);
+    void clear();
+    void clear_line();
+    const cell &at(std::size_t row, std::size_t col) const;
+
+    void invalidate();
+    bool flush();
+
+    std::size_t bytes_written() const;
+
+private:
+
+    std::unique_ptr<tim::p::vt_screen> _d;
+};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "tim_vt_screen.h"
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+
+namespace tim::p
+{
+
+struct vt_screen
+{
+    explicit vt_screen(tim::vt_screen *q)
+        : _q(q)
+    {
+        assert(_q);
+    }
+
+    static constexpr std::size_t NO_POS = (std::size_t)-1;
+
+    enum class parse_state
+    {
+        Text,
+        Esc,
+        Csi
+    };
+
+    void put(char32_t glyph);
+    void new_line();
+    void csi(char final);
+
+    void draw_row(std::size_t row);
+    void move_cursor(std::size_t row, std::size_t col);
+    void scroll();
+
+    tim::vt_screen *const _q;
+
+    tim::a_protocol *_proto = nullptr;
+    tim::vt_color_encoder _encoder = tim::vt_style::encoder(tim::color_depth::TrueColor);
+    std::size_t _rows = 0;
+    std::size_t _cols = 0;
+
+    // Drawing side.
+    std::vector<tim::vt_screen::cell> _back;
+    std::size_t _row = 0;
+    std::size_t _col = 0;
+    tim::vt_style _style;
+    std::size_t _scrolled = 0; // Lines scrolled off the top since the last flush.
+
+    parse_state _state = parse_state::Text;
+    std::string _params; // Of the CSI sequence being parsed.
+    char32_t _glyph = 0; // UTF-8 sequence being decoded,
+    int _glyph_bytes = 0; // and the bytes it still needs.
+
+    // Terminal side.
+    std::vector<tim::vt_screen::cell> _front;
+    std::size_t _term_row = NO_POS; // Unknown after a write to the last column.
+    std::size_t _term_col = NO_POS;
+    tim::vt_style _term_style;
+    bool _clear = true; // The terminal shows something else, start with a clear.
+
+    std::string _out;
+    std::size_t _bytes = 0;
+};
+
+}
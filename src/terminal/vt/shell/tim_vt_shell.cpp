@@ -35,7 +35,7 @@ tim::vt_shell::vt_shell(tim::vt *term, tim::a_script_engine *engine)
                                               term->theme().colors.at(tim::terminal_color_index::Prompt)));
     _d->_ledit->history_load(_d->_history_path);
 
-    term->protocol()->write_str(tim::p::vt_shell::welcome_banner());
+    term->write_str(tim::p::vt_shell::welcome_banner());
 
     _d->_ledit->new_line();
 }
@@ -52,6 +52,21 @@ void tim::vt_shell::new_line()
     _d->_ledit->new_line();
 }
 
+/**
+ * Hides the line being edited, to write something else there.
+ *
+ * \sa show()
+ */
+void tim::vt_shell::hide()
+{
+    _d->_ledit->hide();
+}
+
+void tim::vt_shell::show()
+{
+    _d->_ledit->show();
+}
+
 bool tim::vt_shell::write(const char *data, std::size_t size)
 {
     assert(data);
@@ -66,7 +81,7 @@ bool tim::vt_shell::write(const char *data, std::size_t size)
         {
             if (!_d->_ledit->empty())
             {
-                _d->_ledit->terminal()->protocol()->write("\n", 1);
+                _d->_ledit->terminal()->write("\n", 1);
                 const std::string &line = _d->_ledit->line();
                 _d->_ledit->history_save(_d->_history_path);
                 std::string command;
@@ -77,7 +92,7 @@ bool tim::vt_shell::write(const char *data, std::size_t size)
                     if (_d->_engine->eval(command, &res))
                     {
                         if (!res.empty())
-                            _d->_ledit->terminal()->protocol()->write(res.c_str(), res.size());
+                            _d->_ledit->terminal()->write(res.c_str(), res.size());
                     }
                     else
                     {
@@ -94,11 +109,11 @@ bool tim::vt_shell::write(const char *data, std::size_t size)
                         {
                             static const char hr[] = "─";
                             for (std::size_t i = 0; i < pos - 1; ++i)
-                                _d->_ledit->terminal()->protocol()->write(hr, sizeof(hr) - 1);
+                                _d->_ledit->terminal()->write(hr, sizeof(hr) - 1);
                         }
                         {
                             static const char arrow[] = "^";
-                            _d->_ledit->terminal()->protocol()->write(arrow, sizeof(arrow) - 1);
+                            _d->_ledit->terminal()->write(arrow, sizeof(arrow) - 1);
                         }
                         _d->_ledit->terminal()->reset_colors();
                     }
@@ -112,7 +127,7 @@ bool tim::vt_shell::write(const char *data, std::size_t size)
             break;
 
         case tim::line_edit::status::Exit:
-            _d->_ledit->terminal()->protocol()->write_str(tim::p::vt_shell::bye_banner());
+            _d->_ledit->terminal()->write_str(tim::p::vt_shell::bye_banner());
             return false;
 
         case tim::line_edit::status::Break:
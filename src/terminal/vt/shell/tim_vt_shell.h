@@ -28,6 +28,8 @@ public:
     tim::vt *terminal() const;
 
     void new_line();
+    void hide();
+    void show();
     bool write(const char *data, std::size_t size);
 
 protected:
@@ -3,285 +3,15 @@
 #include "tim_vt_p.h"
 
 #include "tim_a_terminal_protocol.h"
+#include "tim_display_width.h"
+#include "tim_signal_connection.h"
 #include "tim_string_tools.h"
 #include "tim_trace.h"
-
-#include "utf8/utf8.h"
+#include "tim_vt_palette.h"
+#include "tim_vt_screen.h"
 
 #include <cassert>
-
-
-namespace tim
-{
-
-// See <https://gist.github.com/MicahElliott/719710>.
-static const tim::color VT_PALETTE256[] =
-{
-    "#000000",
-    "#800000",
-    "#008000",
-    "#808000",
-    "#000080",
-    "#800080",
-    "#008080",
-    "#C0C0C0",
-
-    // Equivalent "bright" versions of original 8 colors.
-    "#808080",
-    "#FF0000",
-    "#00FF00",
-    "#FFFF00",
-    "#0000FF",
-    "#FF00FF",
-    "#00FFFF",
-    "#FFFFFF",
-
-    // Strictly ascending.
-    "#000000",
-    "#00005F",
-    "#000087",
-    "#0000AF",
-    "#0000D7",
-    "#0000FF",
-    "#005F00",
-    "#005F5F",
-    "#005F87",
-    "#005FAF",
-    "#005FD7",
-    "#005FFF",
-    "#008700",
-    "#00875F",
-    "#008787",
-    "#0087AF",
-    "#0087D7",
-    "#0087FF",
-    "#00AF00",
-    "#00AF5F",
-    "#00AF87",
-    "#00AFAF",
-    "#00AFD7",
-    "#00AFFF",
-    "#00D700",
-    "#00D75F",
-    "#00D787",
-    "#00D7AF",
-    "#00D7D7",
-    "#00D7FF",
-    "#00FF00",
-    "#00FF5F",
-    "#00FF87",
-    "#00FFAF",
-    "#00FFD7",
-    "#00FFFF",
-    "#5F0000",
-    "#5F005F",
-    "#5F0087",
-    "#5F00AF",
-    "#5F00D7",
-    "#5F00FF",
-    "#5F5F00",
-    "#5F5F5F",
-    "#5F5F87",
-    "#5F5FAF",
-    "#5F5FD7",
-    "#5F5FFF",
-    "#5F8700",
-    "#5F875F",
-    "#5F8787",
-    "#5F87AF",
-    "#5F87D7",
-    "#5F87FF",
-    "#5FAF00",
-    "#5FAF5F",
-    "#5FAF87",
-    "#5FAFAF",
-    "#5FAFD7",
-    "#5FAFFF",
-    "#5FD700",
-    "#5FD75F",
-    "#5FD787",
-    "#5FD7AF",
-    "#5FD7D7",
-    "#5FD7FF",
-    "#5FFF00",
-    "#5FFF5F",
-    "#5FFF87",
-    "#5FFFAF",
-    "#5FFFD7",
-    "#5FFFFF",
-    "#870000",
-    "#87005F",
-    "#870087",
-    "#8700AF",
-    "#8700D7",
-    "#8700FF",
-    "#875F00",
-    "#875F5F",
-    "#875F87",
-    "#875FAF",
-    "#875FD7",
-    "#875FFF",
-    "#878700",
-    "#87875F",
-    "#878787",
-    "#8787AF",
-    "#8787D7",
-    "#8787FF",
-    "#87AF00",
-    "#87AF5F",
-    "#87AF87",
-    "#87AFAF",
-    "#87AFD7",
-    "#87AFFF",
-    "#87D700",
-    "#87D75F",
-    "#87D787",
-    "#87D7AF",
-    "#87D7D7",
-    "#87D7FF",
-    "#87FF00",
-    "#87FF5F",
-    "#87FF87",
-    "#87FFAF",
-    "#87FFD7",
-    "#87FFFF",
-    "#AF0000",
-    "#AF005F",
-    "#AF0087",
-    "#AF00AF",
-    "#AF00D7",
-    "#AF00FF",
-    "#AF5F00",
-    "#AF5F5F",
-    "#AF5F87",
-    "#AF5FAF",
-    "#AF5FD7",
-    "#AF5FFF",
-    "#AF8700",
-    "#AF875F",
-    "#AF8787",
-    "#AF87AF",
-    "#AF87D7",
-    "#AF87FF",
-    "#AFAF00",
-    "#AFAF5F",
-    "#AFAF87",
-    "#AFAFAF",
-    "#AFAFD7",
-    "#AFAFFF",
-    "#AFD700",
-    "#AFD75F",
-    "#AFD787",
-    "#AFD7AF",
-    "#AFD7D7",
-    "#AFD7FF",
-    "#AFFF00",
-    "#AFFF5F",
-    "#AFFF87",
-    "#AFFFAF",
-    "#AFFFD7",
-    "#AFFFFF",
-    "#D70000",
-    "#D7005F",
-    "#D70087",
-    "#D700AF",
-    "#D700D7",
-    "#D700FF",
-    "#D75F00",
-    "#D75F5F",
-    "#D75F87",
-    "#D75FAF",
-    "#D75FD7",
-    "#D75FFF",
-    "#D78700",
-    "#D7875F",
-    "#D78787",
-    "#D787AF",
-    "#D787D7",
-    "#D787FF",
-    "#D7AF00",
-    "#D7AF5F",
-    "#D7AF87",
-    "#D7AFAF",
-    "#D7AFD7",
-    "#D7AFFF",
-    "#D7D700",
-    "#D7D75F",
-    "#D7D787",
-    "#D7D7AF",
-    "#D7D7D7",
-    "#D7D7FF",
-    "#D7FF00",
-    "#D7FF5F",
-    "#D7FF87",
-    "#D7FFAF",
-    "#D7FFD7",
-    "#D7FFFF",
-    "#FF0000",
-    "#FF005F",
-    "#FF0087",
-    "#FF00AF",
-    "#FF00D7",
-    "#FF00FF",
-    "#FF5F00",
-    "#FF5F5F",
-    "#FF5F87",
-    "#FF5FAF",
-    "#FF5FD7",
-    "#FF5FFF",
-    "#FF8700",
-    "#FF875F",
-    "#FF8787",
-    "#FF87AF",
-    "#FF87D7",
-    "#FF87FF",
-    "#FFAF00",
-    "#FFAF5F",
-    "#FFAF87",
-    "#FFAFAF",
-    "#FFAFD7",
-    "#FFAFFF",
-    "#FFD700",
-    "#FFD75F",
-    "#FFD787",
-    "#FFD7AF",
-    "#FFD7D7",
-    "#FFD7FF",
-    "#FFFF00",
-    "#FFFF5F",
-    "#FFFF87",
-    "#FFFFAF",
-    "#FFFFD7",
-    "#FFFFFF",
-
-    // Gray-scale range.
-    "#080808",
-    "#121212",
-    "#1C1C1C",
-    "#262626",
-    "#303030",
-    "#3A3A3A",
-    "#444444",
-    "#4E4E4E",
-    "#585858",
-    "#626262",
-    "#6C6C6C",
-    "#767676",
-    "#808080",
-    "#8A8A8A",
-    "#949494",
-    "#9E9E9E",
-    "#A8A8A8",
-    "#B2B2B2",
-    "#BCBCBC",
-    "#C6C6C6",
-    "#D0D0D0",
-    "#DADADA",
-    "#E4E4E4",
-    "#EEEEEE"
-};
-
-}
+#include <cstring>
 
 
 // Public
@@ -291,10 +21,18 @@ tim::vt::vt(tim::a_terminal_protocol *proto)
     , _d(new tim::p::vt(this))
 {
     _d->_term_proto = proto;
+    _d->_term_name_changed.reset(new tim::signal_connection(proto->terminal_name_changed.connect(
+        std::bind(&tim::p::vt::on_terminal_name_changed, _d.get(), std::placeholders::_1))));
+    _d->on_terminal_name_changed(proto->terminal_name());
 }
 
 tim::vt::~vt() = default;
 
+const tim::terminal_caps &tim::vt::caps() const
+{
+    return _d->_caps;
+}
+
 std::size_t tim::vt::rows() const
 {
     return std::max(10UL, _d->_term_proto->rows());
@@ -307,13 +45,21 @@ std::size_t tim::vt::cols() const
 
 void tim::vt::clear()
 {
+    // The screen is drawn again after a clear, at the current size.
+    if (_d->_screen)
+    {
+        _d->_screen->resize(rows(), cols());
+        _d->_screen->clear();
+        return;
+    }
+
     static const char cmd[] = "\x1b[H\x1b[2J";
-    protocol()->write(cmd, sizeof(cmd) - 1);
+    write(cmd, sizeof(cmd) - 1);
 }
 
 std::size_t tim::vt::color_count() const
 {
-    return sizeof(tim::VT_PALETTE256) / sizeof(tim::VT_PALETTE256[0]);
+    return tim::VT_PALETTE_SIZE;
 }
 
 tim::color tim::vt::color(std::size_t index) const
@@ -326,8 +72,12 @@ tim::color tim::vt::color(std::size_t index) const
  */
 void tim::vt::set_color(const tim::color &c)
 {
-    if (!c.empty())
-        tim::vt::printf("\x1b[38;2;%u;%u;%um", c.r, c.g, c.b);
+    if (c.empty())
+        return;
+
+    tim::vt_style style = _d->style();
+    style.fg = c;
+    _d->set_style(style);
 }
 
 void tim::vt::set_color(std::size_t index)
@@ -337,13 +87,19 @@ void tim::vt::set_color(std::size_t index)
 
 void tim::vt::set_default_color()
 {
-    protocol()->write("\x1b[39m", 5);
+    tim::vt_style style = _d->style();
+    style.fg.clear();
+    _d->set_style(style);
 }
 
 void tim::vt::set_bg_color(const tim::color &c)
 {
-    if (!c.empty())
-        tim::vt::printf("\x1b[48;2;%u;%u;%um", c.r, c.g, c.b);
+    if (c.empty())
+        return;
+
+    tim::vt_style style = _d->style();
+    style.bg = c;
+    _d->set_style(style);
 }
 
 void tim::vt::set_bg_color(std::size_t index)
@@ -353,7 +109,9 @@ void tim::vt::set_bg_color(std::size_t index)
 
 void tim::vt::reverse_colors()
 {
-    protocol()->write("\x1b[7m", 4);
+    tim::vt_style style = _d->style();
+    style.attrs.set(tim::vt_attribute::Reverse);
+    _d->set_style(style);
 }
 
 /**
@@ -361,8 +119,144 @@ void tim::vt::reverse_colors()
  */
 void tim::vt::reset_colors()
 {
-    static const char cmd[] = "\x1b[0m";
-    protocol()->write(cmd, sizeof(cmd) - 1);
+    _d->set_style(tim::vt_style{});
+}
+
+/**
+ * The colors set since the last write go out with the text as one
+ * SGR sequence holding only what changed. The SGR sequences in the
+ * text itself are followed, so the next change starts from them.
+ */
+bool tim::vt::write(const char *data, std::size_t size)
+{
+    if (_d->_screen)
+    {
+        _d->_screen->write(data, size);
+        return true;
+    }
+
+    if (!size)
+        return true;
+
+    if (!std::memchr(data, '\x1b', size))
+    {
+        if (_d->_style == _d->_term_style)
+            return protocol()->write(data, size);
+
+        _d->_out.clear();
+        tim::vt_style::append_sgr(_d->_out, _d->_term_style, _d->_style, _d->_encoder);
+        _d->_out.append(data, size);
+        _d->_term_style = _d->_style;
+    }
+    else
+    {
+        // The colors in the text are encoded for the terminal too.
+        _d->_out.clear();
+        tim::vt_style::translate(_d->_out, _d->_term_style, _d->_style, data, size, _d->_encoder);
+    }
+
+    return _d->_out.empty()
+                ? true
+                : protocol()->write(_d->_out.data(), _d->_out.size());
+}
+
+/**
+ * Writes \a data with the SGR sequences already encoded for this
+ * terminal and the default style back at the end, like the bubbles of
+ * tim::bubble_cache. It goes out as is, the colors set before are left
+ * for the next write.
+ */
+bool tim::vt::write_encoded(const char *data, std::size_t size)
+{
+    if (_d->_screen)
+    {
+        const tim::vt_style style = _d->_screen->style();
+        _d->_screen->write(data, size);
+        _d->_screen->set_style(style);
+        return true;
+    }
+
+    if (!size)
+        return true;
+
+    if (!_d->_term_style.is_default())
+    {
+        _d->_out.clear();
+        tim::vt_style::append_sgr(_d->_out, _d->_term_style, tim::vt_style{}, _d->_encoder);
+        _d->_term_style = tim::vt_style{};
+        if (!_d->_out.empty()
+                && !protocol()->write(_d->_out.data(), _d->_out.size()))
+            return false;
+    }
+
+    return protocol()->write(data, size);
+}
+
+/**
+ * With the screen model enabled, the drawing goes to a grid of cells
+ * and reaches the terminal on flush() as the difference from what it
+ * already shows. The first flush redraws the whole screen.
+ */
+void tim::vt::set_screen_enabled(bool enable)
+{
+    if (enable == (bool)_d->_screen)
+        return;
+
+    if (enable)
+    {
+        _d->_screen.reset(new tim::vt_screen(protocol(), rows(), cols()));
+        _d->_screen->set_color_encoder(_d->_encoder);
+        _d->_term_style = tim::vt_style{};
+    }
+    else
+    {
+        flush();
+        _d->_screen.reset();
+    }
+
+    _d->_style = tim::vt_style{};
+}
+
+tim::vt_screen *tim::vt::screen() const
+{
+    return _d->_screen.get();
+}
+
+/**
+ * Starts an update the terminal shows at once on end_update(), without
+ * the intermediate states, if it supports synchronized output. Writes
+ * nothing otherwise, nor with the screen model, as flush() sends the
+ * whole difference at once.
+ */
+bool tim::vt::begin_update()
+{
+    if (!_d->_caps.synchronized_output
+            || _d->_screen)
+        return true;
+
+    static const char cmd[] = "\x1b[?2026h";
+    return protocol()->write(cmd, sizeof(cmd) - 1);
+}
+
+bool tim::vt::end_update()
+{
+    if (!_d->_caps.synchronized_output
+            || _d->_screen)
+        return true;
+
+    static const char cmd[] = "\x1b[?2026l";
+    return protocol()->write(cmd, sizeof(cmd) - 1);
+}
+
+bool tim::vt::flush()
+{
+    if (!_d->_screen)
+        return true;
+
+    // NAWS may have changed the size since the last flush.
+    _d->_screen->resize(rows(), cols());
+
+    return _d->_screen->flush();
 }
 
 std::string tim::vt::colorized(const std::string &s,
@@ -387,83 +281,35 @@ std::string tim::vt::colorized(const std::string &s,
 }
 
 /** \param s Colorized string.
- *  \return Number of glyphs in string \a s.
+ *  \return Number of terminal cells string \a s takes.
  */
-std::size_t tim::vt::strlen(const std::string &s)
+std::size_t tim::vt::strlen(std::string_view s)
 {
-    if (s.empty())
-        return 0;
-
-    /* ANSI color control sequences have the form:
-     * "\x1b" "[" [0-9;]+ "m"
-     * We parse them with a simple state machine.
-     */
+    return tim::display_width(s);
+}
 
-    enum class state
-    {
-        SearchEsc,
-        ExpectBracket,
-        ExpectInner,
-        ExpectTrail
-    };
 
-    state st = state::SearchEsc;
+// Private
 
-    std::size_t len = 0;
-    std::size_t found = 0;
+void tim::p::vt::on_terminal_name_changed(const std::string &name)
+{
+    _caps = tim::terminal_caps::find(name);
+    _encoder = tim::vt_style::encoder(_caps.colors);
+    if (_screen)
+        _screen->set_color_encoder(_encoder);
+}
 
-    const std::size_t size = s.size();
-    for (std::size_t i = 0; i < size; ++i)
-    {
-        const char c = s[i];
-
-        switch (st)
-        {
-            case state::SearchEsc:
-                len = 0;
-                if (c == '\x1b')
-                {
-                    st = state::ExpectBracket;
-                    ++len;
-                }
-                break;
-
-            case state::ExpectBracket:
-                if (c == '[')
-                {
-                    st = state::ExpectInner;
-                    ++len;
-                }
-                else
-                    st = state::SearchEsc;
-                break;
-
-            case state::ExpectInner:
-                if (c >= '0'
-                        && c <= '9')
-                {
-                    ++len;
-                    st = state::ExpectTrail;
-                }
-                else
-                    st = state::SearchEsc;
-                break;
-
-            case state::ExpectTrail:
-                if (c == 'm')
-                {
-                    ++len;
-                    found += len;
-                    st = state::SearchEsc;
-                }
-                else if (c != ';'
-                            && ((c < '0') || (c > '9')))
-                    st = state::SearchEsc;
-                /* 0-9, or semicolon */
-                ++len;
-                break;
-        }
-    }
+const tim::vt_style &tim::p::vt::style() const
+{
+    return _screen
+                ? _screen->style()
+                : _style;
+}
 
-    return utf8len((const utf8_int8_t *)s.c_str()) - found;
+void tim::p::vt::set_style(const tim::vt_style &style)
+{
+    if (_screen)
+        _screen->set_style(style);
+    else
+        _style = style;
 }
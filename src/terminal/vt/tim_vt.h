@@ -1,14 +1,17 @@
 #pragma once
 
 #include "tim_a_terminal.h"
+#include "tim_terminal_caps.h"
 
 #include <string>
+#include <string_view>
 
 
 namespace tim
 {
 
 class a_terminal_protocol;
+class vt_screen;
 
 namespace p
 {
@@ -25,6 +28,8 @@ public:
     explicit vt(tim::a_terminal_protocol *proto);
     ~vt();
 
+    const tim::terminal_caps &caps() const;
+
     std::size_t rows() const override;
     std::size_t cols() const override;
     void clear() override;
@@ -38,10 +43,20 @@ public:
     void set_bg_color(std::size_t index) override;
     void reverse_colors() override;
     void reset_colors() override;
+
+    bool write(const char *data, std::size_t size) override;
+    bool write_encoded(const char *data, std::size_t size);
+    bool begin_update();
+    bool end_update();
+
+    void set_screen_enabled(bool enable);
+    tim::vt_screen *screen() const;
+    bool flush();
+
     static std::string colorized(const std::string &s,
                                  const tim::color &text_color,
                                  const tim::color &bg_color = tim::color{});
-    static std::size_t strlen(const std::string &s);
+    static std::size_t strlen(std::string_view s);
 
 private:
 
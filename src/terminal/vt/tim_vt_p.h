@@ -1,13 +1,19 @@
 #pragma once
 
+#include "tim_vt_style.h"
+
 #include <cassert>
+#include <memory>
+#include <string>
 
 
 namespace tim
 {
 
 class a_terminal_protocol;
+class signal_connection;
 class vt;
+class vt_screen;
 
 namespace p
 {
@@ -20,9 +26,20 @@ struct vt
         assert(_q);
     }
 
+    void on_terminal_name_changed(const std::string &name);
+    const tim::vt_style &style() const;
+    void set_style(const tim::vt_style &style);
+
     tim::vt *const _q;
 
     tim::a_terminal_protocol *_term_proto = nullptr;
+    std::unique_ptr<tim::signal_connection> _term_name_changed;
+    tim::terminal_caps _caps;
+    tim::vt_color_encoder _encoder = nullptr; // Picked once per terminal type.
+    tim::vt_style _style; // Set by the color calls,
+    tim::vt_style _term_style; // and the one the terminal has.
+    std::string _out;
+    std::unique_ptr<tim::vt_screen> _screen; // Drawing goes here when set, see flush().
 };
 
 }
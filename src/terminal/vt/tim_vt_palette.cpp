@@ -0,0 +1,145 @@
+#include "tim_vt_palette.h"
+
+
+static constexpr int distance(const tim::color &a, const tim::color &b)
+{
+    const int dr = (int)a.r - b.r;
+    const int dg = (int)a.g - b.g;
+    const int db = (int)a.b - b.b;
+
+    return dr * dr + dg * dg + db * db;
+}
+
+static constexpr std::uint8_t nearest16(const tim::color &c)
+{
+    std::uint8_t best = 0;
+    int best_distance = distance(c, tim::VT_PALETTE256[0]);
+    for (std::uint8_t i = 1; i < 16; ++i)
+    {
+        const int d = distance(c, tim::VT_PALETTE256[i]);
+        if (d < best_distance)
+        {
+            best = i;
+            best_distance = d;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * The cube levels are 0, 95, 135, 175, 215 and 255, the grays
+ * go from 8 to 238 by 10. Both only depend on the components
+ * one by one or on their sum, so they are tabulated.
+ */
+struct palette_levels
+{
+    std::uint8_t cube[256] = {}; // By component, scaled to the cube index.
+    std::uint8_t gray[3 * 255 + 1] = {}; // By the sum of the components.
+
+    constexpr palette_levels()
+    {
+        for (int v = 0; v < 256; ++v)
+            cube[v] = (std::uint8_t)(v < 48
+                                         ? 0
+                                         : v < 115
+                                               ? 1
+                                               : (v - 35) / 40);
+
+        for (int sum = 0; sum <= 3 * 255; ++sum)
+        {
+            const int average = sum / 3;
+            gray[sum] = (std::uint8_t)(232 + (average < 8
+                                                  ? 0
+                                                  : average > 238
+                                                        ? 23
+                                                        : (average - 3) / 10));
+        }
+    }
+};
+
+static constexpr palette_levels PALETTE_LEVELS;
+
+/**
+ * The 16 system colors are not evenly spaced, so they are looked up
+ * in a 16x16x16 cube of cells. A cell whose corners share the nearest
+ * color has it everywhere inside, the Voronoi regions being convex.
+ * The others are marked AMBIGUOUS and searched.
+ */
+struct palette_cube
+{
+    static constexpr int BITS = 4;
+    static constexpr int CELLS = 1 << BITS;
+    static constexpr int STEP = 256 / CELLS;
+    static constexpr std::uint8_t AMBIGUOUS = 0xFF;
+
+    std::uint8_t index16[CELLS * CELLS * CELLS] = {};
+
+    constexpr palette_cube()
+    {
+        constexpr int corners = CELLS + 1;
+        std::uint8_t nearest[corners * corners * corners] = {};
+        for (int r = 0; r < corners; ++r)
+            for (int g = 0; g < corners; ++g)
+                for (int b = 0; b < corners; ++b)
+                    nearest[(r * corners + g) * corners + b] = nearest16(tim::color(corner(r), corner(g), corner(b)));
+
+        for (int r = 0; r < CELLS; ++r)
+            for (int g = 0; g < CELLS; ++g)
+                for (int b = 0; b < CELLS; ++b)
+                {
+                    std::uint8_t &index = index16[(r * CELLS + g) * CELLS + b];
+                    index = nearest[(r * corners + g) * corners + b];
+                    for (int i = 1; i < 8; ++i)
+                        if (nearest[((r + (i & 1)) * corners + g + (i >> 1 & 1)) * corners + b + (i >> 2)] != index)
+                            index = AMBIGUOUS;
+                }
+    }
+
+    static constexpr std::uint8_t corner(int i)
+    {
+        return (std::uint8_t)(i * STEP > 255
+                                  ? 255
+                                  : i * STEP);
+    }
+
+    static constexpr int cell(const tim::color &c)
+    {
+        return ((c.r >> (8 - BITS)) << (2 * BITS))
+                    | ((c.g >> (8 - BITS)) << BITS)
+                    | (c.b >> (8 - BITS));
+    }
+};
+
+static constexpr palette_cube PALETTE_CUBE;
+
+static_assert(PALETTE_CUBE.index16[palette_cube::cell(tim::color("#FFFFFF"))] == 15);
+static_assert(PALETTE_CUBE.index16[palette_cube::cell(tim::color("#000000"))] == 0);
+
+
+// Public
+
+/**
+ * The nearer of the cube and gray candidates wins.
+ */
+std::uint8_t tim::vt_palette_index256(const tim::color &c)
+{
+    const int cube = 16
+                         + 36 * PALETTE_LEVELS.cube[c.r]
+                         + 6 * PALETTE_LEVELS.cube[c.g]
+                         + PALETTE_LEVELS.cube[c.b];
+    const int gray = PALETTE_LEVELS.gray[(int)c.r + c.g + c.b];
+
+    return distance(c, tim::VT_PALETTE256[gray]) < distance(c, tim::VT_PALETTE256[cube])
+                ? (std::uint8_t)gray
+                : (std::uint8_t)cube;
+}
+
+std::uint8_t tim::vt_palette_index16(const tim::color &c)
+{
+    const std::uint8_t index = PALETTE_CUBE.index16[palette_cube::cell(c)];
+
+    return index == palette_cube::AMBIGUOUS
+                ? nearest16(c)
+                : index;
+}
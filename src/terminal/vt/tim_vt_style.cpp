@@ -0,0 +1,328 @@
+#include "tim_vt_style.h"
+
+#include "tim_vt_palette.h"
+
+#include <charconv>
+#include <cstring>
+
+
+/**
+ * Decimal strings of the color components, made at compile time,
+ * each followed by the separator.
+ */
+struct sgr_components
+{
+    char str[256][5] = {};
+    std::uint8_t len[256] = {};
+
+    constexpr sgr_components()
+    {
+        for (unsigned i = 0; i < 256; ++i)
+        {
+            std::uint8_t n = 0;
+            if (i >= 100)
+                str[i][n++] = (char)('0' + i / 100);
+            if (i >= 10)
+                str[i][n++] = (char)('0' + i / 10 % 10);
+            str[i][n++] = (char)('0' + i % 10);
+            str[i][n] = ';';
+            len[i] = n;
+        }
+    }
+};
+
+static constexpr sgr_components SGR_COMPONENTS;
+
+static void append_true_color(std::string &s, char plane, const tim::color &c)
+{
+    // "38;2;r;g;b;" is at most 17 characters.
+    char buf[20] = { plane, '8', ';', '2', ';' };
+    char *p = buf + 5;
+    for (const std::uint8_t v: { c.r, c.g, c.b })
+    {
+        std::memcpy(p, SGR_COMPONENTS.str[v], 4);
+        p += SGR_COMPONENTS.len[v] + 1;
+    }
+
+    s.append(buf, p - 1);
+}
+
+static void append_color256(std::string &s, char plane, const tim::color &c)
+{
+    const std::uint8_t index = tim::vt_palette_index256(c);
+
+    char buf[12] = { plane, '8', ';', '5', ';' };
+    std::memcpy(buf + 5, SGR_COMPONENTS.str[index], 4);
+    s.append(buf, 5 + SGR_COMPONENTS.len[index]);
+}
+
+static void append_color16(std::string &s, char plane, const tim::color &c)
+{
+    // 30-37 and 90-97 for the text, 40-47 and 100-107 for the background.
+    const std::uint8_t index = tim::vt_palette_index16(c);
+    if (index >= 8)
+        s += plane == '3'
+                ? "9"
+                : "10";
+    else
+        s += plane;
+    s += (char)('0' + index % 8);
+}
+
+
+// Public
+
+bool tim::vt_style::is_default() const
+{
+    return fg.empty()
+                && bg.empty()
+                && !attrs;
+}
+
+tim::vt_color_encoder tim::vt_style::encoder(tim::color_depth depth)
+{
+    switch (depth)
+    {
+        case tim::color_depth::Mono:
+            return nullptr;
+
+        case tim::color_depth::Colors16:
+            return &append_color16;
+
+        case tim::color_depth::Colors256:
+            return &append_color256;
+
+        case tim::color_depth::TrueColor:
+            break;
+    }
+
+    return &append_true_color;
+}
+
+void tim::vt_style::append_sgr(std::string &s,
+                               const tim::vt_style &from,
+                               const tim::vt_style &to,
+                               tim::vt_color_encoder encoder)
+{
+    const bool bold = from.attrs.test(tim::vt_attribute::Bold) != to.attrs.test(tim::vt_attribute::Bold);
+    const bool reverse = from.attrs.test(tim::vt_attribute::Reverse) != to.attrs.test(tim::vt_attribute::Reverse);
+    const bool fg = encoder
+                        && (from.fg.empty() != to.fg.empty()
+                                || (!to.fg.empty()
+                                        && ::operator!=(from.fg, to.fg)));
+    const bool bg = encoder
+                        && (from.bg.empty() != to.bg.empty()
+                                || (!to.bg.empty()
+                                        && ::operator!=(from.bg, to.bg)));
+    if (!bold
+            && !reverse
+            && !fg
+            && !bg)
+        return;
+
+    s += "\x1b[";
+
+    // Reset is the shortest when nothing is left set.
+    if (!to.attrs
+            && (!encoder
+                    || (to.fg.empty()
+                            && to.bg.empty())))
+    {
+        s += "0m";
+        return;
+    }
+
+    const std::size_t params = s.size();
+    const auto separate = [&s, params]()
+        {
+            if (s.size() != params)
+                s += ';';
+        };
+
+    if (bold)
+    {
+        separate();
+        s += to.attrs.test(tim::vt_attribute::Bold)
+                ? "1"
+                : "22";
+    }
+
+    if (reverse)
+    {
+        separate();
+        s += to.attrs.test(tim::vt_attribute::Reverse)
+                ? "7"
+                : "27";
+    }
+
+    if (fg)
+    {
+        separate();
+        if (to.fg.empty())
+            s += "39";
+        else
+            encoder(s, '3', to.fg);
+    }
+
+    if (bg)
+    {
+        separate();
+        if (to.bg.empty())
+            s += "49";
+        else
+            encoder(s, '4', to.bg);
+    }
+
+    s += 'm';
+}
+
+void tim::vt_style::apply_sgr(tim::vt_style &style, const char *params, std::size_t size)
+{
+    // At most 16 parameters, the rest are dropped. Empty ones are zeros.
+    unsigned args[16];
+    std::size_t count = 0;
+    for (const char *p = params, *const end = params + size; count < 16;)
+    {
+        args[count] = 0;
+        p = std::from_chars(p, end, args[count]).ptr;
+        ++count;
+        if (p == end
+                || *p++ != ';')
+            break;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+        switch (args[i])
+        {
+            case 0:
+                style = tim::vt_style{};
+                break;
+
+            case 1:
+                style.attrs.set(tim::vt_attribute::Bold);
+                break;
+
+            case 22:
+                style.attrs.clear(tim::vt_attribute::Bold);
+                break;
+
+            case 7:
+                style.attrs.set(tim::vt_attribute::Reverse);
+                break;
+
+            case 27:
+                style.attrs.clear(tim::vt_attribute::Reverse);
+                break;
+
+            case 39:
+                style.fg.clear();
+                break;
+
+            case 49:
+                style.bg.clear();
+                break;
+
+            case 38:
+            case 48:
+                // "38;2;r;g;b" or "38;5;index".
+                if (i + 4 < count
+                        && args[i + 1] == 2)
+                {
+                    (args[i] == 38 ? style.fg : style.bg)
+                        = tim::color((std::uint8_t)args[i + 2],
+                                     (std::uint8_t)args[i + 3],
+                                     (std::uint8_t)args[i + 4]);
+                    i += 4;
+                }
+                else if (i + 2 < count
+                            && args[i + 1] == 5)
+                {
+                    (args[i] == 38 ? style.fg : style.bg)
+                        = tim::VT_PALETTE256[args[i + 2] % tim::VT_PALETTE_SIZE];
+                    i += 2;
+                }
+                else
+                    i = count;
+                break;
+
+            default:
+                if (args[i] >= 30 && args[i] <= 37)
+                    style.fg = tim::VT_PALETTE256[args[i] - 30];
+                else if (args[i] >= 90 && args[i] <= 97)
+                    style.fg = tim::VT_PALETTE256[args[i] - 90 + 8];
+                else if (args[i] >= 40 && args[i] <= 47)
+                    style.bg = tim::VT_PALETTE256[args[i] - 40];
+                else if (args[i] >= 100 && args[i] <= 107)
+                    style.bg = tim::VT_PALETTE256[args[i] - 100 + 8];
+                break;
+        }
+}
+
+void tim::vt_style::translate(std::string &s,
+                              tim::vt_style &term,
+                              tim::vt_style &style,
+                              const char *data,
+                              std::size_t size,
+                              tim::vt_color_encoder encoder)
+{
+    const char *const end = data + size;
+    const char *text = data;
+    while (data < end)
+    {
+        const char *const esc = (const char *)std::memchr(data, '\x1b', end - data);
+        const char *params = esc
+                                 ? esc + 1
+                                 : end;
+        if (params < end
+                && *params == '[')
+            ++params;
+        else
+            params = end;
+
+        const char *final = params;
+        while (final < end
+                    && ((*final >= '0' && *final <= '9')
+                            || *final == ';'))
+            ++final;
+
+        // Other escape sequences are text, the erases need the colors.
+        if (final == end
+                || *final != 'm')
+        {
+            data = esc
+                       ? esc + 1
+                       : end;
+            continue;
+        }
+
+        if (text < esc)
+        {
+            append_sgr(s, term, style, encoder);
+            term = style;
+            s.append(text, esc);
+        }
+
+        apply_sgr(style, params, final - params);
+        text = data = final + 1;
+    }
+
+    if (text < end)
+    {
+        append_sgr(s, term, style, encoder);
+        term = style;
+        s.append(text, end);
+    }
+}
+
+bool tim::vt_style::operator==(const tim::vt_style &other) const
+{
+    // All empty colors look the same.
+    return attrs == other.attrs
+                && (fg.empty() ? other.fg.empty() : ::operator==(fg, other.fg))
+                && (bg.empty() ? other.bg.empty() : ::operator==(bg, other.bg));
+}
+
+bool tim::vt_style::operator!=(const tim::vt_style &other) const
+{
+    return !(*this == other);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "tim_color.h"
+#include "tim_flags.h"
+#include "tim_terminal_caps.h"
+
+#include <string>
+
+
+namespace tim
+{
+
+enum class vt_attribute
+{
+    Bold    = 1 << 0,
+    Reverse = 1 << 1
+};
+
+using vt_attributes = tim::flags<tim::vt_attribute>;
+
+/**
+ * Appends the SGR parameters of a color that is not empty, like
+ * "38;2;r;g;b". \a plane is '3' for the text and '4' for the background.
+ */
+using vt_color_encoder = void (*)(std::string &s, char plane, const tim::color &c);
+
+/**
+ * Graphic rendition of a cell: colors and attributes. Empty colors
+ * are the terminal defaults.
+ */
+struct vt_style
+{
+    tim::color fg;
+    tim::color bg;
+    tim::vt_attributes attrs;
+
+    bool is_default() const;
+
+    bool operator==(const tim::vt_style &other) const;
+    bool operator!=(const tim::vt_style &other) const;
+
+    /**
+     * The encoder for the terminals with \a depth colors, none for Mono.
+     */
+    static tim::vt_color_encoder encoder(tim::color_depth depth);
+
+    /**
+     * Appends one SGR sequence that turns \a from into \a to,
+     * nothing if they are the same. Colors are left out without
+     * an encoder.
+     */
+    static void append_sgr(std::string &s,
+                           const tim::vt_style &from,
+                           const tim::vt_style &to,
+                           tim::vt_color_encoder encoder);
+
+    /**
+     * Applies the parameters of one SGR sequence, what is between
+     * "\x1b[" and "m".
+     */
+    static void apply_sgr(tim::vt_style &style, const char *params, std::size_t size);
+
+    /**
+     * Appends \a data with its SGR sequences replaced by the transitions
+     * from \a term, the style the terminal has. The transition to the
+     * last \a style is left for the next text.
+     */
+    static void translate(std::string &s,
+                          tim::vt_style &term,
+                          tim::vt_style &style,
+                          const char *data,
+                          std::size_t size,
+                          tim::vt_color_encoder encoder);
+};
+
+}
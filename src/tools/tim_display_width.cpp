@@ -0,0 +1,286 @@
+#include "tim_display_width.h"
+
+#include "tim_display_width_table.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+static constexpr int ESCAPE = -1;
+
+/**
+ * Bytes of printable ASCII at the start of [p, end), 16 at a time
+ * with SSE2, 8 at a time otherwise.
+ */
+static std::size_t ascii_run(const char *p, const char *end)
+{
+    const char *const begin = p;
+
+#if defined(__SSE2__)
+    const __m128i below = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    while (end - p >= 16)
+    {
+        // Bytes from 0x80 are negative, so they fail the first compare.
+        const __m128i v = _mm_loadu_si128((const __m128i *)p);
+        const unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpgt_epi8(v, _mm_sub_epi8(below, _mm_set1_epi8(1))),
+                          _mm_cmplt_epi8(v, del)));
+        if (mask != 0xFFFF)
+            return p - begin + __builtin_ctz(~mask);
+
+        p += 16;
+    }
+#else
+    static constexpr std::uint64_t ONES = 0x0101010101010101ull;
+    static constexpr std::uint64_t HIGHS = 0x8080808080808080ull;
+    while (end - p >= 8)
+    {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        const std::uint64_t x = v ^ (0x7F * ONES);
+        if (((v | ((v - 0x20 * ONES) & ~v) | ((x - ONES) & ~x)) & HIGHS) != 0)
+            break;
+
+        p += 8;
+    }
+#endif
+
+    while (p < end
+                && *p >= 0x20
+                && *p < 0x7F)
+        ++p;
+
+    return p - begin;
+}
+
+/**
+ * Length of the escape sequence at \a p, which starts with ESC.
+ * CSI ends with a final byte, OSC, DCS, PM and APC with BEL or ST,
+ * the rest with the first byte after the intermediates.
+ */
+static std::size_t escape_size(const char *p, const char *end)
+{
+    const char *const begin = p++;
+    if (p == end)
+        return 1;
+
+    switch (*p++)
+    {
+        case '[':
+            while (p < end
+                        && *p >= 0x20
+                        && *p < 0x40)
+                ++p;
+            break;
+
+        case ']':
+        case 'P':
+        case '^':
+        case '_':
+            while (p < end)
+            {
+                if (*p == '\a')
+                    return p + 1 - begin;
+                if (*p == '\x1b'
+                        && p + 1 < end
+                        && p[1] == '\\')
+                    return p + 2 - begin;
+                ++p;
+            }
+            return p - begin;
+
+        default:
+            if (p[-1] < 0x20)
+                return 1;
+            if (p[-1] >= 0x30)
+                return p - begin;
+            while (p < end
+                        && *p >= 0x20
+                        && *p < 0x30)
+                ++p;
+            break;
+    }
+
+    return p < end
+                && *p >= 0x30
+                && *p < 0x7F
+                    ? p + 1 - begin
+                    : p - begin;
+}
+
+/**
+ * Decodes the glyph or escape sequence at \a p, returns its size
+ * and sets \a width to its cells, ESCAPE for an escape sequence.
+ */
+static std::size_t next(const char *p, const char *end, int &width)
+{
+    const unsigned char c = (unsigned char)*p;
+    if (c < 0x80)
+    {
+        if (c == 0x1B)
+        {
+            width = ESCAPE;
+            return escape_size(p, end);
+        }
+
+        width = c >= 0x20
+                    && c < 0x7F;
+        return 1;
+    }
+
+    std::size_t size = 0;
+    char32_t cp = 0;
+    if (c >= 0xC2
+            && c < 0xE0)
+    {
+        size = 2;
+        cp = c & 0x1F;
+    }
+    else if (c >= 0xE0
+                && c < 0xF0)
+    {
+        size = 3;
+        cp = c & 0x0F;
+    }
+    else if (c >= 0xF0
+                && c < 0xF5)
+    {
+        size = 4;
+        cp = c & 0x07;
+    }
+
+    if (!size
+            || (std::size_t)(end - p) < size)
+    {
+        width = 1;
+        return 1;
+    }
+
+    for (std::size_t i = 1; i < size; ++i)
+    {
+        const unsigned char cc = (unsigned char)p[i];
+        if ((cc & 0xC0) != 0x80)
+        {
+            width = 1;
+            return 1;
+        }
+
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+
+    width = tim::char_width(cp);
+    return size;
+}
+
+
+// Public
+
+int tim::char_width(char32_t c)
+{
+    if (c >= 0x110000)
+        return 1;
+
+    const std::uint8_t block = WIDTH_BLOCKS[c >> WIDTH_BLOCK_BITS];
+    const std::uint32_t i = c & ((1u << WIDTH_BLOCK_BITS) - 1);
+
+    return (WIDTH_CELLS[block][i >> 2] >> (2 * (i & 3))) & 3;
+}
+
+std::size_t tim::display_width(std::string_view s)
+{
+    const char *p = s.data();
+    const char *const end = p + s.size();
+
+    std::size_t res = 0;
+    while (p < end)
+    {
+        if ((unsigned char)*p < 0x80)
+        {
+            const std::size_t run = ascii_run(p, end);
+            res += run;
+            p += run;
+            if (p == end)
+                break;
+        }
+
+        int width = 0;
+        p += next(p, end, width);
+        if (width > 0)
+            res += width;
+    }
+
+    return res;
+}
+
+std::size_t tim::display_prefix(std::string_view s, std::size_t width)
+{
+    const char *p = s.data();
+    const char *const end = p + s.size();
+
+    while (p < end)
+    {
+        const std::size_t run = std::min(ascii_run(p, end), width);
+        width -= run;
+        p += run;
+        if (p == end)
+            break;
+
+        int w = 0;
+        const std::size_t size = next(p, end, w);
+        if (w > 0
+                && (std::size_t)w > width)
+            break;
+
+        if (w > 0)
+            width -= w;
+        p += size;
+    }
+
+    return p - s.data();
+}
+
+std::size_t tim::display_suffix(std::string_view s, std::size_t width)
+{
+    const std::size_t total = tim::display_width(s);
+    if (total <= width)
+        return 0;
+
+    // Glyphs are dropped from the front until the rest fits,
+    // with the marks combined with the last one.
+    std::size_t drop = total - width;
+    const char *p = s.data();
+    const char *const end = p + s.size();
+    while (p < end
+                && drop)
+    {
+        const std::size_t run = std::min(ascii_run(p, end), drop);
+        drop -= run;
+        p += run;
+        if (!drop
+                || p == end)
+            break;
+
+        int w = 0;
+        p += next(p, end, w);
+        if (w > 0)
+            drop -= std::min<std::size_t>(w, drop);
+    }
+
+    while (p < end)
+    {
+        int w = 0;
+        const std::size_t size = next(p, end, w);
+        if (w != 0)
+            break;
+
+        p += size;
+    }
+
+    return p - s.data();
+}
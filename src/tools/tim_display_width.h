@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+
+namespace tim
+{
+
+/**
+ * Terminal cells taken by the code point \a c: 0 for the controls and
+ * combining marks, 2 for the East Asian wide characters and emoji,
+ * 1 for the rest.
+ */
+int char_width(char32_t c);
+
+/**
+ * Terminal cells taken by the UTF-8 string \a s. Escape sequences take
+ * none, an invalid byte takes one like the replacement character shown
+ * for it.
+ */
+std::size_t display_width(std::string_view s);
+
+/**
+ * Bytes of the longest prefix of \a s not wider than \a width cells.
+ * A wide glyph is never split.
+ */
+std::size_t display_prefix(std::string_view s, std::size_t width);
+
+/**
+ * Offset of the longest suffix of \a s not wider than \a width cells.
+ */
+std::size_t display_suffix(std::string_view s, std::size_t width);
+
+}
@@ -56,4 +56,20 @@ inline std::uint32_t to_le(const std::uint32_t n)
                         | ((n & 0x000000ff) << 24);
 }
 
+inline std::uint64_t to_be(const std::uint64_t n)
+{
+    return is_le()
+                ? ((std::uint64_t)tim::to_be((std::uint32_t)n) << 32)
+                        | tim::to_be((std::uint32_t)(n >> 32))
+                : n;
+}
+
+inline std::uint64_t to_le(const std::uint64_t n)
+{
+    return is_le()
+                ? n
+                : ((std::uint64_t)tim::to_le((std::uint32_t)n) << 32)
+                        | tim::to_le((std::uint32_t)(n >> 32));
+}
+
 }
@@ -7,6 +7,11 @@
 
 #include <fstream>
 
+#ifndef TIM_OS_WINDOWS
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
 
 #ifndef TIM_OS_WINDOWS
 
@@ -245,6 +250,39 @@ bool tim::write_json(const std::filesystem::path &path, const nlohmann::json &j,
     return tim::write_to_file(epath, j.dump(indent));
 }
 
+/**
+ * Flushes the file, or the entries of the folder, to the disk. A file
+ * renamed over another one survives a crash only when it is synced
+ * before the rename and its folder after.
+ */
+bool tim::sync_file(const std::filesystem::path &path)
+{
+#ifndef TIM_OS_WINDOWS
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return TIM_TRACE(Error,
+                         TIM_TR("Failed to open file '%s': %s"_en,
+                                "Ошибка при открытии файла '%s': %s"_ru),
+                         path.string().c_str(),
+                         std::strerror(errno));
+
+    const int res = ::fsync(fd);
+    const int err = errno;
+    ::close(fd);
+
+    if (res)
+        return TIM_TRACE(Error,
+                         TIM_TR("Failed to flush file '%s' to disk: %s"_en,
+                                "Ошибка при сохранении файла '%s' на диск: %s"_ru),
+                         path.string().c_str(),
+                         std::strerror(err));
+#else
+    (void) path;
+#endif
+
+    return true;
+}
+
 std::size_t tim::process_file(const std::filesystem::path &path,
                               std::function<bool(const tim::byte_vector &)> fn,
                               std::size_t chunk_size)
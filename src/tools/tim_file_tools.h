@@ -55,6 +55,7 @@ bool write_to_file(const std::filesystem::path &path,
                    tim::file_write_mode mode = tim::file_write_mode::Overwrite);
 
 bool write_json(const std::filesystem::path &path, const nlohmann::json &j, int indent = -1);
+bool sync_file(const std::filesystem::path &path);
 
 std::size_t process_file(const std::filesystem::path &path,
                          std::function<bool(const tim::byte_vector &)> fn,
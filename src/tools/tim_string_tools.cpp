@@ -1,6 +1,6 @@
 #include "tim_string_tools.h"
 
-#include "tim_string_vector.h"
+#include "tim_display_width.h"
 #include "tim_trace.h"
 #include "tim_translator.h"
 
@@ -16,6 +16,93 @@
 #include <regex>
 
 
+/**
+ * Takes the next word separated by spaces and tabs from \a s
+ * and measures it if \a width is given.
+ */
+static std::string_view next_word(std::string_view &s, std::size_t *width = nullptr)
+{
+    const char *p = s.data();
+    const char *const end = p + s.size();
+    while (p < end
+                && (*p == ' '
+                        || *p == '\t'))
+        ++p;
+
+    // Printable ASCII is one cell a byte, the rest is measured.
+    const char *const begin = p;
+    bool ascii = true;
+    while (p < end
+                && *p != ' '
+                && *p != '\t')
+        ascii &= (unsigned char)(*p++ - 0x20) < 0x5F;
+
+    const std::string_view word(begin, p - begin);
+    s.remove_prefix(p - s.data());
+
+    if (width)
+        *width = ascii
+                     ? word.size()
+                     : tim::display_width(word);
+
+    return word;
+}
+
+/**
+ * Writes the \a count words at the start of \a words as a line of
+ * tim::aligned(). \a words_width is their width without the spaces.
+ */
+static void append_line(std::string &out,
+                        std::string_view words,
+                        std::size_t count,
+                        std::size_t words_width,
+                        tim::text_align al,
+                        std::size_t width,
+                        bool last,
+                        bool &first)
+{
+    if (!first)
+        out += '\n';
+    first = false;
+
+    const std::size_t gaps = count - 1;
+    const std::size_t free = width > words_width + gaps
+                                 ? width - words_width - gaps
+                                 : 0;
+    std::size_t space = 1;
+    std::size_t extra = 0; // Gaps one space wider, the first ones.
+    switch (al)
+    {
+        case tim::text_align::Right:
+            out.append(free, ' ');
+            break;
+
+        case tim::text_align::Center:
+            out.append(free >> 1, ' ');
+            break;
+
+        case tim::text_align::Justify:
+            if (!last
+                    && gaps)
+            {
+                space += free / gaps;
+                extra = free % gaps;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        out.append(next_word(words));
+        if (i < gaps)
+            out.append(space + (i < extra), ' ');
+    }
+}
+
+
 std::wstring tim::to_wstring(const std::string &s)
 {
     return std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t>().from_bytes(s);
@@ -586,142 +673,99 @@ std::string tim::centered(const std::string &str, std::size_t width)
 
 std::string tim::elided(const std::string &str, std::size_t width, tim::elide el)
 {
-    static const wchar_t *DOTS = L"...";
-    static const std::size_t DOTS_LEN = std::wcslen(DOTS);
-
-    if (width <= DOTS_LEN)
-        return tim::from_wstring(DOTS);
+    static const std::string_view DOTS = "...";
 
-    std::wstring wstr = tim::to_wstring(str);
-
-    if (wstr.size() <= width)
+    if (tim::display_width(str) <= width)
         return str;
 
+    if (width <= DOTS.size())
+        return std::string(DOTS);
+
+    std::string res;
     switch (el)
     {
         case tim::elide::Left:
-            wstr.erase(0, str.size() - width - DOTS_LEN);
-            wstr.insert(0, DOTS, DOTS_LEN);
+            res.append(DOTS);
+            res.append(str, tim::display_suffix(str, width - DOTS.size()));
             break;
 
         case tim::elide::Right:
-            wstr.erase(width - DOTS_LEN);
-            wstr.append(DOTS, DOTS_LEN);
+            res.assign(str, 0, tim::display_prefix(str, width - DOTS.size()));
+            res.append(DOTS);
             break;
 
         case tim::elide::Middle:
         {
-            const std::size_t d = (width - DOTS_LEN) / 2;
-            wstr = wstr.substr(0, d)
-                        + DOTS
-                        + wstr.substr(str.size() - d);
+            const std::size_t d = (width - DOTS.size()) / 2;
+            res.assign(str, 0, tim::display_prefix(str, d));
+            res.append(DOTS);
+            res.append(str, tim::display_suffix(str, d));
             break;
         }
     }
 
-    return tim::from_wstring(wstr);
+    return res;
 }
 
 std::string tim::aligned(const std::string &str, tim::text_align al, std::size_t width)
 {
-    if (str.empty()
-            || width == 0)
-        return str;
-
-    const std::wstring text = tim::to_wstring(str);
-    if (text.size() <= width)
-        return str;
+    std::string res;
+    res.reserve(str.size() + str.size() / 4);
+    tim::aligned(res, str, al, width);
+    return res;
+}
 
-    tim::wstring_vector pars;
-    tim::wstring_vector words;
-    std::size_t space_num, space_rem;
-    std::size_t delta;
-    std::wstring aligned_text;
-    std::wstring space;
-
-    pars = tim::split<tim::wstring_vector>(text, L"\n", tim::split_mode::SkipEmptyParts);
-    tim::wstring_vector::const_iterator pb = pars.cbegin();
-    tim::wstring_vector::const_iterator pi = pb;
-    tim::wstring_vector::const_iterator pe = pars.cend();
-    for (; pi != pe; ++pi)
+/**
+ * Lays the UTF-8 text \a str out in lines at most \a width terminal cells
+ * wide and appends them to \a out. Paragraphs are split by '\n', words
+ * by spaces and tabs, a word wider than \a width takes a line alone.
+ * The last line of a paragraph is not justified.
+ *
+ * Nothing is allocated but the growth of \a out, a buffer reused
+ * between the calls does not grow for the text of the same size.
+ */
+void tim::aligned(std::string &out, std::string_view str, tim::text_align al, std::size_t width)
+{
+    if (str.empty()
+            || width == 0
+            || tim::display_width(str) <= width)
     {
-        if (pi != pb)
-            aligned_text += '\n';
+        out.append(str);
+        return;
+    }
 
-        words = tim::split<tim::wstring_vector>(*pi, L" \t", tim::split_mode::SkipEmptyParts);
-        std::size_t begin = 0;
-        std::size_t end = 0;
+    bool first = true;
+    while (!str.empty())
+    {
+        const std::size_t eol = std::min(str.find('\n'), str.size());
+        std::string_view par = str.substr(0, eol);
+        str.remove_prefix(std::min(eol + 1, str.size()));
+
+        // Words are measured once, the line is read again to be written.
+        const char *const par_end = par.data() + par.size();
+        const char *line = nullptr;
+        std::size_t count = 0;
         std::size_t line_width = 0;
-        for (std::size_t i = 0; i < words.size(); ++i)
+        std::size_t word_width = 0;
+        for (std::string_view word = next_word(par, &word_width); !word.empty(); word = next_word(par, &word_width))
         {
-            std::size_t word_width = words[i].length();
-            if (line_width + end - begin + word_width + 1 <= width)
+            if (count
+                    && line_width + count + word_width > width)
             {
-                line_width += word_width;
-                end = i;
+                append_line(out, std::string_view(line, par_end - line), count, line_width, al, width, false, first);
+                count = 0;
+                line_width = 0;
             }
-            else
-            {
-                delta = end - begin;
-                space_num = delta != 0 ? (al == tim::text_align::Justify ? (width - line_width) / delta : 1) : 0;
-                space_rem = delta != 0 ? (al == tim::text_align::Justify ? (width - line_width) % delta : 0) : 0;
-
-                if (begin != 0)
-                    aligned_text += '\n';
-                if (al == tim::text_align::Right)
-                {
-                    space.assign(width - line_width - delta, ' ');
-                    aligned_text.append(space);
-                }
-                else if (al == tim::text_align::Center)
-                {
-                    space.assign((width - line_width - delta) >> 1, ' ');
-                    aligned_text.append(space);
-                }
-                for (std::size_t j = begin; j <= end; ++j)
-                {
-                    aligned_text.append(words[j]);
-                    if (j < end - 1)
-                    {
-                        if (space_rem != 0)
-                        {
-                            space.assign(space_num + 1, ' ');
-                            --space_rem;
-                        }
-                        else
-                            space.assign(space_num, ' ');
-                        aligned_text.append(space);
-                    }
-                    else if (j == end - 1)
-                    {
-                        space.assign(space_num + space_rem, ' ');
-                        aligned_text.append(space);
-                    }
-                }
-                begin = end = i;
-                line_width = word_width;
-            }
-        }
 
-        if (line_width != 0)
-        {
-            if (begin != 0)
-                aligned_text += '\n';
-            if (al == tim::text_align::Center)
-            {
-                space.assign((width - line_width - (end - begin)) >> 1, ' ');
-                aligned_text.append(space);
-            }
-            for (std::size_t j = begin; j <= end; ++j)
-            {
-                aligned_text.append(words[j]);
-                if (j <= end - 1)
-                    aligned_text += ' ';
-            }
+            if (!count)
+                line = word.data();
+            ++count;
+            line_width += word_width;
         }
-    }
 
-    return tim::from_wstring(aligned_text);
+        if (count)
+            append_line(out, std::string_view(line, par_end - line), count, line_width, al, width, true, first);
+    }
 }
 
 bool tim::strcasecmp(const char *s1, const char *s2)
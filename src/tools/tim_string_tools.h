@@ -10,6 +10,7 @@
 #include <cstdarg>
 #include <list>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
@@ -138,6 +139,10 @@ enum class text_align
 std::string aligned(const std::string &str,
                     tim::text_align al = tim::text_align::Justify,
                     std::size_t width = 80);
+void aligned(std::string &out,
+             std::string_view str,
+             tim::text_align al = tim::text_align::Justify,
+             std::size_t width = 80);
 
 template<class S1, class S2>
 bool equal(const S1 &str1,
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 
@@ -9,4 +10,17 @@ namespace tim
 
 using byte_vector = std::vector<std::uint8_t>;
 
+/**
+ * Non-owning view of bytes stored elsewhere.
+ */
+struct byte_view
+{
+    const std::uint8_t *data = nullptr;
+    std::size_t size = 0;
+
+    bool empty() const { return !size; }
+    const std::uint8_t *begin() const { return data; }
+    const std::uint8_t *end() const { return data + size; }
+};
+
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 
 
@@ -13,21 +14,144 @@ struct color
     std::uint8_t b = 0;
     std::uint8_t a = 0;
 
-    color() = default;
-    color(std::uint8_t _r, std::uint8_t _g, std::uint8_t _b, std::uint8_t _a = 0xFF);
-    color(const char *html_color);
+    constexpr color() = default;
+    constexpr inline color(std::uint8_t _r, std::uint8_t _g, std::uint8_t _b, std::uint8_t _a = 0xFF);
+    constexpr inline color(const char *html_color);
 
-    static tim::color black();
-    static tim::color white();
-    static tim::color transparent();
+    static constexpr inline tim::color black();
+    static constexpr inline tim::color white();
+    static constexpr inline tim::color transparent();
 
-    bool empty() const;
-    void clear();
+    constexpr inline bool empty() const;
+    constexpr inline void clear();
 
-    tim::color text_color() const;
+    constexpr inline tim::color text_color() const;
+
+private:
+
+    static constexpr inline int hex_digit(char c);
+    static void invalid_html_color(const char *html_color);
 };
 
 }
 
-bool operator==(const tim::color &a, const tim::color &b);
-bool operator!=(const tim::color &a, const tim::color &b);
+constexpr inline bool operator==(const tim::color &a, const tim::color &b);
+constexpr inline bool operator!=(const tim::color &a, const tim::color &b);
+
+
+// Implementation
+
+// Public
+
+constexpr tim::color::color(std::uint8_t _r, std::uint8_t _g, std::uint8_t _b, std::uint8_t _a)
+    : r(_r)
+    , g(_g)
+    , b(_b)
+    , a(_a)
+{
+}
+
+/**
+ * "#RRGGBB" or "#RRGGBBAA", in any case. Parsed at compile time
+ * for the literals, an invalid one is a compile error then.
+ */
+constexpr tim::color::color(const char *html_color)
+{
+    assert(html_color && *html_color);
+
+    std::uint8_t v[4] = { 0, 0, 0, 0xFF };
+    int n = 0;
+    if (html_color[0] == '#')
+        for (; n < 4; ++n)
+        {
+            const int hi = hex_digit(html_color[1 + 2 * n]);
+            const int lo = hi < 0
+                               ? -1
+                               : hex_digit(html_color[2 + 2 * n]);
+            if (lo < 0)
+                break;
+
+            v[n] = (std::uint8_t)(hi * 16 + lo);
+        }
+
+    if (n < 3)
+    {
+        invalid_html_color(html_color);
+        return;
+    }
+
+    r = v[0];
+    g = v[1];
+    b = v[2];
+    a = v[3];
+}
+
+constexpr tim::color tim::color::black()
+{
+    return tim::color{ 0, 0, 0, 0xFF };
+}
+
+constexpr tim::color tim::color::white()
+{
+    return tim::color{ 0xFF, 0xFF, 0xFF, 0xFF };
+}
+
+constexpr tim::color tim::color::transparent()
+{
+    return tim::color{};
+}
+
+constexpr bool tim::color::empty() const
+{
+    return (!r && !g && !b) || a == 0;
+}
+
+constexpr void tim::color::clear()
+{
+    r = 0;
+    g = 0;
+    b = 0;
+    a = 0;
+}
+
+/**
+ * The BT.601 luma against the usual 186 of 255 threshold,
+ * in integers.
+ */
+constexpr tim::color tim::color::text_color() const
+{
+    return 299 * r + 587 * g + 114 * b > 186 * 1000
+                ? tim::color::black()
+                : tim::color::white();
+}
+
+
+// Private
+
+constexpr int tim::color::hex_digit(char c)
+{
+    return c >= '0' && c <= '9'
+               ? c - '0'
+               : c >= 'A' && c <= 'F'
+                     ? c - 'A' + 10
+                     : c >= 'a' && c <= 'f'
+                           ? c - 'a' + 10
+                           : -1;
+}
+
+
+constexpr bool operator==(const tim::color &a, const tim::color &b)
+{
+    return a.r == b.r
+                && a.g == b.g
+                && a.b == b.b
+                && a.a == b.a;
+}
+
+constexpr bool operator!=(const tim::color &a, const tim::color &b)
+{
+    return a.r != b.r
+                || a.g != b.g
+                || a.b != b.b
+                || a.a != b.a;
+}
@@ -1,53 +1,69 @@
 #include "tim_uuid.h"
 
 #include "tim_endian.h"
+#include "tim_trace.h"
+#include "tim_translator.h"
 
-#include <random>
-#include <limits>
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
 
+#include <array>
 #include <cstring>
 
 
-template<typename Integral>
-void tim_to_hex(char *&dst, Integral value)
+/* Hex digit pairs for every byte value, "000102...feff". */
+static constexpr std::array<char, 512> TIM_HEX_PAIRS = []
 {
-    static const char digits[] = "0123456789abcdef";
-
-    value = tim::to_be(value);
+    constexpr char digits[] = "0123456789abcdef";
 
-    const char* p = reinterpret_cast<const char *>(&value);
-
-    for (unsigned int i = 0; i < sizeof(Integral); ++i, dst += 2)
+    std::array<char, 512> pairs{};
+    for (std::size_t i = 0; i < 256; ++i)
     {
-        unsigned int j = (p[i] >> 4) & 0xf;
-        dst[0] = digits[j];
-        j = p[i] & 0xf;
-        dst[1] = digits[j];
+        pairs[i * 2] = digits[i >> 4];
+        pairs[i * 2 + 1] = digits[i & 0xf];
     }
+    return pairs;
+}();
+
+/* Hex digit values, 0xF0 marks a character that is not a hex digit. */
+static constexpr std::array<unsigned char, 256> TIM_HEX_VALUES = []
+{
+    std::array<unsigned char, 256> values{};
+    for (std::size_t i = 0; i < 256; ++i)
+        values[i] = 0xf0;
+    for (unsigned char c = '0'; c <= '9'; ++c)
+        values[c] = c - '0';
+    for (unsigned char c = 'a'; c <= 'f'; ++c)
+        values[c] = c - 'a' + 10;
+    for (unsigned char c = 'A'; c <= 'F'; ++c)
+        values[c] = c - 'A' + 10;
+    return values;
+}();
+
+template<typename Integral>
+inline void tim_to_hex(char *&dst, Integral value)
+{
+    for (int shift = (sizeof(Integral) - 1) * 8; shift >= 0; shift -= 8, dst += 2)
+        std::memcpy(dst, &TIM_HEX_PAIRS[((value >> shift) & 0xff) * 2], 2);
 }
 
+/* Branch-free: all digits are consumed and the validity is checked once. */
 template<typename Integral>
-bool tim_from_hex(const char *&src, Integral &value)
+inline bool tim_from_hex(const char *&src, Integral &value)
 {
-    value = 0;
+    unsigned acc = 0;
+    unsigned bad = 0;
 
     for (unsigned int i = 0; i < sizeof(Integral) * 2; ++i)
     {
-        int ch = *src++;
-        int tmp;
-        if (ch >= '0' && ch <= '9')
-            tmp = ch - '0';
-        else if (ch >= 'a' && ch <= 'f')
-            tmp = ch - 'a' + 10;
-        else if (ch >= 'A' && ch <= 'F')
-            tmp = ch - 'A' + 10;
-        else
-            return false;
-
-        value = value * 16 + tmp;
+        const unsigned d = TIM_HEX_VALUES[(unsigned char)*src++];
+        bad |= d;
+        acc = (acc << 4) | (d & 0xf);
     }
 
-    return true;
+    value = (Integral)acc;
+
+    return !(bad & 0xf0);
 }
 
 void tim_uuid_to_hex(char *&dst, const unsigned int &d1, const unsigned short &d2, const unsigned short &d3,
@@ -68,7 +84,8 @@ void tim_uuid_to_hex(char *&dst, const unsigned int &d1, const unsigned short &d
     for (int i = 2; i < 8; i++)
         tim_to_hex(dst, d4[i]);
 
-    *dst = curly_brackets ? '}' : 0;
+    if (curly_brackets)
+        *dst++ = '}';
 }
 
 void tim_uuid_to_compact_hex(char *&dst,
@@ -78,39 +95,100 @@ void tim_uuid_to_compact_hex(char *&dst,
     tim_to_hex(dst, d1);
     tim_to_hex(dst, d2);
     tim_to_hex(dst, d3);
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < 8; i++)
         tim_to_hex(dst, d4[i]);
-    for (int i = 2; i < 8; i++)
-        tim_to_hex(dst, d4[i]);
-    *dst = 0;
 }
 
+/* The caller guarantees that at least 36 characters (37 with the
+ * leading bracket) are readable at \a src. */
 bool tim_uuid_from_hex(const char *&src,
                        unsigned int &d1, unsigned short &d2,
                        unsigned short &d3, unsigned char (&d4)[8])
 {
     if (*src == '{')
         src++;
-    if (!tim_from_hex(src, d1)
-            || *src++ != '-'
-            || !tim_from_hex(src, d2)
-            || *src++ != '-'
-            || !tim_from_hex(src, d3)
-            || *src++ != '-'
-            || !tim_from_hex(src, d4[0])
-            || !tim_from_hex(src, d4[1])
-            || *src++ != '-'
-            || !tim_from_hex(src, d4[2])
-            || !tim_from_hex(src, d4[3])
-            || !tim_from_hex(src, d4[4])
-            || !tim_from_hex(src, d4[5])
-            || !tim_from_hex(src, d4[6])
-            || !tim_from_hex(src, d4[7]))
-        return false;
 
-    return true;
+    // Dashes are at fixed positions, check them all at once.
+    const bool dashes = (src[8] == '-') & (src[13] == '-') & (src[18] == '-') & (src[23] == '-');
+
+    bool ok = tim_from_hex(src, d1);
+    ++src;
+    ok &= tim_from_hex(src, d2);
+    ++src;
+    ok &= tim_from_hex(src, d3);
+    ++src;
+    ok &= tim_from_hex(src, d4[0]);
+    ok &= tim_from_hex(src, d4[1]);
+    ++src;
+    for (int i = 2; i < 8; ++i)
+        ok &= tim_from_hex(src, d4[i]);
+
+    return ok & dashes;
 }
 
+/* Variant of the UUID by the 3 MSB of data4[0]. */
+static constexpr tim::uuid::variant TIM_UUID_VARIANTS[8] =
+{
+    tim::uuid::variant::Ncs,
+    tim::uuid::variant::Ncs,
+    tim::uuid::variant::Ncs,
+    tim::uuid::variant::Ncs,
+    tim::uuid::variant::Dce,
+    tim::uuid::variant::Dce,
+    tim::uuid::variant::Microsoft,
+    tim::uuid::variant::Reserved
+};
+
+/* Per-thread CTR_DRBG, seeded once from the system entropy source.
+ * Random bytes are drawn in blocks to amortize the generator update. */
+struct tim_uuid_rng
+{
+    tim_uuid_rng()
+    {
+        mbedtls_entropy_init(&_entropy);
+        mbedtls_ctr_drbg_init(&_drbg);
+
+        static const char PERSONALIZATION[] = "tim::uuid";
+        const int res = mbedtls_ctr_drbg_seed(&_drbg, mbedtls_entropy_func, &_entropy,
+                                              (const unsigned char *)PERSONALIZATION,
+                                              sizeof(PERSONALIZATION) - 1);
+        if (res != 0)
+            TIM_TRACE(Fatal,
+                      TIM_TR("Failed to seed UUID random generator: %d."_en,
+                             "Ошибка при инициализации генератора случайных чисел для UUID: %d."_ru),
+                      res);
+    }
+
+    ~tim_uuid_rng()
+    {
+        mbedtls_ctr_drbg_free(&_drbg);
+        mbedtls_entropy_free(&_entropy);
+    }
+
+    void fill(unsigned char *dst, std::size_t size)
+    {
+        if (_pos + size > sizeof(_buf))
+        {
+            const int res = mbedtls_ctr_drbg_random(&_drbg, _buf, sizeof(_buf));
+            if (res != 0)
+                TIM_TRACE(Fatal,
+                          TIM_TR("Failed to generate random UUID: %d."_en,
+                                 "Ошибка при генерации случайного UUID: %d."_ru),
+                          res);
+            _pos = 0;
+        }
+
+        std::memcpy(dst, _buf + _pos, size);
+        std::memset(_buf + _pos, 0, size); // Do not keep handed out bytes in memory.
+        _pos += size;
+    }
+
+    mbedtls_entropy_context _entropy;
+    mbedtls_ctr_drbg_context _drbg;
+    unsigned char _buf[MBEDTLS_CTR_DRBG_MAX_REQUEST];
+    std::size_t _pos = sizeof(_buf);
+};
+
 /** \class tim::uuid
 
     \brief The tim::uuid class stores a Universally Unique Identifier (UUID).
@@ -259,13 +337,7 @@ tim::uuid::uuid(const char *text)
     if (!text)
         return;
 
-    if (!tim_uuid_from_hex(text, data1, data2, data3, data4))
-    {
-        clear();
-        return;
-    }
-
-    _valid = true;
+    from_chars(text, strnlen(text, MAX_STRING_SIZE));
 }
 
 /** Returns the string representation of this tim::uuid. The string is
@@ -284,38 +356,55 @@ tim::uuid::uuid(const char *text)
 */
 std::string tim::uuid::to_string(const format format) const
 {
-    char buffer[39];
-    buffer[38] = 0;
+    char buffer[MAX_STRING_SIZE];
+    return std::string(buffer, to_chars(buffer, format));
+}
+
+/** Writes the string representation of this tim::uuid in the \a format
+    to \a dst without allocating memory. No terminating zero is written.
+
+    \param dst Buffer of at least tim::uuid::MAX_STRING_SIZE characters.
+    \return Pointer past the last written character.
 
-    char *data = buffer;
+    \sa to_string()
+*/
+char *tim::uuid::to_chars(char *dst, const format format) const
+{
     switch (format)
     {
         case format::Canonical:
-            tim_uuid_to_hex(data, data1, data2, data3, data4, true);
+            tim_uuid_to_hex(dst, data1, data2, data3, data4, true);
             break;
 
         case format::NoBrackets:
-            tim_uuid_to_hex(data, data1, data2, data3, data4, false);
+            tim_uuid_to_hex(dst, data1, data2, data3, data4, false);
             break;
 
         case format::Compact:
-            tim_uuid_to_compact_hex(data, data1, data2, data3, data4);
+            tim_uuid_to_compact_hex(dst, data1, data2, data3, data4);
             break;
     }
-    return buffer;
+    return dst;
 }
 
 bool tim::uuid::from_string(const std::string &text)
 {
-    if (text.length() < 36)
-        return false;
+    return from_chars(text.data(), text.size());
+}
 
-    const char *data = text.c_str();
+/** Parses \a size characters at \a text, see tim::uuid(const std::string &)
+    for the accepted formats.
 
-    if (*data == '{' && text.length() < 37)
+    \return true if succeeded, and false otherwise.
+*/
+bool tim::uuid::from_chars(const char *text, std::size_t size)
+{
+    if (size < 36
+            || (*text == '{'
+                    && size < 37))
         return false;
 
-    if (!tim_uuid_from_hex(data, data1, data2, data3, data4))
+    if (!tim_uuid_from_hex(text, data1, data2, data3, data4))
     {
         clear();
         return false;
@@ -331,9 +420,9 @@ bool tim::uuid::from_string(const std::string &text)
 */
 bool tim::uuid::is_null() const
 {
-    return data4[0] == 0 && data4[1] == 0 && data4[2] == 0 && data4[3] == 0 &&
-           data4[4] == 0 && data4[5] == 0 && data4[6] == 0 && data4[7] == 0 &&
-           data1 == 0 && data2 == 0 && data3 == 0;
+    std::uint64_t hi, lo;
+    to_u64(hi, lo);
+    return (hi | lo) == 0;
 }
 
 void tim::uuid::clear()
@@ -361,16 +450,10 @@ tim::uuid &tim::uuid::operator=(const tim::uuid &other)
 */
 bool tim::uuid::operator==(const tim::uuid &orig) const
 {
-    if (data1 != orig.data1
-            || data2 != orig.data2
-            || data3 != orig.data3)
-        return false;
-
-    for(unsigned i = 0; i < 8; ++i)
-        if (data4[i] != orig.data4[i])
-            return false;
-
-    return true;
+    std::uint64_t hi1, lo1, hi2, lo2;
+    to_u64(hi1, lo1);
+    orig.to_u64(hi2, lo2);
+    return ((hi1 ^ hi2) | (lo1 ^ lo2)) == 0;
 }
 
 /** Returns the value in the variant field of the
@@ -382,18 +465,9 @@ bool tim::uuid::operator==(const tim::uuid &orig) const
 */
 tim::uuid::variant tim::uuid::uuid_variant() const
 {
-    if (is_null())
-        return variant::Unknown;
-    // Check the 3 MSB of data4[0].
-    if ((data4[0] & 0x80) == 0x00)
-        return variant::Ncs;
-    else if ((data4[0] & 0xC0) == 0x80)
-        return variant::Dce;
-    else if ((data4[0] & 0xE0) == 0xC0)
-        return variant::Microsoft;
-    else if ((data4[0] & 0xE0) == 0xE0)
-        return variant::Reserved;
-    return variant::Unknown;
+    return is_null()
+                ? variant::Unknown
+                : TIM_UUID_VARIANTS[data4[0] >> 5]; // The 3 MSB of data4[0].
 }
 
 /** Returns the version field of the UUID, if the
@@ -415,7 +489,13 @@ tim::uuid::version tim::uuid::uuid_version() const
 }
 
 
-#define ISLESS(f1, f2) if (f1 != f2) return (f1 < f2);
+/* Key for lexicographic ordering: the variant and the value as a big-endian 128-bit number. */
+struct tim_uuid_key
+{
+    int variant;
+    std::uint64_t hi;
+    std::uint64_t lo;
+};
 
 /** Returns true if this tim::uuid has the same variant field
     as the \a other tim::uuid and is lexicographically
@@ -427,21 +507,26 @@ tim::uuid::version tim::uuid::uuid_version() const
 */
 bool tim::uuid::operator<(const tim::uuid &other) const
 {
-    if (uuid_variant() != other.uuid_variant())
-        return uuid_variant() < other.uuid_variant();
-
-    ISLESS(data1, other.data1);
-    ISLESS(data2, other.data2);
-    ISLESS(data3, other.data3);
-    for (int n = 0; n < 8; ++n)
-        ISLESS(data4[n], other.data4[n]);
-
-    return false;
+    const auto key = [](const tim::uuid &u)
+    {
+        tim_uuid_key k;
+        k.variant = (int)u.uuid_variant();
+        u.to_u64(k.hi, k.lo);
+        k.lo = tim::to_be(k.lo); // data4 bytes as a big-endian number.
+        return k;
+    };
+
+    const tim_uuid_key a = key(*this);
+    const tim_uuid_key b = key(other);
+
+    // Branch-free lexicographic comparison of (variant, hi, lo).
+    return (a.variant < b.variant)
+                | ((a.variant == b.variant)
+                        & ((a.hi < b.hi)
+                                | ((a.hi == b.hi)
+                                        & (a.lo < b.lo))));
 }
 
-
-#define ISMORE(f1, f2) if (f1 != f2) return (f1 > f2);
-
 /** Returns true if this tim::uuid has the same variant field as the
     \a other tim::uuid and is lexicographically
     after the \a other tim::uuid. If the \a other tim::uuid has a
@@ -452,38 +537,29 @@ bool tim::uuid::operator<(const tim::uuid &other) const
 */
 bool tim::uuid::operator>(const tim::uuid &other) const
 {
-    if (uuid_variant() != other.uuid_variant())
-        return uuid_variant() > other.uuid_variant();
-
-    ISMORE(data1, other.data1);
-    ISMORE(data2, other.data2);
-    ISMORE(data3, other.data3);
-    for (int n = 0; n < 8; ++n)
-        ISMORE(data4[n], other.data4[n]);
-
-    return false;
+    return other < *this;
 }
 
 /** This function returns a new
     UUID with variant tim::uuid::Dce and version tim::uuid::Random.
+    The random numbers come from a per-thread CTR_DRBG generator
+    seeded once from the system entropy source.
 
     \sa variant(), version()
 */
-
 tim::uuid tim::uuid::create()
 {
-    static std::random_device rd;
-    static std::default_random_engine rng(rd());
+    thread_local tim_uuid_rng rng;
 
-    tim::uuid result;
+    unsigned char bytes[16];
+    rng.fill(bytes, sizeof(bytes));
 
-    unsigned *data = &(result.data1);
+    tim::uuid result;
 
-    std::uniform_int_distribution<> dist(0, std::numeric_limits<unsigned>::max());
-    *data       = dist(rng);
-    *(data + 1) = dist(rng);
-    *(data + 2) = dist(rng);
-    *(data + 3) = dist(rng);
+    std::memcpy(&result.data1, bytes, sizeof(result.data1));
+    std::memcpy(&result.data2, bytes + 4, sizeof(result.data2));
+    std::memcpy(&result.data3, bytes + 6, sizeof(result.data3));
+    std::memcpy(result.data4, bytes + 8, sizeof(result.data4));
 
     result.data4[0] = (result.data4[0] & 0x3F) | 0x80; // UV_DCE
     result.data3 = (result.data3 & 0x0FFF) | 0x4000;   // UV_Random
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <list>
@@ -57,9 +59,13 @@ public:
         Compact    = 3  // Like 943b573e7a1d441981b13308455be5f7
     };
 
+    static constexpr std::size_t MAX_STRING_SIZE = 38; ///< Length of tim::uuid::format::Canonical.
+
     inline std::string to_string() const;
     std::string to_string(const format format) const;
+    char *to_chars(char *dst, const format format = format::Canonical) const;
     bool from_string(const std::string &text);
+    bool from_chars(const char *text, std::size_t size);
     inline operator std::string() const;
 
     bool is_null() const;
@@ -81,8 +87,12 @@ public:
     variant uuid_variant() const;
     version uuid_version() const;
 
+    inline std::size_t hash() const;
+
 private:
 
+    inline void to_u64(std::uint64_t &hi, std::uint64_t &lo) const;
+
     bool _valid;
 
     unsigned int   data1;
@@ -110,7 +120,7 @@ public:
 
     inline std::size_t operator()(const tim::uuid &uuid) const
     {
-        return std::hash<std::string>()(uuid.to_string());
+        return uuid.hash();
     }
 };
 
@@ -169,3 +179,38 @@ bool tim::uuid::operator!=(const tim::uuid &orig) const
 {
     return !(*this == orig);
 }
+
+/** Hashes the 128-bit value directly, no string formatting is involved.
+*/
+std::size_t tim::uuid::hash() const
+{
+    std::uint64_t hi, lo;
+    to_u64(hi, lo);
+
+    // MurmurHash3 finalizer over both halves.
+    std::uint64_t h = hi ^ (lo * 0x9E3779B97F4A7C15ULL);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+
+    return (std::size_t)h;
+}
+
+
+// Private
+
+/** Loads the 128-bit value as two machine words. \a hi holds
+    data1, data2 and data3 in numeric order, \a lo holds the raw bytes of
+    data4 in native byte order.
+*/
+void tim::uuid::to_u64(std::uint64_t &hi, std::uint64_t &lo) const
+{
+    static_assert(sizeof(data4) == sizeof(std::uint64_t), "data4 must be 64 bits wide.");
+
+    hi = ((std::uint64_t)data1 << 32)
+            | ((std::uint64_t)data2 << 16)
+            | (std::uint64_t)data3;
+    std::memcpy(&lo, data4, sizeof(lo));
+}